@@ -0,0 +1,57 @@
+#ifndef ZETTA_BATCH_H__
+#define ZETTA_BATCH_H__
+#include "zetta_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Batch dispatch: instead of one handler call per frame, consecutive frames
+// of the same type are collected and handed over in a single on_batch call.
+// Payloads are copied into an application supplied arena, the views stay
+// valid until on_batch returns.
+//
+// A batch is flushed when the type changes, the arena or view table is full
+// and at the end of every zetta_ProcessBufferBatch call.
+
+typedef struct
+{
+    const uint8_t* data;
+    uint8_t len;
+} ZettaPayloadView_t;
+
+typedef void (*ZettaBatchHandler)(void* ctx, uint8_t type,
+                                  const ZettaPayloadView_t* views,
+                                  uint16_t count);
+
+typedef struct
+{
+    uint8_t* arena;
+    uint16_t arena_size;
+    uint16_t arena_used;
+    ZettaPayloadView_t* views;
+    uint16_t max_views;
+    uint16_t count;
+    uint8_t type;
+    ZettaBatchHandler on_batch;
+    void* ctx;
+    uint32_t batches; // on_batch calls
+    uint32_t frames;  // frames delivered
+} ZettaBatch_t;
+
+// arena_size should hold at least MAX_PAYLOAD_SIZE bytes
+void zetta_batch_init(ZettaBatch_t* batch, uint8_t* arena, uint16_t arena_size,
+                      ZettaPayloadView_t* views, uint16_t max_views,
+                      ZettaBatchHandler on_batch, void* ctx);
+// Parse a buffer and dispatch its frames in batches, returns the number of
+// frames delivered
+uint16_t zetta_ProcessBufferBatch(Zetta_t* hzetta, ZettaBatch_t* batch,
+                                  const uint8_t* pData, uint16_t size);
+// Add the frame that was just parsed by zetta_ParseByte
+void zetta_batch_add(ZettaBatch_t* batch, Zetta_t* hzetta);
+void zetta_batch_flush(ZettaBatch_t* batch);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,80 @@
+#ifndef ZETTA_BATCH_HPP__
+#define ZETTA_BATCH_HPP__
+#include "zetta_batch.h"
+#include <stddef.h>
+#include <type_traits>
+
+// C++ front end of zetta_batch.h. Storage is sized at compile time and any
+// callable taking (uint8_t type, zetta::PayloadSpan views) can be used as
+// the batch handler:
+//
+//   zetta::BatchDispatcher<512, 64> batch;
+//   batch.process(hzetta, rx_buf, n, [](uint8_t type, zetta::PayloadSpan views)
+//   {
+//       for (const ZettaPayloadView_t& v : views) { ... }
+//   });
+
+namespace zetta
+{
+
+class PayloadSpan
+{
+  public:
+    PayloadSpan(const ZettaPayloadView_t* views, uint16_t count)
+        : views_(views), count_(count)
+    {
+    }
+    const ZettaPayloadView_t* begin() const { return views_; }
+    const ZettaPayloadView_t* end() const { return views_ + count_; }
+    const ZettaPayloadView_t& operator[](size_t i) const { return views_[i]; }
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+  private:
+    const ZettaPayloadView_t* views_;
+    uint16_t count_;
+};
+
+template <uint16_t ArenaSize, uint16_t MaxViews>
+class BatchDispatcher
+{
+    static_assert(ArenaSize >= MAX_PAYLOAD_SIZE,
+                  "arena must hold at least one payload");
+
+  public:
+    BatchDispatcher()
+    {
+        zetta_batch_init(&batch_, arena_, ArenaSize, views_, MaxViews, nullptr,
+                         nullptr);
+    }
+
+    // Parse a buffer and call handler once per run of same-type frames,
+    // returns the number of frames delivered
+    template <typename Handler>
+    uint16_t process(Zetta_t* hzetta, const uint8_t* data, uint16_t size,
+                     Handler&& handler)
+    {
+        batch_.on_batch = &trampoline<Handler>;
+        batch_.ctx = &handler;
+        return zetta_ProcessBufferBatch(hzetta, &batch_, data, size);
+    }
+
+    uint32_t batches() const { return batch_.batches; }
+    uint32_t frames() const { return batch_.frames; }
+
+  private:
+    template <typename Handler>
+    static void trampoline(void* ctx, uint8_t type,
+                           const ZettaPayloadView_t* views, uint16_t count)
+    {
+        (*static_cast<typename std::remove_reference<Handler>::type*>(ctx))(
+            type, PayloadSpan(views, count));
+    }
+
+    ZettaBatch_t batch_;
+    uint8_t arena_[ArenaSize];
+    ZettaPayloadView_t views_[MaxViews];
+};
+
+} // namespace zetta
+#endif
@@ -0,0 +1,81 @@
+#ifndef ZETTA_BULK_H__
+#define ZETTA_BULK_H__
+#include "zetta_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bulk messages with preemption.
+// A message larger than one frame is sent as MSG_BULK fragments, one per
+// zetta_bulk_poll call. An urgent frame never waits for the whole message:
+// it goes out at the next fragment boundary and the message resumes after
+// it, so urgent latency is bounded by one fragment time. The fragment
+// header marks where a message starts and ends, the receiver reassembles
+// the message and hands it over once complete.
+
+#define ZETTA_BULK_HDR 4 // flags|id, type, offset (u16)
+#define ZETTA_BULK_FRAG_DATA (MAX_PAYLOAD_SIZE - ZETTA_BULK_HDR)
+
+#define ZB_FLAG_FIRST 0x80
+#define ZB_FLAG_LAST 0x40
+#define ZB_ID_MASK 0x3F
+
+typedef void (*ZettaBulkHandler)(void* ctx, uint8_t type, const uint8_t* data,
+                                 uint16_t len);
+
+typedef struct
+{
+    uint8_t type;      // packet type of fragments, MSG_BULK
+    uint8_t frag_size; // data bytes per fragment, 1..ZETTA_BULK_FRAG_DATA
+
+    // sender, data is owned by the application until zetta_bulk_busy is 0
+    const uint8_t* tx_data;
+    uint16_t tx_len;
+    uint16_t tx_off;
+    uint8_t tx_type;
+    uint8_t tx_id;
+    uint8_t tx_active;
+
+    // one urgent frame waiting for the next fragment boundary
+    uint8_t urgent_pending;
+    uint8_t urgent_type;
+    uint8_t urgent_len;
+    uint8_t urgent[MAX_PAYLOAD_SIZE];
+
+    // receiver
+    uint8_t* rx_buf;
+    uint16_t rx_size;
+    uint16_t rx_len;
+    uint8_t rx_id;
+    uint8_t rx_type;
+    uint8_t rx_active;
+    ZettaBulkHandler on_message;
+    void* ctx;
+
+    uint32_t preemptions; // urgent frames sent inside a bulk message
+    uint32_t tx_aborted;  // messages ended by a fragment zetta_send rejected
+    uint32_t rx_messages;
+    uint32_t rx_dropped; // incomplete or oversized messages
+} ZettaBulk_t;
+
+void zetta_bulk_init(ZettaBulk_t* bulk, uint8_t* rx_buf, uint16_t rx_size,
+                     ZettaBulkHandler on_message, void* ctx);
+// Start sending a message, fragments go out from zetta_bulk_poll
+ZettaError_t zetta_bulk_send(ZettaBulk_t* bulk, uint8_t type, const void* pData,
+                             uint16_t len);
+uint8_t zetta_bulk_busy(ZettaBulk_t* bulk);
+// Send now when TX is idle, otherwise at the next fragment boundary
+ZettaError_t zetta_bulk_urgent(ZettaBulk_t* bulk, Zetta_t* hzetta, uint8_t type,
+                               const void* pData, uint8_t len);
+// Call from the main loop, sends at most one frame while TX is idle. Any
+// error but TX_BUSY drops the urgent frame or ends the message.
+ZettaError_t zetta_bulk_poll(ZettaBulk_t* bulk, Zetta_t* hzetta);
+// Handle the payload of a received MSG_BULK frame
+ZettaError_t zetta_bulk_handle(ZettaBulk_t* bulk, const uint8_t* pData,
+                               uint8_t len);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,97 @@
+#ifndef ZETTA_CAPTURE_H__
+#define ZETTA_CAPTURE_H__
+#include "zetta_protocol.h"
+
+// Triggered burst capture.
+// Samples are pushed at acquisition rate into a ring buffer owned by the
+// application. When the trigger fires the window of `pre` samples before and
+// `post` samples after it is frozen and drained to the host as MSG_CAPTURE
+// frames by zetta_capture_poll, one frame per call and only while the link
+// is idle, so live traffic keeps flowing.
+
+#define ZETTA_CAPTURE_DATA_HDR 4 // msg, id, index (u16)
+#define ZETTA_CAPTURE_MAX_SAMPLE_SIZE (MAX_PAYLOAD_SIZE - ZETTA_CAPTURE_DATA_HDR)
+
+typedef enum
+{
+    ZC_STATE_IDLE,
+    ZC_STATE_ARMED,     // filling the pre-trigger ring
+    ZC_STATE_TRIGGERED, // collecting post-trigger samples
+    ZC_STATE_DRAINING,  // sending the window to the host
+} ZettaCaptureState_t;
+
+// MSG_CAPTURE payload[0], host -> device
+typedef enum
+{
+    ZC_CMD_CONFIGURE = 0x00, // [cmd, pre u16, post u16, flags]
+    ZC_CMD_ARM = 0x01,       // [cmd]
+    ZC_CMD_DISARM = 0x02,    // [cmd]
+    ZC_CMD_TRIGGER = 0x03,   // [cmd] software trigger
+    ZC_CMD_LEVEL = 0x04,     // [cmd, offset, width, mode, level i32]
+} ZettaCaptureCmd_t;
+
+// MSG_CAPTURE payload[0], device -> host
+typedef enum
+{
+    ZC_MSG_BEGIN = 0x80, // [msg, id, total u16, pre u16, sample_size]
+    ZC_MSG_DATA = 0x81,  // [msg, id, index u16, samples...]
+    ZC_MSG_END = 0x82,   // [msg, id, total u16, overruns u16]
+} ZettaCaptureMsg_t;
+
+typedef enum
+{
+    ZC_LEVEL_OFF = 0,
+    ZC_LEVEL_ABOVE,   // fires while field > level
+    ZC_LEVEL_BELOW,   // fires while field < level
+    ZC_LEVEL_RISING,  // fires when field crosses level upwards
+    ZC_LEVEL_FALLING, // fires when field crosses level downwards
+} ZettaCaptureLevel_t;
+
+#define ZC_FLAG_REARM 0x01 // arm again once a capture has been drained
+
+typedef struct
+{
+    uint8_t* buf;        // capacity * sample_size bytes, owned by the app
+    uint16_t capacity;   // in samples
+    uint8_t sample_size; // bytes per sample
+    uint8_t type;        // packet type used for the drain, MSG_CAPTURE
+    uint16_t pre;
+    uint16_t post;
+    uint8_t flags;
+    uint8_t id; // incremented for each capture
+
+    // level trigger, evaluated on each pushed sample
+    uint8_t level_mode;
+    uint8_t level_offset;
+    uint8_t level_width; // 1, 2 or 4 signed little endian
+    int32_t level;
+    int32_t last_value;
+
+    volatile uint8_t state;
+    volatile uint16_t head;   // next write position
+    volatile uint16_t filled; // valid samples in the ring
+    volatile uint16_t remaining;
+    uint16_t start; // first sample of the frozen window
+    uint16_t total; // samples in the frozen window
+    uint16_t sent;  // samples already drained
+    uint8_t begin_sent;
+    uint16_t overruns; // samples pushed while draining
+    uint16_t aborted;  // drains ended by a frame zetta_send rejected
+} ZettaCapture_t;
+
+ZettaError_t zetta_capture_init(ZettaCapture_t* cap, uint8_t* buf,
+                                uint16_t capacity, uint8_t sample_size);
+ZettaError_t zetta_capture_configure(ZettaCapture_t* cap, uint16_t pre,
+                                     uint16_t post, uint8_t flags);
+ZettaError_t zetta_capture_arm(ZettaCapture_t* cap);
+void zetta_capture_disarm(ZettaCapture_t* cap);
+void zetta_capture_trigger(ZettaCapture_t* cap);
+// Call at acquisition rate (ISR safe), sample is sample_size bytes
+void zetta_capture_push(ZettaCapture_t* cap, const void* sample);
+// Call from the main loop, sends at most one frame when TX is idle. Any
+// error but TX_BUSY ends the drain, the host sees a capture without END.
+ZettaError_t zetta_capture_poll(ZettaCapture_t* cap, Zetta_t* hzetta);
+// Handle the payload of a received MSG_CAPTURE frame
+ZettaError_t zetta_capture_handle(ZettaCapture_t* cap, const uint8_t* pData,
+                                  uint8_t len);
+#endif
@@ -0,0 +1,60 @@
+#ifndef ZETTA_CHECK_H__
+#define ZETTA_CHECK_H__
+#include "zetta_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Software integrity checks, selectable per link with zetta_use_check.
+// All have the ZettaComputeCRC signature, run over TYPE, LEN and payload and
+// go on the wire little endian. Cheapest first:
+//
+//   XOR8        1 byte   misses any even number of flips in one bit column
+//   FLETCHER16  2 bytes  sums mod 255, misses 0x00 <-> 0xFF swaps
+//   ADLER16     2 bytes  sums mod 251 (prime), no byte value is invisible
+//   CRC8        1 byte   poly 0x07, init 0xFF: the classic Zetta check
+//   ADLER32     4 bytes  zlib Adler-32
+//   CRC16       2 bytes  CCITT-FALSE, all bursts up to 16 bits
+//   CRC32       4 bytes  IEEE 802.3 (zlib crc32), all bursts up to 32 bits
+//
+// CRC8 uses a 256 byte table, CRC16 and CRC32 use 16 entry (nibble) tables to
+// keep flash small. examples/zetta_check_bench.c measures cost and
+// undetected errors of every check.
+
+typedef enum
+{
+    ZETTA_CHECK_XOR8 = 0,
+    ZETTA_CHECK_FLETCHER16,
+    ZETTA_CHECK_ADLER16,
+    ZETTA_CHECK_CRC8,
+    ZETTA_CHECK_ADLER32,
+    ZETTA_CHECK_CRC16,
+    ZETTA_CHECK_CRC32,
+    ZETTA_CHECK_COUNT,
+} ZettaCheckId_t;
+
+typedef struct
+{
+    const char* name;
+    ZettaComputeCRC compute;
+    uint8_t size; // bytes on the wire
+} ZettaCheck_t;
+
+extern const ZettaCheck_t zetta_checks[ZETTA_CHECK_COUNT];
+
+uint32_t zetta_xor8(uint32_t* data, uint32_t size);
+uint32_t zetta_fletcher16(uint32_t* data, uint32_t size);
+uint32_t zetta_adler16(uint32_t* data, uint32_t size);
+uint32_t zetta_crc8(uint32_t* data, uint32_t size);
+uint32_t zetta_adler32(uint32_t* data, uint32_t size);
+uint32_t zetta_crc16(uint32_t* data, uint32_t size);
+uint32_t zetta_crc32(uint32_t* data, uint32_t size);
+
+// Both ends of a link must use the same check
+ZettaError_t zetta_use_check(Zetta_t* hzetta, ZettaCheckId_t id);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
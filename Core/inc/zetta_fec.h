@@ -0,0 +1,104 @@
+#ifndef ZETTA_FEC_H__
+#define ZETTA_FEC_H__
+#include "zetta_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Inter-frame XOR parity.
+// Frames sent through zetta_fec_send travel as MSG_FEC frames in groups of
+// N. After the last frame of a group, a parity frame carries the XOR of the
+// group's types, lengths and payloads. The receiver delivers data frames as
+// they arrive and rebuilds any single lost frame of a group from the parity,
+// with no round trip, at a cost of one frame per N.
+// N adapts to the frame loss rate p: the largest N whose residual loss
+// N * p^2 stays under the target. The loss rate comes from the peer's loss
+// reports or, on one-way links, from zetta_fec_set_loss.
+//
+//   data:   [group, N << 4 | index, type, payload...]
+//   parity: [group, K << 4 | K, xor types, xor lengths, xor payloads...]
+//   report: [0xFF, 0x00, loss u16]
+//
+// K is the number of data frames covered, N unless the group was closed
+// early by the flush timeout.
+
+#define ZETTA_FEC_HDR 3
+#define ZETTA_FEC_DATA (MAX_PAYLOAD_SIZE - ZETTA_FEC_HDR - 1) // parity has one more
+#define ZETTA_FEC_MIN_N 2
+#define ZETTA_FEC_MAX_N 15
+#define ZETTA_FEC_EWMA_SHIFT 10      // loss rate over about 1000 frame slots
+#define ZETTA_FEC_DEFAULT_TARGET 66  // residual loss 0.1%, 65535 = 100%
+
+typedef void (*ZettaFecHandler)(void* ctx, uint8_t type, const uint8_t* data,
+                                uint8_t len, uint8_t recovered);
+
+typedef struct
+{
+    uint32_t tx_frames;
+    uint32_t tx_parity;
+    uint32_t tx_parity_lost; // parity frames zetta_send rejected
+    uint32_t rx_frames;
+    uint32_t recovered;
+    uint32_t lost;          // data frames neither received nor rebuilt
+    uint32_t unrecoverable; // groups with more than one frame lost
+    uint16_t loss_ewma;     // of received frame slots, 65535 = 100% lost
+} ZettaFecStats_t;
+
+typedef struct
+{
+    uint8_t type; // packet type of FEC frames, MSG_FEC
+
+    // sender
+    uint8_t n;       // group size of the current group
+    uint8_t n_fixed; // 0: adaptive
+    uint16_t target; // residual loss target, 65535 = 100%
+    uint16_t tx_loss;
+    uint8_t tx_group;
+    uint8_t tx_index;
+    uint8_t tx_type_x;
+    uint8_t tx_len_x;
+    uint8_t tx_max_len;
+    uint8_t tx_parity[ZETTA_FEC_DATA];
+    uint8_t parity_pending;
+    uint32_t last_tx;
+    uint16_t flush; // ms without data before a partial group gets its parity
+
+    // receiver
+    uint8_t rx_group;
+    uint8_t rx_n;
+    uint8_t rx_open;   // group collecting, no parity seen yet
+    uint8_t rx_synced; // a group was seen
+    uint16_t rx_mask;  // bit i: data frame i of the group received
+    uint8_t rx_type_x;
+    uint8_t rx_len_x;
+    uint8_t rx_x[ZETTA_FEC_DATA];
+    uint32_t loss_acc; // loss EWMA, 2^32 = 100%
+    uint16_t report_interval; // ms, 0: no loss reports (one-way links)
+    uint32_t last_report;
+    ZettaFecHandler on_frame;
+    void* ctx;
+
+    ZettaFecStats_t stats;
+} ZettaFec_t;
+
+void zetta_fec_init(ZettaFec_t* fec, ZettaFecHandler on_frame, void* ctx);
+// 0 for adaptive, otherwise ZETTA_FEC_MIN_N..ZETTA_FEC_MAX_N
+ZettaError_t zetta_fec_set_group(ZettaFec_t* fec, uint8_t n);
+void zetta_fec_set_target(ZettaFec_t* fec, uint16_t target);
+// Loss rate for the adaptive N when the peer cannot report it
+void zetta_fec_set_loss(ZettaFec_t* fec, uint16_t loss);
+uint8_t zetta_fec_group_size(uint16_t loss, uint16_t target);
+// Send one frame, never waits: ZETTA_ERROR_TX_BUSY means try again later
+ZettaError_t zetta_fec_send(ZettaFec_t* fec, Zetta_t* hzetta, uint8_t type,
+                            const void* pData, uint8_t len, uint32_t now);
+// Call from the main loop: pending parity, flush timeout and loss reports
+ZettaError_t zetta_fec_poll(ZettaFec_t* fec, Zetta_t* hzetta, uint32_t now);
+// Handle the payload of a received MSG_FEC frame
+ZettaError_t zetta_fec_handle(ZettaFec_t* fec, const uint8_t* pData,
+                              uint8_t len);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
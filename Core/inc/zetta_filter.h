@@ -0,0 +1,94 @@
+#ifndef ZETTA_FILTER_H__
+#define ZETTA_FILTER_H__
+#include "zetta_protocol.h"
+
+// Host uploaded publish filters.
+// A filter is a small BPF like program run by zetta_send over the payload of
+// every frame of its target type. Programs only jump forward, so they always
+// terminate in at most ZETTA_FILTER_MAX_INSNS steps, and are checked by
+// zetta_filter_verify before they become active.
+
+#define ZETTA_FILTER_MAX_INSNS 32
+#define ZETTA_FILTER_MEM_WORDS 4
+#define ZETTA_FILTER_INSN_SIZE 8 // op, arg, jt, jf, k (int32 little endian)
+#define ZETTA_FILTER_INSNS_PER_FRAME 2
+
+typedef enum
+{
+    ZF_OP_RET = 0, // return k: 0 drops the frame, anything else publishes it
+    ZF_OP_LDI,     // A = k
+    ZF_OP_LD_U8,   // A = payload[arg]
+    ZF_OP_LD_I8,
+    ZF_OP_LD_U16,
+    ZF_OP_LD_I16,
+    ZF_OP_LD_I32,
+    ZF_OP_LD_F32, // A = (int32)(float at payload[arg] * k), saturated
+    ZF_OP_LD_LEN, // A = payload length
+    ZF_OP_LD_CNT, // A = number of previous runs of this program
+    ZF_OP_LDM,    // A = M[arg]
+    ZF_OP_ST,     // M[arg] = A, memory is kept between runs
+    ZF_OP_ADD,    // A = A + k
+    ZF_OP_SUB,
+    ZF_OP_MUL,
+    ZF_OP_MOD, // k != 0
+    ZF_OP_AND,
+    ZF_OP_NEG,
+    ZF_OP_SUBM, // A = A - M[arg]
+    ZF_OP_JA,   // pc += jt
+    ZF_OP_JEQ,  // pc += (A == k) ? jt : jf
+    ZF_OP_JGT,  // signed
+    ZF_OP_JGE,  // signed
+    ZF_OP_JSET, // pc += (A & k) ? jt : jf
+    ZF_OP_COUNT,
+} ZettaFilterOp_t;
+
+// MSG_FILTER payload: [cmd, slot, ...]
+typedef enum
+{
+    ZF_CMD_CLEAR = 0,  // [cmd, slot] disable the slot
+    ZF_CMD_LOAD = 1,   // [cmd, slot, index, insns...] stage instructions
+    ZF_CMD_COMMIT = 2, // [cmd, slot, type, count] verify and enable
+} ZettaFilterCmd_t;
+
+typedef struct
+{
+    uint8_t op;
+    uint8_t arg; // payload offset or memory index
+    uint8_t jt;  // forward jump when the condition holds
+    uint8_t jf;  // forward jump otherwise
+    int32_t k;
+} ZettaFilterInsn_t;
+
+typedef struct
+{
+    ZettaFilterInsn_t insns[ZETTA_FILTER_MAX_INSNS];
+    int32_t mem[ZETTA_FILTER_MEM_WORDS];
+    uint32_t runs;
+    uint32_t passed;
+    uint32_t dropped;
+    uint8_t count;
+    uint8_t type;
+    uint8_t active;
+} ZettaFilter_t;
+
+typedef struct
+{
+    ZettaFilter_t* slots;
+    uint8_t nslots;
+} ZettaFilterSet_t;
+
+// Attach a filter table to a Zetta instance, zetta_send then runs the active
+// filter of the frame type (if any) and returns ZETTA_FILTERED on drop.
+void zetta_filter_attach(Zetta_t* hzetta, ZettaFilterSet_t* set,
+                         ZettaFilter_t* slots, uint8_t nslots);
+// Handle the payload of a received MSG_FILTER frame
+ZettaError_t zetta_filter_handle(ZettaFilterSet_t* set, const uint8_t* pData,
+                                 uint8_t len);
+ZettaError_t zetta_filter_load(ZettaFilter_t* filter, uint8_t type,
+                               const ZettaFilterInsn_t* insns, uint8_t count);
+ZettaError_t zetta_filter_verify(const ZettaFilterInsn_t* insns,
+                                 uint8_t count);
+uint8_t zetta_filter_run(ZettaFilter_t* filter, const uint8_t* pData,
+                         uint8_t len);
+void zetta_filter_clear(ZettaFilter_t* filter);
+#endif
@@ -0,0 +1,103 @@
+#ifndef ZETTA_LINK_H__
+#define ZETTA_LINK_H__
+#include "zetta_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Heartbeat, liveness and failover of one logical link over several
+// physical Zetta_t instances (primary first, then standbys).
+// Every path is probed with MSG_LINK pings when nothing else was sent on it
+// for `interval` ms. A path is declared down when nothing was received for
+// its adaptive timeout:
+//
+//   timeout = max(interval + srtt + 4 * rttvar, gap_avg + 4 * gap_dev)
+//
+// clamped to [min_timeout, max_timeout], counted from the first poll for a
+// path that never received anything. While the active path is not up the
+// link switches to the first path that is, moving the sequence number hooks
+// and the queued frames to it.
+
+#define ZETTA_LINK_MAX_PATHS 3
+#define ZETTA_LINK_TXQ_DEPTH 8
+#define ZETTA_LINK_PROBE_EVERY 4 // ping at least every 4 intervals (RTT)
+
+// MSG_LINK payload: [op, seq, t0 u32]
+typedef enum
+{
+    ZL_OP_PING = 0x00,
+    ZL_OP_PONG = 0x01, // echoes seq and t0 of the ping
+} ZettaLinkOp_t;
+
+typedef enum
+{
+    ZL_PATH_UNKNOWN = 0, // nothing received yet
+    ZL_PATH_UP,
+    ZL_PATH_DOWN,
+} ZettaLinkPathState_t;
+
+typedef struct
+{
+    Zetta_t* hzetta;
+    uint8_t state;
+    uint8_t ping_seq;
+    uint8_t polled; // last_rx holds the first poll until something arrived
+    uint32_t last_rx;
+    uint32_t last_tx;
+    uint32_t last_ping;
+    uint32_t tx_frames; // stats.tx_frames seen at the last poll
+    // RTT estimator in 1/8 ms (srtt) and 1/4 ms (rttvar), as in TCP
+    uint32_t srtt8;
+    uint32_t rttvar4;
+    // RX gap estimator in 1/8 ms
+    uint32_t gap8;
+    uint32_t gapdev4;
+    uint32_t timeout;
+    uint32_t downs;
+} ZettaLinkPath_t;
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t len;
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+} ZettaLinkFrame_t;
+
+typedef struct ZettaLink_t ZettaLink_t;
+typedef void (*ZettaLinkFailover)(ZettaLink_t* link, uint8_t from, uint8_t to);
+
+typedef struct ZettaLink_t
+{
+    ZettaLinkPath_t paths[ZETTA_LINK_MAX_PATHS];
+    uint8_t npaths;
+    uint8_t active;
+    uint8_t type; // packet type of heartbeats, MSG_LINK
+    uint16_t interval;
+    uint16_t min_timeout;
+    uint16_t max_timeout;
+    ZettaLinkFailover on_failover;
+    ZettaLinkFrame_t txq[ZETTA_LINK_TXQ_DEPTH];
+    uint8_t txq_head;
+    uint8_t txq_count;
+    uint32_t failovers;
+    uint32_t txq_dropped; // queue full, or rejected by zetta_send
+} ZettaLink_t;
+
+void zetta_link_init(ZettaLink_t* link, uint16_t interval,
+                     uint16_t min_timeout, uint16_t max_timeout);
+ZettaError_t zetta_link_add_path(ZettaLink_t* link, Zetta_t* hzetta);
+// Send on the active path, queued while its TX is busy
+ZettaError_t zetta_link_send(ZettaLink_t* link, uint8_t type,
+                             const void* pData, uint8_t len);
+// Call for every frame received on a path; MSG_LINK frames are consumed
+// (returns 1), other frames only refresh the path liveness (returns 0)
+uint8_t zetta_link_on_rx(ZettaLink_t* link, Zetta_t* hzetta, uint32_t now);
+// Call from the main loop: heartbeats, timeouts, failover and TX queue
+void zetta_link_poll(ZettaLink_t* link, uint32_t now);
+Zetta_t* zetta_link_active(ZettaLink_t* link);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
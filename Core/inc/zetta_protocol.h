@@ -4,13 +4,32 @@
 #include <stdint.h>
 #include <string.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define START_BYTE 0xAA
 #define STOP_BYTE 0xBC
 #define MAX_PAYLOAD_SIZE 25
 #define USE_HARDWARE_CRC 1
+// Frames whose TYPE byte was never registered are still delivered (raw type
+// value) so that older firmware keeps working when a peer adds new types.
+// Set to 0 to reject them with ZETTA_ERROR_TYPE instead.
+#define ZETTA_ACCEPT_UNKNOWN_TYPES 1
+#define ZETTA_TYPE_MAP_SIZE (256 / 8)
+// Largest integrity check, the default is one byte (see zetta_check.h)
+#define ZETTA_MAX_CHECK_SIZE 4
+// Largest timestamp field in front of the payload (see zetta_time.h)
+#define ZETTA_MAX_TIME_FIELD 5
+// Implicit length: entries of a size table, one per TYPE byte. Frames of a
+// type with a fixed size carry no LEN byte, the entry is the LEN the frame
+// would carry (sequence byte included). Timestamped types must stay variable.
+#define ZETTA_SIZE_TABLE_LEN 256
+#define ZETTA_SIZE_VARIABLE 0xFF
 
 typedef struct Zetta_t Zetta_t;
-// This represents the raw structure on the wire
+// This represents the raw structure on the wire, only check_size bytes of
+// crc are sent
 #pragma pack(push, 1)
 typedef struct
 {
@@ -18,7 +37,7 @@ typedef struct
     uint8_t type;
     uint8_t len;
     uint8_t payload[MAX_PAYLOAD_SIZE];
-    uint8_t crc;
+    uint8_t crc[ZETTA_MAX_CHECK_SIZE];
     uint8_t stop;
 } ZettaFrame_t;
 #pragma pack(pop)
@@ -29,6 +48,12 @@ typedef enum __attribute__((packed))
     MSG_ACK = 0,
     MSG_PUBLISH = 1,
     MSG_SUBSCRIBE = 2,
+    MSG_FILTER = 3, // filter program upload (see zetta_filter.h)
+    MSG_CAPTURE = 4, // burst capture control and data (see zetta_capture.h)
+    MSG_LINK = 5,    // heartbeats (see zetta_link.h)
+    MSG_BULK = 6,    // fragments of large messages (see zetta_bulk.h)
+    MSG_ROUTE = 7,   // mesh routing (see zetta_route.h)
+    MSG_FEC = 8,     // parity protected frames (see zetta_fec.h)
 } ZettaPacketType_t;
 typedef enum
 {
@@ -53,8 +78,22 @@ typedef enum
     ZETTA_ERROR_TIMEOUT,
     ZETTA_ERROR_TX_BUSY,
     ZETTA_ERROR_RX_BUSY,
+    ZETTA_FILTERED, // frame dropped by a TX hook, nothing was sent
+    ZETTA_ERROR_LENGTH, // payload differs from the fixed size of its type
+    ZETTA_ERROR_COUNT,
 } ZettaError_t;
 
+// Link counters, updated by the parser and zetta_send
+typedef struct
+{
+    uint32_t rx_frames;
+    uint32_t rx_bytes;
+    uint32_t tx_frames;
+    uint32_t tx_bytes;
+    uint32_t tx_filtered;
+    uint32_t errors[ZETTA_ERROR_COUNT]; // indexed by ZettaError_t
+} ZettaStats_t;
+
 typedef enum
 {
     ZETTA_STATE_TX_BUSY,
@@ -70,6 +109,51 @@ typedef uint32_t (*ZettaComputeCRC)(uint32_t* data, uint32_t size);
 typedef void (*ZettaTransmitCpltClbk)(Zetta_t* packet);
 typedef void (*ZettaReceiveCpltClbk)(Zetta_t* packet);
 typedef void (*HandleError)(Zetta_t* hzetta, ZettaError_t error);
+// Called by zetta_send before a frame is built, return 0 to drop the frame
+typedef uint8_t (*ZettaTxHook)(Zetta_t* hzetta, uint8_t type,
+                               const void* data, uint8_t len);
+
+// Sequence number hooks (see zetta_seq.h). The TX hook returns the sequence
+// byte to prepend to the payload or -1, the RX hook returns 1 when the first
+// payload byte of a frame of that type is a sequence number.
+typedef int16_t (*ZettaSeqTxHook)(void* ctx, uint8_t type);
+typedef uint8_t (*ZettaSeqRxHook)(void* ctx, uint8_t type, uint8_t seq);
+
+// Timestamp hooks (see zetta_time.h), the field follows the sequence byte.
+// The TX hook writes the field of a frame of that type and returns its size,
+// 0 for types without timestamps. The RX hook returns the size of the field at
+// the start of data, 0 for types without timestamps, -1 when it is truncated.
+typedef uint8_t (*ZettaTimeTxHook)(void* ctx, uint8_t type, uint8_t* field);
+typedef int8_t (*ZettaTimeRxHook)(void* ctx, uint8_t type, const uint8_t* data,
+                                  uint8_t len);
+// Header sizes for the streaming consumer, which sees the payload before the
+// RX hooks run. Same contexts and results as the RX hooks but without side
+// effects; the time hook may return the size as soon as data holds enough
+// bytes to tell it. Without them the header is streamed as payload.
+typedef uint8_t (*ZettaSeqSizeHook)(void* ctx, uint8_t type);
+typedef int8_t (*ZettaTimeSizeHook)(void* ctx, uint8_t type,
+                                    const uint8_t* data, uint8_t len);
+// With a commit hook the time TX hook only writes the field and zetta_send
+// advances the encoder through the commit hook once the frame went to
+// interface.send, so a frame it rejects leaves the encoder alone. Likewise
+// seq_tx only runs after the checks when the seq size hook is set.
+typedef void (*ZettaTimeCommitHook)(void* ctx, uint8_t type, uint8_t size);
+
+// Streaming RX consumer, payload bytes are handed out while the frame is still
+// being parsed. Nothing may be trusted before onCommit (CRC checked), onAbort
+// is called instead when the frame turns out to be invalid.
+// The sequence byte and timestamp field are not streamed: onBegin is called
+// once their size is known (at most two payload bytes in), len and offset
+// count the bytes after them, as Zetta_GetPayload does. This needs the size
+// hooks, which zetta_seq_attach and zetta_time_attach install.
+typedef struct
+{
+    void (*onBegin)(Zetta_t* hzetta, uint8_t type, uint8_t len);
+    void (*onChunk)(Zetta_t* hzetta, const uint8_t* data, uint8_t offset,
+                    uint8_t len);
+    void (*onCommit)(Zetta_t* hzetta);
+    void (*onAbort)(Zetta_t* hzetta, ZettaError_t error);
+} ZettaStreamConsumer_t;
 
 typedef struct
 {
@@ -93,6 +177,28 @@ typedef struct Zetta_t
         ZettaError_t error;
         ZettaFrameRxState_t rx_frame_state;
         uint8_t payload_ready ; 
+        uint8_t type_map[ZETTA_TYPE_MAP_SIZE]; // registered TYPE bytes
+        ZettaTxHook tx_hook;
+        void* tx_hook_ctx;
+        const ZettaStreamConsumer_t* stream;
+        uint8_t stream_chunk;    // bytes per onChunk call
+        uint8_t stream_sent;     // payload bytes already handed out
+        uint8_t stream_active;   // onBegin called, waiting for the verdict
+        uint8_t stream_header;   // header bytes not streamed, 0xFF until known
+        ZettaStats_t stats;
+        ZettaSeqTxHook seq_tx;
+        ZettaSeqRxHook seq_rx;
+        ZettaSeqSizeHook seq_size;
+        void* seq_ctx;
+        ZettaTimeTxHook time_tx;
+        ZettaTimeRxHook time_rx;
+        ZettaTimeSizeHook time_size;
+        ZettaTimeCommitHook time_commit;
+        void* time_ctx;
+        uint8_t payload_offset; // header bytes at the start of the payload
+        uint8_t check_size;     // check bytes on the wire, little endian
+        uint8_t check_index;
+        const uint8_t* sizes; // implicit length table, NULL: LEN in every frame
     } _internal;
 
 } Zetta_t;
@@ -104,10 +210,40 @@ ZettaError_t zetta_ParseByte(Zetta_t* packet, uint8_t byte);
 ZettaError_t zetta_ProcessBuffer(Zetta_t* packet, uint8_t* pData,
                                  uint16_t size);
 void Zetta_GetPayload(Zetta_t* hzetta, void* pDest);
+uint8_t Zetta_GetLength(Zetta_t* hzetta);
 ZettaPacketType_t Zetta_GetType(Zetta_t* hzetta);
+// Type registry: built-in types are registered by zetta_init
+void zetta_register_type(Zetta_t* hzetta, uint8_t type);
+void zetta_unregister_type(Zetta_t* hzetta, uint8_t type);
+uint8_t zetta_is_type_registered(Zetta_t* hzetta, uint8_t type);
+void zetta_set_tx_hook(Zetta_t* hzetta, ZettaTxHook hook, void* ctx);
+void zetta_set_seq_hooks(Zetta_t* hzetta, ZettaSeqTxHook tx, ZettaSeqRxHook rx,
+                         void* ctx);
+void zetta_set_time_hooks(Zetta_t* hzetta, ZettaTimeTxHook tx,
+                          ZettaTimeRxHook rx, void* ctx);
+// Called with the context of the hooks above, which clear them
+void zetta_set_seq_size_hook(Zetta_t* hzetta, ZettaSeqSizeHook size);
+void zetta_set_time_size_hook(Zetta_t* hzetta, ZettaTimeSizeHook size);
+void zetta_set_time_commit_hook(Zetta_t* hzetta, ZettaTimeCommitHook commit);
+// Integrity check of this link, size 1, 2 or 4 bytes (default computeCRC, 1)
+ZettaError_t zetta_set_check(Zetta_t* hzetta, ZettaComputeCRC compute,
+                             uint8_t size);
+// Implicit length mode, both ends need the same table. NULL turns it off.
+void zetta_set_size_table(Zetta_t* hzetta, const uint8_t* sizes);
+// Fill a table with ZETTA_SIZE_VARIABLE, then set the fixed size types
+void zetta_size_table_init(uint8_t* sizes);
+const ZettaStats_t* zetta_get_stats(Zetta_t* hzetta);
+void zetta_reset_stats(Zetta_t* hzetta);
+// chunk_size 0 hands out the whole payload once it is complete
+void zetta_set_stream_consumer(Zetta_t* hzetta,
+                               const ZettaStreamConsumer_t* consumer,
+                               uint8_t chunk_size);
 void zetta_recieve_cplt_clb(Zetta_t* packet) __attribute__((weak));
 void zetta_transmit_cplt_clb(Zetta_t* packet) __attribute__((weak));
 void zetta_error_manager(Zetta_t* packet, ZettaError_t error);
 ZettaError_t zetta_send(Zetta_t* packet, ZettaPacketType_t type, void* pData,
                         uint8_t len);
-#endif
\ No newline at end of file
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,130 @@
+#ifndef ZETTA_ROUTE_H__
+#define ZETTA_ROUTE_H__
+#include "zetta_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Multi-hop routing over several Zetta_t ports.
+// Every node has an address and periodically sends a distance vector on
+// each port. Vectors carry timestamps, so each port measures the RTT to its
+// neighbour, and sequence numbers, so it measures the loss. The link cost
+// (in the time unit of `now`, normally ms) is
+//
+//   cost = max(1, srtt / 2) * (256 + 4 * loss + 4 * busy) / 256
+//
+// where loss and busy (TX queue non-empty when sampled) are 0..255 EWMAs.
+// Vectors wait in the same TX queues as data, so a congested link also
+// shows a larger RTT. Routes follow the smallest summed cost (a new path
+// must be 1/8 better to replace the current one) and hold the hop count in
+// the top 4 bits of the metric: 15 hops is unreachable, which bounds
+// counting to infinity. Split horizon with poisoned reverse and triggered
+// updates make failed links converge within a few intervals.
+
+#define ZETTA_ROUTE_MAX_PORTS 4
+#define ZETTA_ROUTE_MAX_NODES 16
+#define ZETTA_ROUTE_TXQ_DEPTH 8
+#define ZETTA_ROUTE_TTL 15
+#define ZETTA_ROUTE_NONE 0xFF // no address / no port
+
+// metric = hops << 12 | cost
+#define ZETTA_ROUTE_HOPS(m) ((uint16_t)(m) >> 12)
+#define ZETTA_ROUTE_COST(m) ((uint16_t)(m) & 0x0FFF)
+#define ZETTA_ROUTE_INF 0xFFFF
+#define ZETTA_ROUTE_MAX_COST 0x0FFF
+
+// MSG_ROUTE payloads
+//   data:   [ZR_DATA, dst, src, ttl, type, payload...]
+//   vector: [ZR_VECTOR, src, seq, t_tx u16, t_echo u16, hold u16,
+//            (dest, metric u16)...]
+#define ZETTA_ROUTE_DATA_HDR 5
+#define ZETTA_ROUTE_VECTOR_HDR 9
+#define ZETTA_ROUTE_VECTOR_ENTRIES \
+    ((MAX_PAYLOAD_SIZE - ZETTA_ROUTE_VECTOR_HDR) / 3)
+
+typedef enum
+{
+    ZR_DATA = 0x00,
+    ZR_VECTOR = 0x01,
+} ZettaRouteKind_t;
+
+typedef struct
+{
+    uint8_t len;
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+} ZettaRouteFrame_t;
+
+typedef struct
+{
+    Zetta_t* hzetta;
+    uint8_t neighbor; // address heard on this port, ZETTA_ROUTE_NONE if down
+    uint8_t rx_seq;
+    uint8_t tx_seq;
+    uint8_t loss; // EWMA of missed vectors, 0..255
+    uint8_t busy; // EWMA of busy TX samples, 0..255
+    uint16_t srtt;
+    uint16_t echo_t;  // neighbour timestamp to echo
+    uint32_t echo_at; // when it was received
+    uint32_t last_rx;
+    ZettaRouteFrame_t txq[ZETTA_ROUTE_TXQ_DEPTH];
+    uint8_t txq_head;
+    uint8_t txq_count;
+    uint32_t txq_dropped;
+} ZettaRoutePort_t;
+
+typedef struct
+{
+    uint8_t dest;
+    uint8_t port;
+    uint16_t metric;
+    uint32_t updated;
+} ZettaRouteEntry_t;
+
+typedef void (*ZettaRouteDeliver)(void* ctx, uint8_t src, uint8_t type,
+                                  const uint8_t* data, uint8_t len);
+
+typedef struct
+{
+    uint8_t address;
+    uint8_t type; // packet type of routing frames, MSG_ROUTE
+    uint16_t interval;
+    uint16_t dead; // neighbour and route timeout
+    uint32_t last_vector;
+    uint8_t triggered; // send vectors at the next poll
+    ZettaRoutePort_t ports[ZETTA_ROUTE_MAX_PORTS];
+    uint8_t nports;
+    ZettaRouteEntry_t routes[ZETTA_ROUTE_MAX_NODES];
+    uint8_t nroutes;
+    ZettaRouteDeliver on_deliver;
+    void* ctx;
+
+    uint32_t delivered;
+    uint32_t forwarded;
+    uint32_t no_route;
+    uint32_t ttl_expired;
+    uint32_t changes; // next hop or reachability changes
+} ZettaRouter_t;
+
+void zetta_route_init(ZettaRouter_t* router, uint8_t address,
+                      uint16_t interval, ZettaRouteDeliver on_deliver,
+                      void* ctx);
+ZettaError_t zetta_route_add_port(ZettaRouter_t* router, Zetta_t* hzetta);
+// Send to a node, queued on the port of the next hop
+ZettaError_t zetta_route_send(ZettaRouter_t* router, uint8_t dst, uint8_t type,
+                              const void* pData, uint8_t len);
+// Call for every frame received on a port; MSG_ROUTE frames are consumed
+// (returns 1), other frames are left to the application (returns 0)
+uint8_t zetta_route_on_rx(ZettaRouter_t* router, Zetta_t* hzetta,
+                          uint32_t now);
+// Call from the main loop: vectors, timeouts and TX queues
+void zetta_route_poll(ZettaRouter_t* router, uint32_t now);
+// Route to dst, NULL when unreachable
+const ZettaRouteEntry_t* zetta_route_lookup(ZettaRouter_t* router,
+                                            uint8_t dst);
+uint16_t zetta_route_link_cost(ZettaRouter_t* router, uint8_t port);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
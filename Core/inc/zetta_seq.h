@@ -0,0 +1,53 @@
+#ifndef ZETTA_SEQ_H__
+#define ZETTA_SEQ_H__
+#include "zetta_protocol.h"
+
+// Lightweight sequence numbers without retransmission.
+// Frames of an enabled type carry one sequence byte in front of the payload
+// (one counter per type). The receiver detects gaps, late (reordered) and
+// duplicate frames and keeps loss statistics; nothing is ever acknowledged.
+// Both ends must enable the same types.
+
+#define ZETTA_SEQ_WINDOW 32     // late frames recognised up to this age
+#define ZETTA_SEQ_RESYNC 4      // consecutive stale frames before resync
+#define ZETTA_SEQ_BURST_BINS 6  // burst lengths 1, 2, 3-4, 5-8, 9-16, 17+
+#define ZETTA_SEQ_EWMA_SHIFT 5  // loss rate smoothing, 1/32 per frame
+
+typedef struct
+{
+    uint32_t received;
+    uint32_t lost; // gaps minus frames that arrived late
+    uint32_t reordered;
+    uint32_t duplicates;
+    uint32_t resyncs;
+    uint32_t bursts[ZETTA_SEQ_BURST_BINS];
+    uint16_t loss_ewma; // smoothed loss rate, 65535 = 100%
+} ZettaSeqStats_t;
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t tx_seq;
+    uint8_t rx_expected;
+    uint8_t rx_synced;
+    uint8_t stale;
+    uint32_t window; // bit i set: seq (rx_expected - 1 - i) still missing
+    ZettaSeqStats_t stats;
+} ZettaSeqChannel_t;
+
+typedef struct
+{
+    ZettaSeqChannel_t* channels;
+    uint8_t nchannels;
+    uint8_t count;
+} ZettaSeq_t;
+
+void zetta_seq_attach(Zetta_t* hzetta, ZettaSeq_t* seq,
+                      ZettaSeqChannel_t* channels, uint8_t nchannels);
+ZettaError_t zetta_seq_enable(ZettaSeq_t* seq, uint8_t type);
+ZettaSeqChannel_t* zetta_seq_channel(ZettaSeq_t* seq, uint8_t type);
+const ZettaSeqStats_t* zetta_seq_get_stats(ZettaSeq_t* seq, uint8_t type);
+// Receiver side accounting, exposed for transports that carry the sequence
+// number elsewhere
+void zetta_seq_track(ZettaSeqChannel_t* ch, uint8_t seq);
+#endif
@@ -0,0 +1,80 @@
+#ifndef ZETTA_TIME_H__
+#define ZETTA_TIME_H__
+#include "zetta_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Device timestamps in the frame.
+// Frames of an enabled type carry the time they were sent or their sample was
+// acquired, in ticks of the device clock (e.g. microseconds), in front of the
+// payload after the sequence byte. Only the low bits of the timestamp are sent
+// when it is close to the one of the previous stamped frame; the receiver adds
+// the difference to its own previous timestamp:
+//
+//   0ddddddd                 low 7 bits, |delta| < 32 ticks
+//   10dddddd dddddddd        low 14 bits, |delta| < 4096 ticks
+//   11000000 t0 t1 t2 t3     full 32 bit timestamp, little endian
+//
+// The low bits are decoded to the timestamp nearest to the receiver's
+// previous one, so the short forms survive a lost frame or two and samples
+// stamped slightly out of order. A full timestamp goes out every
+// full_interval stamped frames and resynchronises the receiver.
+// Both ends must enable the same types.
+
+#define ZETTA_TIME_FULL_INTERVAL 32 // default stamped frames per full timestamp
+#define ZETTA_TIME_SHORT_DELTA 32   // 1 byte field below this
+#define ZETTA_TIME_MEDIUM_DELTA 4096 // 2 byte field below this
+
+typedef uint32_t (*ZettaTimeNow)(void);
+
+typedef struct
+{
+    uint32_t tx_short;  // 1 byte fields sent
+    uint32_t tx_medium; // 2 byte fields sent
+    uint32_t tx_full;   // 5 byte fields sent
+    uint32_t rx_frames;
+    uint32_t rx_unsynced; // short fields before the first full timestamp
+} ZettaTimeStats_t;
+
+typedef struct
+{
+    uint8_t type_map[ZETTA_TYPE_MAP_SIZE]; // stamped types
+    ZettaTimeNow now;       // device clock, used when no time was given
+    uint16_t full_interval; // stamped frames between full timestamps
+
+    // sender
+    uint32_t tx_ref;
+    uint16_t tx_count; // stamped frames since the last full timestamp
+    uint8_t tx_synced;
+    uint8_t tx_given; // tx_next holds the time of the next frame
+    uint32_t tx_next;
+    uint32_t tx_pending; // time of the field zetta_send is checking
+
+    // receiver
+    uint32_t rx_ref;
+    uint8_t rx_synced;
+    uint8_t rx_valid; // rx_time belongs to the last received frame
+    uint32_t rx_time;
+
+    ZettaTimeStats_t stats;
+} ZettaTime_t;
+
+void zetta_time_attach(Zetta_t* hzetta, ZettaTime_t* tm, ZettaTimeNow now);
+void zetta_time_enable(ZettaTime_t* tm, uint8_t type);
+uint8_t zetta_time_enabled(ZettaTime_t* tm, uint8_t type);
+// Send with the acquisition time of the sample instead of the send time
+ZettaError_t zetta_time_send(Zetta_t* hzetta, ZettaTime_t* tm,
+                             ZettaPacketType_t type, void* pData, uint8_t len,
+                             uint32_t ticks);
+// Timestamp of the last received frame, 0 when it had none
+uint8_t zetta_time_get(ZettaTime_t* tm, uint32_t* ticks);
+// Field codec, exposed for transports that carry the timestamp elsewhere
+uint8_t zetta_time_encode(ZettaTime_t* tm, uint32_t ticks, uint8_t* field);
+int8_t zetta_time_decode(ZettaTime_t* tm, const uint8_t* data, uint8_t len);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,61 @@
+#include "zetta_batch.h"
+
+void zetta_batch_init(ZettaBatch_t* batch, uint8_t* arena, uint16_t arena_size,
+                      ZettaPayloadView_t* views, uint16_t max_views,
+                      ZettaBatchHandler on_batch, void* ctx)
+{
+    memset(batch, 0, sizeof(ZettaBatch_t));
+    batch->arena = arena;
+    batch->arena_size = arena_size;
+    batch->views = views;
+    batch->max_views = max_views;
+    batch->on_batch = on_batch;
+    batch->ctx = ctx;
+}
+
+void zetta_batch_flush(ZettaBatch_t* batch)
+{
+    if (batch->count == 0)
+        return;
+    batch->on_batch(batch->ctx, batch->type, batch->views, batch->count);
+    batch->batches++;
+    batch->frames += batch->count;
+    batch->count = 0;
+    batch->arena_used = 0;
+}
+
+void zetta_batch_add(ZettaBatch_t* batch, Zetta_t* hzetta)
+{
+    uint8_t type = (uint8_t)Zetta_GetType(hzetta);
+    uint8_t len = Zetta_GetLength(hzetta);
+
+    if (batch->count &&
+        (type != batch->type || batch->count >= batch->max_views ||
+         batch->arena_used + len > batch->arena_size))
+    {
+        zetta_batch_flush(batch);
+    }
+    if (len > batch->arena_size)
+        return; // arena too small for this frame
+
+    ZettaPayloadView_t* view = &batch->views[batch->count++];
+    view->data = &batch->arena[batch->arena_used];
+    view->len = len;
+    Zetta_GetPayload(hzetta, &batch->arena[batch->arena_used]);
+    batch->arena_used += len;
+    batch->type = type;
+}
+
+uint16_t zetta_ProcessBufferBatch(Zetta_t* hzetta, ZettaBatch_t* batch,
+                                  const uint8_t* pData, uint16_t size)
+{
+    uint32_t before = batch->frames + batch->count;
+
+    for (uint16_t i = 0; i < size; i++)
+    {
+        if (zetta_ParseByte(hzetta, pData[i]) == ZETTA_OK)
+            zetta_batch_add(batch, hzetta);
+    }
+    zetta_batch_flush(batch);
+    return (uint16_t)(batch->frames - before);
+}
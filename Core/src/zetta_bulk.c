@@ -0,0 +1,154 @@
+#include "zetta_bulk.h"
+#include <string.h>
+
+void zetta_bulk_init(ZettaBulk_t* bulk, uint8_t* rx_buf, uint16_t rx_size,
+                     ZettaBulkHandler on_message, void* ctx)
+{
+    memset(bulk, 0, sizeof(ZettaBulk_t));
+    bulk->type = MSG_BULK;
+    bulk->frag_size = ZETTA_BULK_FRAG_DATA;
+    bulk->rx_buf = rx_buf;
+    bulk->rx_size = rx_size;
+    bulk->on_message = on_message;
+    bulk->ctx = ctx;
+}
+
+ZettaError_t zetta_bulk_send(ZettaBulk_t* bulk, uint8_t type, const void* pData,
+                             uint16_t len)
+{
+    if (bulk->tx_active)
+        return ZETTA_ERROR_TX_BUSY;
+    if (len == 0)
+        return ZETTA_ERROR;
+
+    bulk->tx_data = (const uint8_t*)pData;
+    bulk->tx_len = len;
+    bulk->tx_off = 0;
+    bulk->tx_type = type;
+    bulk->tx_id = (uint8_t)((bulk->tx_id + 1) & ZB_ID_MASK);
+    bulk->tx_active = 1;
+    return ZETTA_OK;
+}
+
+uint8_t zetta_bulk_busy(ZettaBulk_t* bulk)
+{
+    return bulk->tx_active;
+}
+
+static ZettaError_t zetta_bulk_send_urgent(ZettaBulk_t* bulk, Zetta_t* hzetta)
+{
+    ZettaError_t err = zetta_send(hzetta, (ZettaPacketType_t)bulk->urgent_type,
+                                  bulk->urgent, bulk->urgent_len);
+    if (err == ZETTA_ERROR_TX_BUSY)
+        return err;
+    // Sent, filtered or rejected for good: never retried
+    bulk->urgent_pending = 0;
+    if (err == ZETTA_OK && bulk->tx_active && bulk->tx_off)
+        bulk->preemptions++;
+    return err;
+}
+
+ZettaError_t zetta_bulk_urgent(ZettaBulk_t* bulk, Zetta_t* hzetta, uint8_t type,
+                               const void* pData, uint8_t len)
+{
+    if (len > MAX_PAYLOAD_SIZE)
+        return ZETTA_ERROR_PAYLOAD_TOO_LARGE;
+    if (bulk->urgent_pending)
+        return ZETTA_ERROR_TX_BUSY;
+
+    bulk->urgent_type = type;
+    bulk->urgent_len = len;
+    memcpy(bulk->urgent, pData, len);
+    bulk->urgent_pending = 1;
+    if (hzetta->_internal.pstate == ZETTA_STATE_TX_BUSY)
+        return ZETTA_OK; // goes out from the next zetta_bulk_poll
+    return zetta_bulk_send_urgent(bulk, hzetta);
+}
+
+ZettaError_t zetta_bulk_poll(ZettaBulk_t* bulk, Zetta_t* hzetta)
+{
+    // Never wait for the link, a fragment boundary is the next idle TX
+    if (hzetta->_internal.pstate == ZETTA_STATE_TX_BUSY)
+        return ZETTA_ERROR_TX_BUSY;
+    if (bulk->urgent_pending)
+        return zetta_bulk_send_urgent(bulk, hzetta);
+    if (!bulk->tx_active)
+        return ZETTA_OK;
+
+    uint8_t frag[MAX_PAYLOAD_SIZE];
+    uint8_t frag_size = bulk->frag_size;
+    if (frag_size == 0 || frag_size > ZETTA_BULK_FRAG_DATA)
+        frag_size = ZETTA_BULK_FRAG_DATA;
+    uint16_t left = bulk->tx_len - bulk->tx_off;
+    uint8_t n = left > frag_size ? frag_size : (uint8_t)left;
+
+    frag[0] = bulk->tx_id;
+    if (bulk->tx_off == 0)
+        frag[0] |= ZB_FLAG_FIRST;
+    if (n == left)
+        frag[0] |= ZB_FLAG_LAST;
+    frag[1] = bulk->tx_type;
+    frag[2] = (uint8_t)(bulk->tx_off & 0xFF);
+    frag[3] = (uint8_t)(bulk->tx_off >> 8);
+    memcpy(&frag[ZETTA_BULK_HDR], &bulk->tx_data[bulk->tx_off], n);
+
+    ZettaError_t err = zetta_send(hzetta, (ZettaPacketType_t)bulk->type, frag,
+                                  (uint8_t)(ZETTA_BULK_HDR + n));
+    if (err == ZETTA_ERROR_TX_BUSY)
+        return err;
+    if (err != ZETTA_OK)
+    {
+        // A fragment that cannot go out ends the message, the receiver
+        // drops the part it has at the next first fragment
+        bulk->tx_active = 0;
+        bulk->tx_aborted++;
+        return err;
+    }
+    bulk->tx_off += n;
+    if (bulk->tx_off >= bulk->tx_len)
+        bulk->tx_active = 0;
+    return ZETTA_OK;
+}
+
+ZettaError_t zetta_bulk_handle(ZettaBulk_t* bulk, const uint8_t* pData,
+                               uint8_t len)
+{
+    if (len < ZETTA_BULK_HDR)
+        return ZETTA_FRAME_ERROR;
+
+    uint8_t flags = pData[0];
+    uint8_t id = flags & ZB_ID_MASK;
+    uint16_t off = (uint16_t)(pData[2] | (pData[3] << 8));
+    uint8_t n = len - ZETTA_BULK_HDR;
+
+    if (flags & ZB_FLAG_FIRST)
+    {
+        if (bulk->rx_active)
+            bulk->rx_dropped++; // previous message never completed
+        bulk->rx_active = 1;
+        bulk->rx_id = id;
+        bulk->rx_type = pData[1];
+        bulk->rx_len = 0;
+    }
+    // A lost fragment shows up as an offset or id mismatch
+    if (!bulk->rx_active || id != bulk->rx_id || off != bulk->rx_len ||
+        (uint32_t)off + n > bulk->rx_size)
+    {
+        if (bulk->rx_active)
+            bulk->rx_dropped++;
+        bulk->rx_active = 0;
+        return ZETTA_FRAME_ERROR;
+    }
+    memcpy(&bulk->rx_buf[off], &pData[ZETTA_BULK_HDR], n);
+    bulk->rx_len = (uint16_t)(off + n);
+
+    if (flags & ZB_FLAG_LAST)
+    {
+        bulk->rx_active = 0;
+        bulk->rx_messages++;
+        if (bulk->on_message)
+            bulk->on_message(bulk->ctx, bulk->rx_type, bulk->rx_buf,
+                             bulk->rx_len);
+    }
+    return ZETTA_OK;
+}
@@ -0,0 +1,278 @@
+#include "zetta_capture.h"
+#include <string.h>
+
+static void zetta_capture_put_u16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t zetta_capture_get_u16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+ZettaError_t zetta_capture_init(ZettaCapture_t* cap, uint8_t* buf,
+                                uint16_t capacity, uint8_t sample_size)
+{
+    memset(cap, 0, sizeof(ZettaCapture_t));
+    if (!buf || capacity == 0 || sample_size == 0 ||
+        sample_size > ZETTA_CAPTURE_MAX_SAMPLE_SIZE)
+        return ZETTA_ERROR;
+
+    cap->buf = buf;
+    cap->capacity = capacity;
+    cap->sample_size = sample_size;
+    cap->type = MSG_CAPTURE;
+    cap->pre = capacity / 2;
+    cap->post = capacity - cap->pre;
+    cap->state = ZC_STATE_IDLE;
+    return ZETTA_OK;
+}
+
+ZettaError_t zetta_capture_configure(ZettaCapture_t* cap, uint16_t pre,
+                                     uint16_t post, uint8_t flags)
+{
+    if ((uint32_t)pre + post > cap->capacity || (uint32_t)pre + post == 0)
+        return ZETTA_ERROR;
+    if (cap->state == ZC_STATE_TRIGGERED || cap->state == ZC_STATE_DRAINING)
+        return ZETTA_ERROR_TX_BUSY;
+
+    cap->pre = pre;
+    cap->post = post;
+    cap->flags = flags;
+    return ZETTA_OK;
+}
+
+ZettaError_t zetta_capture_arm(ZettaCapture_t* cap)
+{
+    if (cap->state == ZC_STATE_TRIGGERED || cap->state == ZC_STATE_DRAINING)
+        return ZETTA_ERROR_TX_BUSY;
+
+    cap->head = 0;
+    cap->filled = 0;
+    cap->overruns = 0;
+    cap->state = ZC_STATE_ARMED;
+    return ZETTA_OK;
+}
+
+void zetta_capture_disarm(ZettaCapture_t* cap)
+{
+    cap->state = ZC_STATE_IDLE;
+}
+
+static void zetta_capture_freeze(ZettaCapture_t* cap)
+{
+    cap->start = (uint16_t)((cap->head + cap->capacity - cap->total) %
+                            cap->capacity);
+    cap->sent = 0;
+    cap->begin_sent = 0;
+    cap->id++;
+    cap->state = ZC_STATE_DRAINING;
+}
+
+void zetta_capture_trigger(ZettaCapture_t* cap)
+{
+    if (cap->state != ZC_STATE_ARMED)
+        return;
+
+    uint16_t pre = cap->filled < cap->pre ? cap->filled : cap->pre;
+    cap->total = (uint16_t)(pre + cap->post);
+    cap->remaining = cap->post;
+    if (cap->post == 0)
+        zetta_capture_freeze(cap);
+    else
+        cap->state = ZC_STATE_TRIGGERED;
+}
+
+static int32_t zetta_capture_field(ZettaCapture_t* cap, const uint8_t* s)
+{
+    const uint8_t* p = &s[cap->level_offset];
+    switch (cap->level_width)
+    {
+    case 1:
+        return (int8_t)p[0];
+    case 2:
+        return (int16_t)(p[0] | (p[1] << 8));
+    default:
+        return (int32_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+                         ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+    }
+}
+
+static uint8_t zetta_capture_level_fired(ZettaCapture_t* cap,
+                                         const uint8_t* sample)
+{
+    int32_t v = zetta_capture_field(cap, sample);
+    int32_t last = cap->last_value;
+    uint8_t first = (cap->filled == 0);
+    cap->last_value = v;
+
+    switch (cap->level_mode)
+    {
+    case ZC_LEVEL_ABOVE:
+        return v > cap->level;
+    case ZC_LEVEL_BELOW:
+        return v < cap->level;
+    case ZC_LEVEL_RISING:
+        return !first && last <= cap->level && v > cap->level;
+    case ZC_LEVEL_FALLING:
+        return !first && last >= cap->level && v < cap->level;
+    default:
+        return 0;
+    }
+}
+
+void zetta_capture_push(ZettaCapture_t* cap, const void* sample)
+{
+    switch (cap->state)
+    {
+    case ZC_STATE_ARMED:
+        if (cap->level_mode != ZC_LEVEL_OFF &&
+            zetta_capture_level_fired(cap, sample))
+            zetta_capture_trigger(cap);
+        break;
+    case ZC_STATE_TRIGGERED:
+        break;
+    case ZC_STATE_DRAINING:
+        cap->overruns++;
+        return;
+    default:
+        return;
+    }
+
+    memcpy(&cap->buf[(uint32_t)cap->head * cap->sample_size], sample,
+           cap->sample_size);
+    cap->head = (uint16_t)((cap->head + 1) % cap->capacity);
+    if (cap->filled < cap->capacity)
+        cap->filled++;
+
+    if (cap->state == ZC_STATE_TRIGGERED && --cap->remaining == 0)
+        zetta_capture_freeze(cap);
+}
+
+// Drain over, sent or given up
+static void zetta_capture_done(ZettaCapture_t* cap)
+{
+    cap->state = ZC_STATE_IDLE;
+    if (cap->flags & ZC_FLAG_REARM)
+        zetta_capture_arm(cap);
+}
+
+// Only TX_BUSY is retried, a frame rejected for good (filtered, too large
+// for the link) would stall the drain and the capture never re-arms
+static ZettaError_t zetta_capture_check(ZettaCapture_t* cap, ZettaError_t err)
+{
+    if (err != ZETTA_OK && err != ZETTA_ERROR_TX_BUSY)
+    {
+        cap->aborted++;
+        zetta_capture_done(cap);
+    }
+    return err;
+}
+
+ZettaError_t zetta_capture_poll(ZettaCapture_t* cap, Zetta_t* hzetta)
+{
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+    uint8_t len = 0;
+
+    if (cap->state != ZC_STATE_DRAINING)
+        return ZETTA_OK;
+    // Never wait for the link, live traffic has priority
+    if (hzetta->_internal.pstate == ZETTA_STATE_TX_BUSY)
+        return ZETTA_ERROR_TX_BUSY;
+
+    if (!cap->begin_sent)
+    {
+        payload[len++] = ZC_MSG_BEGIN;
+        payload[len++] = cap->id;
+        zetta_capture_put_u16(&payload[len], cap->total);
+        len += 2;
+        zetta_capture_put_u16(&payload[len], cap->total - cap->post);
+        len += 2;
+        payload[len++] = cap->sample_size;
+        ZettaError_t err = zetta_send(hzetta, cap->type, payload, len);
+        if (err == ZETTA_OK)
+            cap->begin_sent = 1;
+        return zetta_capture_check(cap, err);
+    }
+
+    if (cap->sent < cap->total)
+    {
+        uint8_t per_frame =
+            (MAX_PAYLOAD_SIZE - ZETTA_CAPTURE_DATA_HDR) / cap->sample_size;
+        uint16_t n = cap->total - cap->sent;
+        if (n > per_frame)
+            n = per_frame;
+
+        payload[len++] = ZC_MSG_DATA;
+        payload[len++] = cap->id;
+        zetta_capture_put_u16(&payload[len], cap->sent);
+        len += 2;
+        for (uint16_t i = 0; i < n; i++)
+        {
+            uint16_t idx = (uint16_t)((cap->start + cap->sent + i) %
+                                      cap->capacity);
+            memcpy(&payload[len], &cap->buf[(uint32_t)idx * cap->sample_size],
+                   cap->sample_size);
+            len += cap->sample_size;
+        }
+        ZettaError_t err = zetta_send(hzetta, cap->type, payload, len);
+        if (err == ZETTA_OK)
+            cap->sent += n;
+        return zetta_capture_check(cap, err);
+    }
+
+    payload[len++] = ZC_MSG_END;
+    payload[len++] = cap->id;
+    zetta_capture_put_u16(&payload[len], cap->total);
+    len += 2;
+    zetta_capture_put_u16(&payload[len], cap->overruns);
+    len += 2;
+    ZettaError_t err = zetta_send(hzetta, cap->type, payload, len);
+    if (err == ZETTA_OK)
+        zetta_capture_done(cap);
+    return zetta_capture_check(cap, err);
+}
+
+ZettaError_t zetta_capture_handle(ZettaCapture_t* cap, const uint8_t* pData,
+                                  uint8_t len)
+{
+    if (len < 1)
+        return ZETTA_ERROR;
+
+    switch (pData[0])
+    {
+    case ZC_CMD_CONFIGURE:
+        if (len < 6)
+            return ZETTA_ERROR;
+        return zetta_capture_configure(cap, zetta_capture_get_u16(&pData[1]),
+                                       zetta_capture_get_u16(&pData[3]),
+                                       pData[5]);
+    case ZC_CMD_ARM:
+        return zetta_capture_arm(cap);
+    case ZC_CMD_DISARM:
+        zetta_capture_disarm(cap);
+        return ZETTA_OK;
+    case ZC_CMD_TRIGGER:
+        zetta_capture_trigger(cap);
+        return ZETTA_OK;
+    case ZC_CMD_LEVEL:
+        if (len < 8)
+            return ZETTA_ERROR;
+        if (pData[3] != ZC_LEVEL_OFF &&
+            ((pData[2] != 1 && pData[2] != 2 && pData[2] != 4) ||
+             (uint16_t)pData[1] + pData[2] > cap->sample_size))
+            return ZETTA_ERROR;
+        cap->level_mode = ZC_LEVEL_OFF;
+        cap->level_offset = pData[1];
+        cap->level_width = pData[2];
+        cap->level = (int32_t)((uint32_t)pData[4] | ((uint32_t)pData[5] << 8) |
+                               ((uint32_t)pData[6] << 16) |
+                               ((uint32_t)pData[7] << 24));
+        cap->level_mode = pData[3];
+        return ZETTA_OK;
+    default:
+        return ZETTA_ERROR;
+    }
+}
@@ -0,0 +1,159 @@
+#include "zetta_check.h"
+
+const ZettaCheck_t zetta_checks[ZETTA_CHECK_COUNT] = {
+    [ZETTA_CHECK_XOR8] = {"xor8", zetta_xor8, 1},
+    [ZETTA_CHECK_FLETCHER16] = {"fletcher16", zetta_fletcher16, 2},
+    [ZETTA_CHECK_ADLER16] = {"adler16", zetta_adler16, 2},
+    [ZETTA_CHECK_CRC8] = {"crc8", zetta_crc8, 1},
+    [ZETTA_CHECK_ADLER32] = {"adler32", zetta_adler32, 4},
+    [ZETTA_CHECK_CRC16] = {"crc16", zetta_crc16, 2},
+    [ZETTA_CHECK_CRC32] = {"crc32", zetta_crc32, 4},
+};
+
+static const uint8_t crc8_table[256] = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31,
+    0x24, 0x23, 0x2A, 0x2D, 0x70, 0x77, 0x7E, 0x79, 0x6C, 0x6B, 0x62, 0x65,
+    0x48, 0x4F, 0x46, 0x41, 0x54, 0x53, 0x5A, 0x5D, 0xE0, 0xE7, 0xEE, 0xE9,
+    0xFC, 0xFB, 0xF2, 0xF5, 0xD8, 0xDF, 0xD6, 0xD1, 0xC4, 0xC3, 0xCA, 0xCD,
+    0x90, 0x97, 0x9E, 0x99, 0x8C, 0x8B, 0x82, 0x85, 0xA8, 0xAF, 0xA6, 0xA1,
+    0xB4, 0xB3, 0xBA, 0xBD, 0xC7, 0xC0, 0xC9, 0xCE, 0xDB, 0xDC, 0xD5, 0xD2,
+    0xFF, 0xF8, 0xF1, 0xF6, 0xE3, 0xE4, 0xED, 0xEA, 0xB7, 0xB0, 0xB9, 0xBE,
+    0xAB, 0xAC, 0xA5, 0xA2, 0x8F, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9D, 0x9A,
+    0x27, 0x20, 0x29, 0x2E, 0x3B, 0x3C, 0x35, 0x32, 0x1F, 0x18, 0x11, 0x16,
+    0x03, 0x04, 0x0D, 0x0A, 0x57, 0x50, 0x59, 0x5E, 0x4B, 0x4C, 0x45, 0x42,
+    0x6F, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7D, 0x7A, 0x89, 0x8E, 0x87, 0x80,
+    0x95, 0x92, 0x9B, 0x9C, 0xB1, 0xB6, 0xBF, 0xB8, 0xAD, 0xAA, 0xA3, 0xA4,
+    0xF9, 0xFE, 0xF7, 0xF0, 0xE5, 0xE2, 0xEB, 0xEC, 0xC1, 0xC6, 0xCF, 0xC8,
+    0xDD, 0xDA, 0xD3, 0xD4, 0x69, 0x6E, 0x67, 0x60, 0x75, 0x72, 0x7B, 0x7C,
+    0x51, 0x56, 0x5F, 0x58, 0x4D, 0x4A, 0x43, 0x44, 0x19, 0x1E, 0x17, 0x10,
+    0x05, 0x02, 0x0B, 0x0C, 0x21, 0x26, 0x2F, 0x28, 0x3D, 0x3A, 0x33, 0x34,
+    0x4E, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5C, 0x5B, 0x76, 0x71, 0x78, 0x7F,
+    0x6A, 0x6D, 0x64, 0x63, 0x3E, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2C, 0x2B,
+    0x06, 0x01, 0x08, 0x0F, 0x1A, 0x1D, 0x14, 0x13, 0xAE, 0xA9, 0xA0, 0xA7,
+    0xB2, 0xB5, 0xBC, 0xBB, 0x96, 0x91, 0x98, 0x9F, 0x8A, 0x8D, 0x84, 0x83,
+    0xDE, 0xD9, 0xD0, 0xD7, 0xC2, 0xC5, 0xCC, 0xCB, 0xE6, 0xE1, 0xE8, 0xEF,
+    0xFA, 0xFD, 0xF4, 0xF3,
+};
+
+static const uint16_t crc16_nibbles[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+static const uint32_t crc32_nibbles[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+uint32_t zetta_xor8(uint32_t* data, uint32_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    uint8_t x = 0;
+    while (size--)
+        x ^= *p++;
+    return x;
+}
+
+uint32_t zetta_fletcher16(uint32_t* data, uint32_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    uint32_t s1 = 0, s2 = 0;
+    while (size)
+    {
+        // 32 bit sums cannot overflow within 256 bytes, reduce once per block
+        uint32_t n = size > 256 ? 256 : size;
+        size -= n;
+        while (n--)
+        {
+            s1 += *p++;
+            s2 += s1;
+        }
+        s1 %= 255;
+        s2 %= 255;
+    }
+    return (s2 << 8) | s1;
+}
+
+uint32_t zetta_adler16(uint32_t* data, uint32_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    uint32_t s1 = 1, s2 = 0;
+    while (size)
+    {
+        uint32_t n = size > 256 ? 256 : size;
+        size -= n;
+        while (n--)
+        {
+            s1 += *p++;
+            s2 += s1;
+        }
+        s1 %= 251;
+        s2 %= 251;
+    }
+    return (s2 << 8) | s1;
+}
+
+uint32_t zetta_adler32(uint32_t* data, uint32_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    uint32_t s1 = 1, s2 = 0;
+    while (size)
+    {
+        // Largest block without overflow of s2, as in zlib
+        uint32_t n = size > 5552 ? 5552 : size;
+        size -= n;
+        while (n--)
+        {
+            s1 += *p++;
+            s2 += s1;
+        }
+        s1 %= 65521;
+        s2 %= 65521;
+    }
+    return (s2 << 16) | s1;
+}
+
+uint32_t zetta_crc8(uint32_t* data, uint32_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    uint8_t crc = 0xFF;
+    while (size--)
+        crc = crc8_table[crc ^ *p++];
+    return crc;
+}
+
+uint32_t zetta_crc16(uint32_t* data, uint32_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    uint16_t crc = 0xFFFF;
+    while (size--)
+    {
+        crc ^= (uint16_t)(*p++ << 8);
+        crc = (uint16_t)((crc << 4) ^ crc16_nibbles[crc >> 12]);
+        crc = (uint16_t)((crc << 4) ^ crc16_nibbles[crc >> 12]);
+    }
+    return crc;
+}
+
+uint32_t zetta_crc32(uint32_t* data, uint32_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    uint32_t crc = 0xFFFFFFFFu;
+    while (size--)
+    {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ crc32_nibbles[crc & 0x0F];
+        crc = (crc >> 4) ^ crc32_nibbles[crc & 0x0F];
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+ZettaError_t zetta_use_check(Zetta_t* hzetta, ZettaCheckId_t id)
+{
+    if (id >= ZETTA_CHECK_COUNT)
+        return ZETTA_ERROR;
+    return zetta_set_check(hzetta, zetta_checks[id].compute,
+                           zetta_checks[id].size);
+}
@@ -0,0 +1,276 @@
+#include "zetta_fec.h"
+#include <string.h>
+
+#define ZF_REPORT_GROUP 0xFF
+
+void zetta_fec_init(ZettaFec_t* fec, ZettaFecHandler on_frame, void* ctx)
+{
+    memset(fec, 0, sizeof(ZettaFec_t));
+    fec->type = MSG_FEC;
+    fec->target = ZETTA_FEC_DEFAULT_TARGET;
+    fec->n = ZETTA_FEC_MAX_N;
+    fec->on_frame = on_frame;
+    fec->ctx = ctx;
+}
+
+ZettaError_t zetta_fec_set_group(ZettaFec_t* fec, uint8_t n)
+{
+    if (n && (n < ZETTA_FEC_MIN_N || n > ZETTA_FEC_MAX_N))
+        return ZETTA_ERROR;
+    fec->n_fixed = n;
+    return ZETTA_OK;
+}
+
+void zetta_fec_set_target(ZettaFec_t* fec, uint16_t target)
+{
+    fec->target = target;
+}
+
+void zetta_fec_set_loss(ZettaFec_t* fec, uint16_t loss)
+{
+    fec->tx_loss = loss;
+}
+
+uint8_t zetta_fec_group_size(uint16_t loss, uint16_t target)
+{
+    // A frame is lost for good when another one of its group is lost too:
+    // residual = p * (1 - (1 - p)^N) <= N * p^2, so N = target / p^2
+    if (loss == 0)
+        return ZETTA_FEC_MAX_N;
+    uint64_t n = ((uint64_t)target << 16) / ((uint32_t)loss * loss);
+    if (n < ZETTA_FEC_MIN_N)
+        return ZETTA_FEC_MIN_N;
+    if (n > ZETTA_FEC_MAX_N)
+        return ZETTA_FEC_MAX_N;
+    return (uint8_t)n;
+}
+
+static ZettaError_t zetta_fec_send_parity(ZettaFec_t* fec, Zetta_t* hzetta)
+{
+    uint8_t frame[MAX_PAYLOAD_SIZE];
+    uint8_t k = fec->tx_index;
+
+    frame[0] = fec->tx_group;
+    frame[1] = (uint8_t)(k << 4 | k);
+    frame[2] = fec->tx_type_x;
+    frame[3] = fec->tx_len_x;
+    memcpy(&frame[ZETTA_FEC_HDR + 1], fec->tx_parity, fec->tx_max_len);
+    ZettaError_t err =
+        zetta_send(hzetta, (ZettaPacketType_t)fec->type, frame,
+                   (uint8_t)(ZETTA_FEC_HDR + 1 + fec->tx_max_len));
+    if (err == ZETTA_ERROR_TX_BUSY)
+        return err;
+    // Rejected for good (filtered, size table): the group goes without it,
+    // retrying would hold up the stream
+    if (err == ZETTA_OK)
+        fec->stats.tx_parity++;
+    else
+        fec->stats.tx_parity_lost++;
+    fec->parity_pending = 0;
+    fec->tx_group++;
+    fec->tx_index = 0;
+    return err;
+}
+
+ZettaError_t zetta_fec_send(ZettaFec_t* fec, Zetta_t* hzetta, uint8_t type,
+                            const void* pData, uint8_t len, uint32_t now)
+{
+    uint8_t frame[MAX_PAYLOAD_SIZE];
+    const uint8_t* data = (const uint8_t*)pData;
+
+    if (len > ZETTA_FEC_DATA)
+        return ZETTA_ERROR_PAYLOAD_TOO_LARGE;
+    // The parity of the previous group goes first
+    if (fec->parity_pending)
+    {
+        if (hzetta->_internal.pstate == ZETTA_STATE_TX_BUSY)
+            return ZETTA_ERROR_TX_BUSY;
+        if (zetta_fec_send_parity(fec, hzetta) == ZETTA_ERROR_TX_BUSY)
+            return ZETTA_ERROR_TX_BUSY;
+    }
+    if (hzetta->_internal.pstate == ZETTA_STATE_TX_BUSY)
+        return ZETTA_ERROR_TX_BUSY;
+
+    if (fec->tx_index == 0)
+    {
+        fec->n = fec->n_fixed ? fec->n_fixed
+                              : zetta_fec_group_size(fec->tx_loss, fec->target);
+        fec->tx_type_x = 0;
+        fec->tx_len_x = 0;
+        fec->tx_max_len = 0;
+        memset(fec->tx_parity, 0, sizeof(fec->tx_parity));
+    }
+    frame[0] = fec->tx_group;
+    frame[1] = (uint8_t)(fec->n << 4 | fec->tx_index);
+    frame[2] = type;
+    memcpy(&frame[ZETTA_FEC_HDR], data, len);
+    ZettaError_t err = zetta_send(hzetta, (ZettaPacketType_t)fec->type, frame,
+                                  (uint8_t)(ZETTA_FEC_HDR + len));
+    if (err != ZETTA_OK)
+        return err; // filtered frames are not part of the group
+
+    fec->tx_type_x ^= type;
+    fec->tx_len_x ^= len;
+    for (uint8_t i = 0; i < len; i++)
+        fec->tx_parity[i] ^= data[i];
+    if (len > fec->tx_max_len)
+        fec->tx_max_len = len;
+    fec->stats.tx_frames++;
+    fec->last_tx = now;
+    if (++fec->tx_index == fec->n)
+        fec->parity_pending = 1;
+    return ZETTA_OK;
+}
+
+ZettaError_t zetta_fec_poll(ZettaFec_t* fec, Zetta_t* hzetta, uint32_t now)
+{
+    // A partial group gets its parity once the stream pauses
+    if (fec->tx_index && !fec->parity_pending && fec->flush &&
+        now - fec->last_tx >= fec->flush)
+        fec->parity_pending = 1;
+    if (hzetta->_internal.pstate == ZETTA_STATE_TX_BUSY)
+        return ZETTA_ERROR_TX_BUSY;
+    if (fec->parity_pending)
+        return zetta_fec_send_parity(fec, hzetta);
+    if (fec->report_interval && now - fec->last_report >= fec->report_interval)
+    {
+        uint8_t report[4] = {ZF_REPORT_GROUP, 0,
+                             (uint8_t)(fec->stats.loss_ewma & 0xFF),
+                             (uint8_t)(fec->stats.loss_ewma >> 8)};
+        fec->last_report = now;
+        return zetta_send(hzetta, (ZettaPacketType_t)fec->type, report,
+                          sizeof(report));
+    }
+    return ZETTA_OK;
+}
+
+static void zetta_fec_slots(ZettaFec_t* fec, uint8_t received, uint8_t lost)
+{
+    // 32 bits: a slow EWMA of a low loss rate must not round to zero
+    uint32_t acc = fec->loss_acc;
+
+    while (received--)
+        acc -= acc >> ZETTA_FEC_EWMA_SHIFT;
+    while (lost--)
+        acc += (0xFFFFFFFFu - acc) >> ZETTA_FEC_EWMA_SHIFT;
+    fec->loss_acc = acc;
+    fec->stats.loss_ewma = (uint16_t)(acc >> 16);
+}
+
+static uint8_t zetta_fec_count(uint16_t mask)
+{
+    uint8_t n = 0;
+    for (; mask; mask &= (uint16_t)(mask - 1))
+        n++;
+    return n;
+}
+
+// Close a group whose parity never came
+static void zetta_fec_close(ZettaFec_t* fec)
+{
+    if (!fec->rx_open)
+        return;
+    uint8_t missing = (uint8_t)(fec->rx_n - zetta_fec_count(fec->rx_mask));
+    fec->stats.lost += missing;
+    if (missing > 1)
+        fec->stats.unrecoverable++;
+    zetta_fec_slots(fec, 0, (uint8_t)(missing + 1));
+    fec->rx_open = 0;
+}
+
+static void zetta_fec_start(ZettaFec_t* fec, uint8_t group, uint8_t n)
+{
+    zetta_fec_close(fec);
+    if (fec->rx_synced)
+    {
+        // Whole groups lost in between, sized like the last one
+        uint8_t gap = (uint8_t)(group - fec->rx_group - 1);
+        if (gap > 8)
+            gap = 8;
+        fec->stats.lost += (uint32_t)gap * fec->rx_n;
+        while (gap--)
+            zetta_fec_slots(fec, 0, (uint8_t)(fec->rx_n + 1));
+    }
+    fec->rx_synced = 1;
+    fec->rx_open = 1;
+    fec->rx_group = group;
+    fec->rx_n = n;
+    fec->rx_mask = 0;
+    fec->rx_type_x = 0;
+    fec->rx_len_x = 0;
+    memset(fec->rx_x, 0, sizeof(fec->rx_x));
+}
+
+ZettaError_t zetta_fec_handle(ZettaFec_t* fec, const uint8_t* pData,
+                              uint8_t len)
+{
+    if (len < 2)
+        return ZETTA_FRAME_ERROR;
+    uint8_t group = pData[0];
+    uint8_t n = pData[1] >> 4;
+    uint8_t index = pData[1] & 0x0F;
+
+    if (n == 0)
+    {
+        if (len < 4)
+            return ZETTA_FRAME_ERROR;
+        fec->tx_loss = (uint16_t)(pData[2] | (pData[3] << 8));
+        return ZETTA_OK;
+    }
+    if (index > n || len < ZETTA_FEC_HDR + (index == n))
+        return ZETTA_FRAME_ERROR;
+    if (!fec->rx_synced || group != fec->rx_group)
+        zetta_fec_start(fec, group, n);
+    else if (!fec->rx_open)
+        return ZETTA_OK; // late duplicate of a finished group
+
+    const uint8_t* body = &pData[ZETTA_FEC_HDR];
+    if (index < n)
+    {
+        uint8_t size = (uint8_t)(len - ZETTA_FEC_HDR);
+        if (size > ZETTA_FEC_DATA)
+            return ZETTA_FRAME_ERROR;
+        if (fec->rx_mask & (1u << index))
+            return ZETTA_OK; // duplicate
+        fec->rx_mask |= (uint16_t)(1u << index);
+        fec->rx_type_x ^= pData[2];
+        fec->rx_len_x ^= size;
+        for (uint8_t i = 0; i < size; i++)
+            fec->rx_x[i] ^= body[i];
+        fec->stats.rx_frames++;
+        zetta_fec_slots(fec, 1, 0);
+        if (fec->on_frame)
+            fec->on_frame(fec->ctx, pData[2], body, size, 0);
+        return ZETTA_OK;
+    }
+
+    // Parity: n is the number of data frames it covers
+    uint8_t received = zetta_fec_count(fec->rx_mask & ((1u << n) - 1));
+    uint8_t missing = (uint8_t)(n - received);
+    uint8_t plen = (uint8_t)(len - ZETTA_FEC_HDR - 1);
+    fec->rx_open = 0;
+    zetta_fec_slots(fec, 1, missing);
+    if (missing == 0)
+        return ZETTA_OK;
+    if (missing > 1)
+    {
+        fec->stats.lost += missing;
+        fec->stats.unrecoverable++;
+        return ZETTA_OK;
+    }
+
+    uint8_t frame[ZETTA_FEC_DATA];
+    uint8_t type = pData[2] ^ fec->rx_type_x;
+    uint8_t size = pData[3] ^ fec->rx_len_x;
+    if (size > plen || size > ZETTA_FEC_DATA)
+    {
+        fec->stats.lost++;
+        return ZETTA_FRAME_ERROR;
+    }
+    for (uint8_t i = 0; i < size; i++)
+        frame[i] = body[1 + i] ^ fec->rx_x[i];
+    fec->stats.recovered++;
+    if (fec->on_frame)
+        fec->on_frame(fec->ctx, type, frame, size, 1);
+    return ZETTA_OK;
+}
@@ -0,0 +1,302 @@
+#include "zetta_filter.h"
+#include <string.h>
+
+static uint8_t zetta_filter_tx_hook(Zetta_t* hzetta, uint8_t type,
+                                    const void* data, uint8_t len);
+
+void zetta_filter_attach(Zetta_t* hzetta, ZettaFilterSet_t* set,
+                         ZettaFilter_t* slots, uint8_t nslots)
+{
+    set->slots = slots;
+    set->nslots = nslots;
+    for (uint8_t i = 0; i < nslots; i++)
+    {
+        zetta_filter_clear(&slots[i]);
+    }
+    zetta_set_tx_hook(hzetta, zetta_filter_tx_hook, set);
+}
+
+void zetta_filter_clear(ZettaFilter_t* filter)
+{
+    memset(filter, 0, sizeof(ZettaFilter_t));
+}
+
+static uint8_t zetta_filter_load_size(uint8_t op)
+{
+    switch (op)
+    {
+    case ZF_OP_LD_U8:
+    case ZF_OP_LD_I8:
+        return 1;
+    case ZF_OP_LD_U16:
+    case ZF_OP_LD_I16:
+        return 2;
+    case ZF_OP_LD_I32:
+    case ZF_OP_LD_F32:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+ZettaError_t zetta_filter_verify(const ZettaFilterInsn_t* insns, uint8_t count)
+{
+    if (count == 0 || count > ZETTA_FILTER_MAX_INSNS)
+        return ZETTA_ERROR;
+
+    for (uint8_t pc = 0; pc < count; pc++)
+    {
+        const ZettaFilterInsn_t* in = &insns[pc];
+        uint8_t size = zetta_filter_load_size(in->op);
+
+        if (in->op >= ZF_OP_COUNT)
+            return ZETTA_ERROR;
+        if (size && (uint16_t)in->arg + size > MAX_PAYLOAD_SIZE)
+            return ZETTA_ERROR;
+
+        switch (in->op)
+        {
+        case ZF_OP_RET:
+            continue;
+        case ZF_OP_LDM:
+        case ZF_OP_ST:
+        case ZF_OP_SUBM:
+            if (in->arg >= ZETTA_FILTER_MEM_WORDS)
+                return ZETTA_ERROR;
+            break;
+        case ZF_OP_MOD:
+            if (in->k == 0)
+                return ZETTA_ERROR;
+            break;
+        case ZF_OP_JA:
+            if ((uint16_t)pc + 1 + in->jt >= count)
+                return ZETTA_ERROR;
+            continue;
+        case ZF_OP_JEQ:
+        case ZF_OP_JGT:
+        case ZF_OP_JGE:
+        case ZF_OP_JSET:
+            if ((uint16_t)pc + 1 + in->jt >= count ||
+                (uint16_t)pc + 1 + in->jf >= count)
+                return ZETTA_ERROR;
+            continue;
+        default:
+            break;
+        }
+        // Straight line instructions must not fall off the end
+        if (pc + 1 >= count)
+            return ZETTA_ERROR;
+    }
+    return ZETTA_OK;
+}
+
+ZettaError_t zetta_filter_load(ZettaFilter_t* filter, uint8_t type,
+                               const ZettaFilterInsn_t* insns, uint8_t count)
+{
+    filter->active = 0;
+    if (zetta_filter_verify(insns, count) != ZETTA_OK)
+        return ZETTA_ERROR;
+
+    if (insns != filter->insns)
+        memcpy(filter->insns, insns, count * sizeof(ZettaFilterInsn_t));
+    memset(filter->mem, 0, sizeof(filter->mem));
+    filter->count = count;
+    filter->type = type;
+    filter->runs = 0;
+    filter->passed = 0;
+    filter->dropped = 0;
+    filter->active = 1;
+    return ZETTA_OK;
+}
+
+static int32_t zetta_filter_f32(const uint8_t* p, int32_t scale)
+{
+    float f;
+    memcpy(&f, p, sizeof(f));
+    f *= (float)scale;
+    if (f != f)
+        return 0;
+    if (f >= 2147483647.0f)
+        return INT32_MAX;
+    if (f <= -2147483648.0f)
+        return INT32_MIN;
+    return (int32_t)f;
+}
+
+// Payload fields are little endian, as sent by the MCU
+static uint32_t zetta_filter_le(const uint8_t* p, uint8_t size)
+{
+    uint32_t v = 0;
+    for (uint8_t i = size; i > 0; i--)
+    {
+        v = (v << 8) | p[i - 1];
+    }
+    return v;
+}
+
+uint8_t zetta_filter_run(ZettaFilter_t* filter, const uint8_t* pData,
+                         uint8_t len)
+{
+    int32_t a = 0;
+    uint8_t pc = 0;
+    uint8_t verdict = 0;
+
+    while (pc < filter->count)
+    {
+        const ZettaFilterInsn_t* in = &filter->insns[pc++];
+        uint8_t size = zetta_filter_load_size(in->op);
+
+        // Loads past the end of this payload reject the frame
+        if (size && (uint16_t)in->arg + size > len)
+            break;
+
+        switch (in->op)
+        {
+        case ZF_OP_RET:
+            verdict = (in->k != 0);
+            pc = filter->count;
+            break;
+        case ZF_OP_LDI:
+            a = in->k;
+            break;
+        case ZF_OP_LD_U8:
+            a = pData[in->arg];
+            break;
+        case ZF_OP_LD_I8:
+            a = (int8_t)pData[in->arg];
+            break;
+        case ZF_OP_LD_U16:
+            a = (int32_t)zetta_filter_le(&pData[in->arg], 2);
+            break;
+        case ZF_OP_LD_I16:
+            a = (int16_t)zetta_filter_le(&pData[in->arg], 2);
+            break;
+        case ZF_OP_LD_I32:
+            a = (int32_t)zetta_filter_le(&pData[in->arg], 4);
+            break;
+        case ZF_OP_LD_F32:
+            a = zetta_filter_f32(&pData[in->arg], in->k);
+            break;
+        case ZF_OP_LD_LEN:
+            a = len;
+            break;
+        case ZF_OP_LD_CNT:
+            a = (int32_t)filter->runs;
+            break;
+        case ZF_OP_LDM:
+            a = filter->mem[in->arg];
+            break;
+        case ZF_OP_ST:
+            filter->mem[in->arg] = a;
+            break;
+        case ZF_OP_ADD:
+            a = (int32_t)((uint32_t)a + (uint32_t)in->k);
+            break;
+        case ZF_OP_SUB:
+            a = (int32_t)((uint32_t)a - (uint32_t)in->k);
+            break;
+        case ZF_OP_MUL:
+            a = (int32_t)((uint32_t)a * (uint32_t)in->k);
+            break;
+        case ZF_OP_MOD:
+            a = (int32_t)((uint32_t)a % (uint32_t)in->k);
+            break;
+        case ZF_OP_AND:
+            a &= in->k;
+            break;
+        case ZF_OP_NEG:
+            a = (int32_t)(0u - (uint32_t)a);
+            break;
+        case ZF_OP_SUBM:
+            a = (int32_t)((uint32_t)a - (uint32_t)filter->mem[in->arg]);
+            break;
+        case ZF_OP_JA:
+            pc += in->jt;
+            break;
+        case ZF_OP_JEQ:
+            pc += (a == in->k) ? in->jt : in->jf;
+            break;
+        case ZF_OP_JGT:
+            pc += (a > in->k) ? in->jt : in->jf;
+            break;
+        case ZF_OP_JGE:
+            pc += (a >= in->k) ? in->jt : in->jf;
+            break;
+        case ZF_OP_JSET:
+            pc += (a & in->k) ? in->jt : in->jf;
+            break;
+        default:
+            pc = filter->count;
+            break;
+        }
+    }
+
+    filter->runs++;
+    if (verdict)
+        filter->passed++;
+    else
+        filter->dropped++;
+    return verdict;
+}
+
+static uint8_t zetta_filter_tx_hook(Zetta_t* hzetta, uint8_t type,
+                                    const void* data, uint8_t len)
+{
+    ZettaFilterSet_t* set = hzetta->_internal.tx_hook_ctx;
+
+    for (uint8_t i = 0; i < set->nslots; i++)
+    {
+        ZettaFilter_t* filter = &set->slots[i];
+        if (filter->active && filter->type == type)
+            return zetta_filter_run(filter, data, len);
+    }
+    return 1;
+}
+
+ZettaError_t zetta_filter_handle(ZettaFilterSet_t* set, const uint8_t* pData,
+                                 uint8_t len)
+{
+    if (len < 2 || pData[1] >= set->nslots)
+        return ZETTA_ERROR;
+
+    ZettaFilter_t* filter = &set->slots[pData[1]];
+
+    switch (pData[0])
+    {
+    case ZF_CMD_CLEAR:
+        zetta_filter_clear(filter);
+        return ZETTA_OK;
+
+    case ZF_CMD_LOAD:
+    {
+        if (len < 3 || (len - 3) % ZETTA_FILTER_INSN_SIZE)
+            return ZETTA_ERROR;
+        uint8_t index = pData[2];
+        uint8_t n = (len - 3) / ZETTA_FILTER_INSN_SIZE;
+        if ((uint16_t)index + n > ZETTA_FILTER_MAX_INSNS)
+            return ZETTA_ERROR;
+
+        // Staging invalidates the running program until the next commit
+        filter->active = 0;
+        const uint8_t* p = &pData[3];
+        for (uint8_t i = 0; i < n; i++, p += ZETTA_FILTER_INSN_SIZE)
+        {
+            ZettaFilterInsn_t* in = &filter->insns[index + i];
+            in->op = p[0];
+            in->arg = p[1];
+            in->jt = p[2];
+            in->jf = p[3];
+            in->k = (int32_t)zetta_filter_le(&p[4], 4);
+        }
+        return ZETTA_OK;
+    }
+
+    case ZF_CMD_COMMIT:
+        if (len < 4)
+            return ZETTA_ERROR;
+        return zetta_filter_load(filter, pData[2], filter->insns, pData[3]);
+
+    default:
+        return ZETTA_ERROR;
+    }
+}
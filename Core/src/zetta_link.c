@@ -0,0 +1,245 @@
+#include "zetta_link.h"
+#include <string.h>
+
+static void zetta_link_put_u32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
+    p[2] = (uint8_t)((v >> 16) & 0xFF);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t zetta_link_get_u32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+void zetta_link_init(ZettaLink_t* link, uint16_t interval,
+                     uint16_t min_timeout, uint16_t max_timeout)
+{
+    memset(link, 0, sizeof(ZettaLink_t));
+    link->type = MSG_LINK;
+    link->interval = interval;
+    link->min_timeout = min_timeout;
+    link->max_timeout = max_timeout;
+}
+
+ZettaError_t zetta_link_add_path(ZettaLink_t* link, Zetta_t* hzetta)
+{
+    if (link->npaths >= ZETTA_LINK_MAX_PATHS)
+        return ZETTA_ERROR;
+
+    ZettaLinkPath_t* path = &link->paths[link->npaths++];
+    memset(path, 0, sizeof(ZettaLinkPath_t));
+    path->hzetta = hzetta;
+    path->state = ZL_PATH_UNKNOWN;
+    path->timeout = link->max_timeout;
+    return ZETTA_OK;
+}
+
+Zetta_t* zetta_link_active(ZettaLink_t* link)
+{
+    return link->npaths ? link->paths[link->active].hzetta : NULL;
+}
+
+static ZettaLinkPath_t* zetta_link_path(ZettaLink_t* link, Zetta_t* hzetta)
+{
+    for (uint8_t i = 0; i < link->npaths; i++)
+    {
+        if (link->paths[i].hzetta == hzetta)
+            return &link->paths[i];
+    }
+    return NULL;
+}
+
+static ZettaError_t zetta_link_tx(ZettaLinkPath_t* path, uint8_t type,
+                                  const void* pData, uint8_t len)
+{
+    // Never block in zetta_send, the caller retries on the next poll
+    if (path->hzetta->_internal.pstate == ZETTA_STATE_TX_BUSY)
+        return ZETTA_ERROR_TX_BUSY;
+    return zetta_send(path->hzetta, (ZettaPacketType_t)type, (void*)pData,
+                      len);
+}
+
+static void zetta_link_update_timeout(ZettaLink_t* link, ZettaLinkPath_t* path)
+{
+    uint32_t rtt_based =
+        link->interval + (path->srtt8 >> 3) + (path->rttvar4 >> 2) * 4;
+    uint32_t gap_based = (path->gap8 >> 3) + (path->gapdev4 >> 2) * 4;
+    uint32_t timeout = rtt_based > gap_based ? rtt_based : gap_based;
+
+    if (timeout < link->min_timeout)
+        timeout = link->min_timeout;
+    if (timeout > link->max_timeout)
+        timeout = link->max_timeout;
+    path->timeout = timeout;
+}
+
+// Smoothed mean (1/8 scaled) and mean deviation (1/4 scaled), RFC 6298 style
+static void zetta_link_ewma(uint32_t* mean8, uint32_t* dev4, uint32_t sample)
+{
+    if (*mean8 == 0 && *dev4 == 0)
+    {
+        *mean8 = sample << 3;
+        *dev4 = sample << 1;
+        return;
+    }
+    int32_t delta = (int32_t)sample - (int32_t)(*mean8 >> 3);
+    *mean8 = (uint32_t)((int32_t)*mean8 + delta);
+    if (delta < 0)
+        delta = -delta;
+    *dev4 = (uint32_t)((int32_t)*dev4 + delta - (int32_t)(*dev4 >> 2));
+}
+
+uint8_t zetta_link_on_rx(ZettaLink_t* link, Zetta_t* hzetta, uint32_t now)
+{
+    ZettaLinkPath_t* path = zetta_link_path(link, hzetta);
+    if (!path)
+        return 0;
+
+    if (path->state != ZL_PATH_UNKNOWN)
+        zetta_link_ewma(&path->gap8, &path->gapdev4, now - path->last_rx);
+    path->last_rx = now;
+    path->state = ZL_PATH_UP;
+
+    if ((uint8_t)Zetta_GetType(hzetta) != link->type)
+    {
+        zetta_link_update_timeout(link, path);
+        return 0;
+    }
+
+    uint8_t msg[MAX_PAYLOAD_SIZE];
+    uint8_t len = Zetta_GetLength(hzetta);
+    Zetta_GetPayload(hzetta, msg);
+    if (len >= 6 && msg[0] == ZL_OP_PING)
+    {
+        msg[0] = ZL_OP_PONG;
+        zetta_link_tx(path, link->type, msg, 6);
+    }
+    else if (len >= 6 && msg[0] == ZL_OP_PONG)
+    {
+        zetta_link_ewma(&path->srtt8, &path->rttvar4,
+                        now - zetta_link_get_u32(&msg[2]));
+    }
+    zetta_link_update_timeout(link, path);
+    return 1;
+}
+
+static void zetta_link_failover(ZettaLink_t* link, uint8_t to)
+{
+    Zetta_t* from = link->paths[link->active].hzetta;
+    Zetta_t* next = link->paths[to].hzetta;
+    uint8_t prev = link->active;
+
+    // Sequence numbers continue on the new path
+    if (from->_internal.seq_tx || from->_internal.seq_rx)
+    {
+        zetta_set_seq_hooks(next, from->_internal.seq_tx,
+                            from->_internal.seq_rx, from->_internal.seq_ctx);
+        zetta_set_seq_size_hook(next, from->_internal.seq_size);
+    }
+    link->active = to;
+    link->failovers++;
+    if (link->on_failover)
+        link->on_failover(link, prev, to);
+}
+
+void zetta_link_poll(ZettaLink_t* link, uint32_t now)
+{
+    for (uint8_t i = 0; i < link->npaths; i++)
+    {
+        ZettaLinkPath_t* path = &link->paths[i];
+        // Anything sent on the path proves we are alive to the peer
+        uint32_t tx_frames = path->hzetta->_internal.stats.tx_frames;
+        if (tx_frames != path->tx_frames)
+        {
+            path->tx_frames = tx_frames;
+            path->last_tx = now;
+        }
+        // A path that never answers times out from its first poll
+        if (!path->polled)
+        {
+            path->polled = 1;
+            path->last_rx = now;
+        }
+        if (path->state != ZL_PATH_DOWN && now - path->last_rx > path->timeout)
+        {
+            path->state = ZL_PATH_DOWN;
+            path->downs++;
+        }
+        if (now - path->last_tx >= link->interval ||
+            now - path->last_ping >= (uint32_t)link->interval *
+                                         ZETTA_LINK_PROBE_EVERY)
+        {
+            uint8_t ping[6];
+            ping[0] = ZL_OP_PING;
+            ping[1] = path->ping_seq;
+            zetta_link_put_u32(&ping[2], now);
+            if (zetta_link_tx(path, link->type, ping, sizeof(ping)) ==
+                ZETTA_OK)
+            {
+                path->ping_seq++;
+                path->last_ping = now;
+                path->last_tx = now;
+                path->tx_frames = path->hzetta->_internal.stats.tx_frames;
+            }
+        }
+    }
+
+    if (link->npaths && link->paths[link->active].state != ZL_PATH_UP)
+    {
+        for (uint8_t i = 0; i < link->npaths; i++)
+        {
+            if (link->paths[i].state == ZL_PATH_UP)
+            {
+                zetta_link_failover(link, i);
+                break;
+            }
+        }
+    }
+
+    ZettaLinkPath_t* active = &link->paths[link->active];
+    while (link->txq_count && active->state != ZL_PATH_DOWN)
+    {
+        ZettaLinkFrame_t* f = &link->txq[link->txq_head];
+        ZettaError_t err = zetta_link_tx(active, f->type, f->payload, f->len);
+        if (err == ZETTA_ERROR_TX_BUSY)
+            break;
+        // Rejected for good (filtered, size): retrying would block the queue
+        if (err != ZETTA_OK)
+            link->txq_dropped++;
+        link->txq_head = (uint8_t)((link->txq_head + 1) % ZETTA_LINK_TXQ_DEPTH);
+        link->txq_count--;
+    }
+}
+
+ZettaError_t zetta_link_send(ZettaLink_t* link, uint8_t type,
+                             const void* pData, uint8_t len)
+{
+    if (link->npaths == 0)
+        return ZETTA_ERROR;
+    if (len > MAX_PAYLOAD_SIZE)
+        return ZETTA_ERROR_PAYLOAD_TOO_LARGE;
+
+    ZettaLinkPath_t* active = &link->paths[link->active];
+    if (link->txq_count == 0 && active->state != ZL_PATH_DOWN)
+    {
+        ZettaError_t err = zetta_link_tx(active, type, pData, len);
+        if (err != ZETTA_ERROR_TX_BUSY)
+            return err;
+    }
+    if (link->txq_count >= ZETTA_LINK_TXQ_DEPTH)
+    {
+        link->txq_dropped++;
+        return ZETTA_ERROR_TX_BUSY;
+    }
+    ZettaLinkFrame_t* f =
+        &link->txq[(link->txq_head + link->txq_count) % ZETTA_LINK_TXQ_DEPTH];
+    f->type = type;
+    f->len = len;
+    memcpy(f->payload, pData, len);
+    link->txq_count++;
+    return ZETTA_OK;
+}
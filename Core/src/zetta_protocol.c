@@ -2,11 +2,15 @@
 #include "zetta_protocol.h"
 #include <stdio.h>
 #include <string.h>
+
+#define ZETTA_STREAM_HEADER_UNKNOWN 0xFF
 // pstate Machine States
 uint8_t tx_buf[MAX_ZETTA_FRAME_SIZE];
 uint16_t buf_tx_size = 0;
 uint32_t dbg_crc_val = 0;
-static uint32_t zetta_compute_crc(Zetta_t* packet);
+static uint32_t zetta_compute_crc(Zetta_t* packet, uint8_t* data,
+                                  uint32_t size);
+static void zetta_raise_error(Zetta_t* packet, ZettaError_t error);
 
 void zetta_init(Zetta_t* packet, ZettaInterface_t interface)
 {
@@ -20,19 +24,194 @@ void zetta_init(Zetta_t* packet, ZettaInterface_t interface)
     packet->interface.rxCpltClbk = zetta_recieve_cplt_clb;
     packet->interface.txCpltClbk = zetta_transmit_cplt_clb;
     packet->interface.OnError = zetta_error_manager;
+    packet->_internal.check_size = 1;
+    zetta_register_type(packet, MSG_ACK);
+    zetta_register_type(packet, MSG_PUBLISH);
+    zetta_register_type(packet, MSG_SUBSCRIBE);
+    zetta_register_type(packet, MSG_FILTER);
+    zetta_register_type(packet, MSG_CAPTURE);
+    zetta_register_type(packet, MSG_LINK);
+    zetta_register_type(packet, MSG_BULK);
+    zetta_register_type(packet, MSG_ROUTE);
+    zetta_register_type(packet, MSG_FEC);
     return;
 }
 
-static uint32_t zetta_compute_crc(Zetta_t* packet)
+void zetta_register_type(Zetta_t* hzetta, uint8_t type)
+{
+    hzetta->_internal.type_map[type >> 3] |= (uint8_t)(1u << (type & 7));
+}
+
+void zetta_unregister_type(Zetta_t* hzetta, uint8_t type)
+{
+    hzetta->_internal.type_map[type >> 3] &= (uint8_t)~(1u << (type & 7));
+}
+
+uint8_t zetta_is_type_registered(Zetta_t* hzetta, uint8_t type)
+{
+    return (hzetta->_internal.type_map[type >> 3] >> (type & 7)) & 1u;
+}
+
+void zetta_set_tx_hook(Zetta_t* hzetta, ZettaTxHook hook, void* ctx)
+{
+    hzetta->_internal.tx_hook = hook;
+    hzetta->_internal.tx_hook_ctx = ctx;
+}
+
+ZettaError_t zetta_set_check(Zetta_t* hzetta, ZettaComputeCRC compute,
+                             uint8_t size)
+{
+    if (!compute || (size != 1 && size != 2 && size != 4))
+        return ZETTA_ERROR;
+    hzetta->interface.computeCRC = compute;
+    hzetta->_internal.check_size = size;
+    return ZETTA_OK;
+}
+
+void zetta_set_seq_hooks(Zetta_t* hzetta, ZettaSeqTxHook tx, ZettaSeqRxHook rx,
+                         void* ctx)
+{
+    hzetta->_internal.seq_tx = tx;
+    hzetta->_internal.seq_rx = rx;
+    hzetta->_internal.seq_size = NULL;
+    hzetta->_internal.seq_ctx = ctx;
+}
+
+void zetta_set_seq_size_hook(Zetta_t* hzetta, ZettaSeqSizeHook size)
+{
+    hzetta->_internal.seq_size = size;
+}
+
+void zetta_set_time_hooks(Zetta_t* hzetta, ZettaTimeTxHook tx,
+                          ZettaTimeRxHook rx, void* ctx)
+{
+    hzetta->_internal.time_tx = tx;
+    hzetta->_internal.time_rx = rx;
+    hzetta->_internal.time_size = NULL;
+    hzetta->_internal.time_commit = NULL;
+    hzetta->_internal.time_ctx = ctx;
+}
+
+void zetta_set_time_size_hook(Zetta_t* hzetta, ZettaTimeSizeHook size)
+{
+    hzetta->_internal.time_size = size;
+}
+
+void zetta_set_time_commit_hook(Zetta_t* hzetta, ZettaTimeCommitHook commit)
+{
+    hzetta->_internal.time_commit = commit;
+}
+
+void zetta_set_size_table(Zetta_t* hzetta, const uint8_t* sizes)
+{
+    hzetta->_internal.sizes = sizes;
+}
+
+void zetta_size_table_init(uint8_t* sizes)
+{
+    memset(sizes, ZETTA_SIZE_VARIABLE, ZETTA_SIZE_TABLE_LEN);
+}
+
+void zetta_set_stream_consumer(Zetta_t* hzetta,
+                               const ZettaStreamConsumer_t* consumer,
+                               uint8_t chunk_size)
+{
+    hzetta->_internal.stream = consumer;
+    hzetta->_internal.stream_chunk =
+        (chunk_size == 0) ? MAX_PAYLOAD_SIZE : chunk_size;
+    hzetta->_internal.stream_active = 0;
+}
+
+static void zetta_stream_flush(Zetta_t* packet)
+{
+    const ZettaStreamConsumer_t* stream = packet->_internal.stream;
+    uint8_t pending = packet->_internal.index - packet->_internal.stream_sent;
+
+    if (pending && stream->onChunk)
+    {
+        stream->onChunk(packet,
+                        &packet->_internal.frame.payload
+                             [packet->_internal.stream_sent],
+                        packet->_internal.stream_sent -
+                            packet->_internal.stream_header,
+                        pending);
+    }
+    packet->_internal.stream_sent = packet->_internal.index;
+}
+
+// Begin streaming once the size of the sequence byte and timestamp field is
+// known, they are held back like Zetta_GetPayload strips them
+static void zetta_stream_start(Zetta_t* packet)
+{
+    uint8_t type = packet->_internal.frame.type;
+    uint8_t len = packet->_internal.frame.len;
+    uint8_t have = packet->_internal.index;
+    uint8_t header = 0;
+    int8_t field = 0;
+
+    if (packet->_internal.seq_size &&
+        packet->_internal.seq_size(packet->_internal.seq_ctx, type))
+        header = 1;
+    if (packet->_internal.time_size)
+        field = (have >= header)
+                    ? packet->_internal.time_size(
+                          packet->_internal.time_ctx, type,
+                          &packet->_internal.frame.payload[header],
+                          (uint8_t)(have - header))
+                    : -1;
+    if (header > have || field < 0)
+    {
+        if (have < len)
+            return; // wait for the bytes that tell the size
+        field = (int8_t)len; // shorter than its header, fails at commit
+    }
+    header = (uint8_t)(header + field);
+    if (header > len)
+        header = len;
+
+    packet->_internal.stream_header = header;
+    packet->_internal.stream_sent = header;
+    packet->_internal.stream_active = 1;
+    if (packet->_internal.stream->onBegin)
+        packet->_internal.stream->onBegin(packet, type, (uint8_t)(len - header));
+}
+
+static void zetta_stream_abort(Zetta_t* packet, ZettaError_t error)
 {
-    // type + len + payload size
-    uint32_t crc = 0;
-    uint32_t data_bytes =
-        1 + 1 + packet->_internal.frame.len; // type + len + payload
+    if (!packet->_internal.stream_active)
+        return;
+    packet->_internal.stream_active = 0;
+    if (packet->_internal.stream->onAbort)
+        packet->_internal.stream->onAbort(packet, error);
+}
 
-    uint8_t* data_ptr = &packet->_internal.frame.type;
+const ZettaStats_t* zetta_get_stats(Zetta_t* hzetta)
+{
+    return &hzetta->_internal.stats;
+}
 
-    crc = packet->interface.computeCRC((uint32_t*)data_ptr, data_bytes);
+void zetta_reset_stats(Zetta_t* hzetta)
+{
+    memset(&hzetta->_internal.stats, 0, sizeof(ZettaStats_t));
+}
+
+static void zetta_raise_error(Zetta_t* packet, ZettaError_t error)
+{
+    packet->_internal.error = error;
+    if (error < ZETTA_ERROR_COUNT)
+        packet->_internal.stats.errors[error]++;
+    // A frame in flight is never committed after an error
+    zetta_stream_abort(packet, error);
+    packet->interface.OnError(packet, error);
+}
+
+static uint32_t zetta_compute_crc(Zetta_t* packet, uint8_t* data,
+                                  uint32_t size)
+{
+    // type + len + payload
+    uint32_t crc = packet->interface.computeCRC((uint32_t*)data, size);
+    if (packet->_internal.check_size < 4)
+        crc &= (1u << (8 * packet->_internal.check_size)) - 1u;
     // // 1. Reset the CRC DR register to Initial Value (0xFFFFFFFF)
     dbg_crc_val = crc;
     // // 2. Feed bytes one by one to avoid 32-bit alignment/padding issues
@@ -56,39 +235,113 @@ ZettaError_t zetta_send(Zetta_t* packet, ZettaPacketType_t type, void* pData,
     }
     if (len > MAX_PAYLOAD_SIZE)
     {
-        packet->interface.OnError(packet, ZETTA_ERROR_PAYLOAD_TOO_LARGE);
+        zetta_raise_error(packet, ZETTA_ERROR_PAYLOAD_TOO_LARGE);
         return ZETTA_ERROR_PAYLOAD_TOO_LARGE;
     }
+    if (packet->_internal.tx_hook &&
+        !packet->_internal.tx_hook(packet, type, pData, len))
+    {
+        packet->_internal.stats.tx_filtered++;
+        return ZETTA_FILTERED;
+    }
+    // Header sizes first: a rejected frame must not take a sequence number
+    // or advance the time encoder (see ZettaTimeCommitHook)
+    int16_t seq = -1;
+    uint8_t seq_len = 0;
+    if (packet->_internal.seq_size)
+        seq_len = packet->_internal.seq_size(packet->_internal.seq_ctx, type);
+    else if (packet->_internal.seq_tx)
+    {
+        seq = packet->_internal.seq_tx(packet->_internal.seq_ctx, type);
+        seq_len = (seq >= 0);
+    }
+    uint8_t field[ZETTA_MAX_TIME_FIELD];
+    uint8_t field_len =
+        packet->_internal.time_tx
+            ? packet->_internal.time_tx(packet->_internal.time_ctx, type, field)
+            : 0;
+    if (len + seq_len + field_len > MAX_PAYLOAD_SIZE)
+    {
+        zetta_raise_error(packet, ZETTA_ERROR_PAYLOAD_TOO_LARGE);
+        return ZETTA_ERROR_PAYLOAD_TOO_LARGE;
+    }
+    uint8_t fixed = packet->_internal.sizes ? packet->_internal.sizes[type]
+                                            : ZETTA_SIZE_VARIABLE;
+    if (fixed != ZETTA_SIZE_VARIABLE && len + seq_len + field_len != fixed)
+    {
+        zetta_raise_error(packet, ZETTA_ERROR_LENGTH);
+        return ZETTA_ERROR_LENGTH;
+    }
+    if (packet->_internal.seq_size && seq_len)
+        seq = packet->_internal.seq_tx(packet->_internal.seq_ctx, type);
 
     buf_tx_size = 0;
-    memset(tx_buf, 0, 30);
+    memset(tx_buf, 0, sizeof(tx_buf));
     packet->_internal.pstate = ZETTA_STATE_TX_BUSY;
 
     tx_buf[buf_tx_size++] = START_BYTE;
     tx_buf[buf_tx_size++] = type;
-    tx_buf[buf_tx_size++] = len;
+    tx_buf[buf_tx_size++] = len + seq_len + field_len;
+    if (seq_len)
+        tx_buf[buf_tx_size++] = (uint8_t)seq;
+    memcpy(&tx_buf[buf_tx_size], field, field_len);
+    buf_tx_size += field_len;
     memcpy(&tx_buf[buf_tx_size], pData, len);
     buf_tx_size += len;
-    packet->_internal.frame.type = type ; 
-    packet->_internal.frame.len = len ; 
-    memcpy(packet->_internal.frame.payload, pData, len);
-    packet->_internal.frame.crc = zetta_compute_crc(packet);
-    tx_buf[buf_tx_size++] = packet->_internal.frame.crc ; 
+    // CRC over the TX buffer, the RX frame of this instance is left alone
+    uint32_t crc = zetta_compute_crc(packet, &tx_buf[1], buf_tx_size - 1);
+    if (fixed != ZETTA_SIZE_VARIABLE)
+    {
+        // The check still covers LEN, only the byte on the wire goes
+        memmove(&tx_buf[2], &tx_buf[3], buf_tx_size - 3);
+        buf_tx_size--;
+    }
+    for (uint8_t i = 0; i < packet->_internal.check_size; i++)
+        tx_buf[buf_tx_size++] = (uint8_t)(crc >> (8 * i));
     tx_buf[buf_tx_size++] = STOP_BYTE;
 
     // Hand it to hardware
     packet->interface.send(tx_buf, buf_tx_size);
+    if (field_len && packet->_internal.time_commit)
+        packet->_internal.time_commit(packet->_internal.time_ctx, type,
+                                      field_len);
+    packet->_internal.stats.tx_frames++;
+    packet->_internal.stats.tx_bytes += buf_tx_size;
     // TODO: Create a timout callback that after some time resets the packet
     return ZETTA_OK;
 }
-// TODO
-static ZettaError_t zetta_check_type(uint8_t byte) { return ZETTA_OK; }
+static ZettaError_t zetta_check_type(Zetta_t* packet, uint8_t byte)
+{
+#if ZETTA_ACCEPT_UNKNOWN_TYPES
+    (void)packet;
+    (void)byte;
+    return ZETTA_OK;
+#else
+    return zetta_is_type_registered(packet, byte) ? ZETTA_OK
+                                                  : ZETTA_ERROR_TYPE;
+#endif
+}
+
+static void zetta_begin_payload(Zetta_t* packet, uint8_t len)
+{
+    packet->_internal.frame.len = len;
+    packet->_internal.check_index = 0;
+    packet->_internal.rx_frame_state =
+        (len == 0) ? STATE_RX_GET_CRC : STATE_RX_GET_PAYLOAD;
+    if (packet->_internal.stream)
+    {
+        packet->_internal.stream_active = 0;
+        packet->_internal.stream_header = ZETTA_STREAM_HEADER_UNKNOWN;
+        zetta_stream_start(packet);
+    }
+}
 
 ZettaError_t zetta_ParseByte(Zetta_t* packet, uint8_t byte)
 {
     while (packet->_internal.pstate == ZETTA_STATE_RX_BUSY)
     {
     }
+    packet->_internal.stats.rx_bytes++;
     switch (packet->_internal.rx_frame_state)
     {
     case STATE_RX_WAIT_START:
@@ -100,35 +353,39 @@ ZettaError_t zetta_ParseByte(Zetta_t* packet, uint8_t byte)
         }
         else
         {
-            packet->_internal.error = ZETTA_ERROR_INVALID_START;
-            packet->interface.OnError(packet, ZETTA_ERROR_INVALID_START);
+            zetta_raise_error(packet, ZETTA_ERROR_INVALID_START);
         }
         break;
 
     case STATE_RX_GET_TYPE:
-        if (zetta_check_type(byte))
+        if (zetta_check_type(packet, byte) == ZETTA_OK)
         {
             packet->_internal.frame.type = byte;
-            packet->_internal.rx_frame_state = STATE_RX_GET_LEN;
+            uint8_t fixed = packet->_internal.sizes
+                                ? packet->_internal.sizes[byte]
+                                : ZETTA_SIZE_VARIABLE;
+            // Fixed size types go straight to the payload
+            if (fixed == ZETTA_SIZE_VARIABLE)
+                packet->_internal.rx_frame_state = STATE_RX_GET_LEN;
+            else if (fixed <= MAX_PAYLOAD_SIZE)
+                zetta_begin_payload(packet, fixed);
+            else
+                zetta_raise_error(packet, ZETTA_ERROR_PAYLOAD_TOO_LARGE);
         }
         else
         {
-            packet->_internal.error = ZETTA_ERROR_TYPE;
-            packet->interface.OnError(packet, ZETTA_ERROR_TYPE);
+            zetta_raise_error(packet, ZETTA_ERROR_TYPE);
         }
         break;
 
     case STATE_RX_GET_LEN:
         if (byte <= MAX_PAYLOAD_SIZE)
         {
-            packet->_internal.frame.len = byte;
-            packet->_internal.rx_frame_state =
-                (byte == 0) ? STATE_RX_GET_CRC : STATE_RX_GET_PAYLOAD;
+            zetta_begin_payload(packet, byte);
         }
         else
         {
-            packet->_internal.error = ZETTA_ERROR_PAYLOAD_TOO_LARGE;
-            packet->interface.OnError(packet, ZETTA_ERROR_PAYLOAD_TOO_LARGE);
+            zetta_raise_error(packet, ZETTA_ERROR_PAYLOAD_TOO_LARGE);
 
             return ZETTA_ERROR;
         }
@@ -136,15 +393,27 @@ ZettaError_t zetta_ParseByte(Zetta_t* packet, uint8_t byte)
 
     case STATE_RX_GET_PAYLOAD:
         packet->_internal.frame.payload[packet->_internal.index++] = byte;
+        if (packet->_internal.stream &&
+            packet->_internal.stream_header == ZETTA_STREAM_HEADER_UNKNOWN)
+            zetta_stream_start(packet);
         if (packet->_internal.index >= packet->_internal.frame.len)
         {
             packet->_internal.rx_frame_state = STATE_RX_GET_CRC;
+            if (packet->_internal.stream_active)
+                zetta_stream_flush(packet);
+        }
+        else if (packet->_internal.stream_active &&
+                 packet->_internal.index - packet->_internal.stream_sent >=
+                     packet->_internal.stream_chunk)
+        {
+            zetta_stream_flush(packet);
         }
         break;
 
     case STATE_RX_GET_CRC:
-        packet->_internal.frame.crc = byte;
-        packet->_internal.rx_frame_state = STATE_RX_GET_STOP;
+        packet->_internal.frame.crc[packet->_internal.check_index++] = byte;
+        if (packet->_internal.check_index >= packet->_internal.check_size)
+            packet->_internal.rx_frame_state = STATE_RX_GET_STOP;
         break;
 
     case STATE_RX_GET_STOP:
@@ -154,32 +423,64 @@ ZettaError_t zetta_ParseByte(Zetta_t* packet, uint8_t byte)
             packet->_internal.rx_frame_state = STATE_RX_WAIT_START;
             packet->_internal.frame.stop = STOP_BYTE;
             // Calculate CRC of received data to verify integrity
-            uint32_t crc_val = zetta_compute_crc(packet);
+            uint32_t crc_val = zetta_compute_crc(
+                packet, &packet->_internal.frame.type,
+                2 + packet->_internal.frame.len);
+
+            uint32_t received = 0;
+            for (uint8_t i = 0; i < packet->_internal.check_size; i++)
+                received |= (uint32_t)packet->_internal.frame.crc[i] << (8 * i);
 
-            if (crc_val == packet->_internal.frame.crc)
+            if (crc_val == received)
             {
+                packet->_internal.payload_offset = 0;
+                if (packet->_internal.seq_rx && packet->_internal.frame.len &&
+                    packet->_internal.seq_rx(packet->_internal.seq_ctx,
+                                             packet->_internal.frame.type,
+                                             packet->_internal.frame.payload[0]))
+                {
+                    packet->_internal.payload_offset = 1;
+                }
+                if (packet->_internal.time_rx)
+                {
+                    uint8_t offset = packet->_internal.payload_offset;
+                    int8_t field_len = packet->_internal.time_rx(
+                        packet->_internal.time_ctx, packet->_internal.frame.type,
+                        &packet->_internal.frame.payload[offset],
+                        (uint8_t)(packet->_internal.frame.len - offset));
+                    if (field_len < 0)
+                    {
+                        zetta_raise_error(packet, ZETTA_FRAME_ERROR);
+                        break;
+                    }
+                    packet->_internal.payload_offset += (uint8_t)field_len;
+                }
                 packet->_internal.payload_ready = 1;
+                packet->_internal.stats.rx_frames++;
                 packet->_internal.rx_frame_state = STATE_RX_WAIT_START ; 
+                if (packet->_internal.stream_active)
+                {
+                    packet->_internal.stream_active = 0;
+                    if (packet->_internal.stream->onCommit)
+                        packet->_internal.stream->onCommit(packet);
+                }
                 return ZETTA_OK; // Valid packet found!
             }
             else
             {
-                packet->_internal.error = ZETTA_ERROR_CRC_MISMATCH;
-                packet->interface.OnError(packet, ZETTA_ERROR_CRC_MISMATCH);
+                zetta_raise_error(packet, ZETTA_ERROR_CRC_MISMATCH);
                 // packet->_internal.rx_frame_state = STATE_ERROR_CRC;
             }
         }
         else
         {
-            packet->_internal.error = ZETTA_ERROR_INVALID_STOP;
-            packet->interface.OnError(packet, ZETTA_ERROR_INVALID_STOP);
+            zetta_raise_error(packet, ZETTA_ERROR_INVALID_STOP);
             // packet->_internal.rx_frame_state = STATE_FRAME_ERROR;
         }
         break;
 
     default:
-        packet->_internal.error = ZETTA_FRAME_ERROR;
-        packet->interface.OnError(packet, ZETTA_FRAME_ERROR);
+        zetta_raise_error(packet, ZETTA_FRAME_ERROR);
         break;
     }
     return ZETTA_ERROR;
@@ -199,8 +500,16 @@ ZettaError_t zetta_ProcessBuffer(Zetta_t* packet, uint8_t* pData, uint16_t size)
 void Zetta_GetPayload(Zetta_t* hzetta, void* pDest)
 {
     if (hzetta->_internal.payload_ready)
-        memcpy(pDest, hzetta->_internal.frame.payload,
-               hzetta->_internal.frame.len);
+        memcpy(pDest,
+               &hzetta->_internal.frame.payload[hzetta->_internal.payload_offset],
+               Zetta_GetLength(hzetta));
+}
+
+uint8_t Zetta_GetLength(Zetta_t* hzetta)
+{
+    if (!hzetta->_internal.payload_ready)
+        return 0;
+    return hzetta->_internal.frame.len - hzetta->_internal.payload_offset;
 }
 
 ZettaPacketType_t Zetta_GetType(Zetta_t* hzetta)
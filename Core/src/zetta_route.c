@@ -0,0 +1,421 @@
+#include "zetta_route.h"
+#include <string.h>
+
+static void zetta_route_put_u16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t zetta_route_get_u16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+void zetta_route_init(ZettaRouter_t* router, uint8_t address,
+                      uint16_t interval, ZettaRouteDeliver on_deliver,
+                      void* ctx)
+{
+    memset(router, 0, sizeof(ZettaRouter_t));
+    router->address = address;
+    router->type = MSG_ROUTE;
+    router->interval = interval;
+    router->dead = (uint16_t)(interval * 4);
+    router->on_deliver = on_deliver;
+    router->ctx = ctx;
+    router->triggered = 1;
+}
+
+ZettaError_t zetta_route_add_port(ZettaRouter_t* router, Zetta_t* hzetta)
+{
+    if (router->nports >= ZETTA_ROUTE_MAX_PORTS)
+        return ZETTA_ERROR;
+
+    ZettaRoutePort_t* port = &router->ports[router->nports++];
+    memset(port, 0, sizeof(ZettaRoutePort_t));
+    port->hzetta = hzetta;
+    port->neighbor = ZETTA_ROUTE_NONE;
+    return ZETTA_OK;
+}
+
+uint16_t zetta_route_link_cost(ZettaRouter_t* router, uint8_t i)
+{
+    ZettaRoutePort_t* port = &router->ports[i];
+    // No RTT sample yet: assume one interval
+    uint32_t base = port->srtt ? port->srtt / 2 : router->interval;
+    if (base == 0)
+        base = 1;
+    uint32_t cost = base * (256u + 4u * port->loss + 4u * port->busy) / 256u;
+    if (cost == 0)
+        cost = 1;
+    return cost > ZETTA_ROUTE_MAX_COST ? ZETTA_ROUTE_MAX_COST : (uint16_t)cost;
+}
+
+static uint16_t zetta_route_add_hop(uint16_t metric, uint16_t cost)
+{
+    if (metric == ZETTA_ROUTE_INF)
+        return ZETTA_ROUTE_INF;
+    uint16_t hops = (uint16_t)(ZETTA_ROUTE_HOPS(metric) + 1);
+    if (hops >= 15)
+        return ZETTA_ROUTE_INF;
+    uint32_t sum = (uint32_t)ZETTA_ROUTE_COST(metric) + cost;
+    if (sum > ZETTA_ROUTE_MAX_COST)
+        sum = ZETTA_ROUTE_MAX_COST;
+    return (uint16_t)((hops << 12) | sum);
+}
+
+static ZettaRouteEntry_t* zetta_route_find(ZettaRouter_t* router, uint8_t dest)
+{
+    for (uint8_t i = 0; i < router->nroutes; i++)
+    {
+        if (router->routes[i].dest == dest)
+            return &router->routes[i];
+    }
+    return NULL;
+}
+
+const ZettaRouteEntry_t* zetta_route_lookup(ZettaRouter_t* router, uint8_t dst)
+{
+    ZettaRouteEntry_t* e = zetta_route_find(router, dst);
+    return (e && e->metric != ZETTA_ROUTE_INF) ? e : NULL;
+}
+
+static void zetta_route_update(ZettaRouter_t* router, uint8_t dest,
+                               uint8_t port, uint16_t metric, uint32_t now)
+{
+    if (dest == router->address)
+        return;
+
+    ZettaRouteEntry_t* e = zetta_route_find(router, dest);
+    if (!e)
+    {
+        if (metric == ZETTA_ROUTE_INF ||
+            router->nroutes >= ZETTA_ROUTE_MAX_NODES)
+            return;
+        e = &router->routes[router->nroutes++];
+        e->dest = dest;
+        e->port = port;
+        e->metric = metric;
+        e->updated = now;
+        router->changes++;
+        router->triggered = 1;
+        return;
+    }
+
+    if (e->port == port)
+    {
+        // The current next hop is always believed, also when it got worse
+        if (metric == ZETTA_ROUTE_INF)
+        {
+            if (e->metric != ZETTA_ROUTE_INF)
+            {
+                e->metric = ZETTA_ROUTE_INF;
+                e->updated = now; // start of the garbage collection timer
+                router->changes++;
+                router->triggered = 1;
+            }
+            return;
+        }
+        if (e->metric == ZETTA_ROUTE_INF)
+        {
+            router->changes++;
+            router->triggered = 1;
+        }
+        e->metric = metric;
+        e->updated = now;
+        return;
+    }
+
+    if (metric == ZETTA_ROUTE_INF)
+        return;
+    // Another next hop must be clearly better, RTT noise must not flap routes
+    uint16_t cur = ZETTA_ROUTE_COST(e->metric);
+    if (e->metric == ZETTA_ROUTE_INF ||
+        ZETTA_ROUTE_COST(metric) < cur - cur / 8)
+    {
+        e->port = port;
+        e->metric = metric;
+        e->updated = now;
+        router->changes++;
+        router->triggered = 1;
+    }
+}
+
+static void zetta_route_tx(ZettaRoutePort_t* port, const uint8_t* payload,
+                           uint8_t len, uint8_t type)
+{
+    // Never block in zetta_send, queued frames go out from zetta_route_poll
+    if (port->txq_count == 0 &&
+        port->hzetta->_internal.pstate != ZETTA_STATE_TX_BUSY)
+    {
+        if (zetta_send(port->hzetta, (ZettaPacketType_t)type,
+                       (void*)payload, len) != ZETTA_ERROR_TX_BUSY)
+            return;
+    }
+    if (port->txq_count >= ZETTA_ROUTE_TXQ_DEPTH)
+    {
+        port->txq_dropped++;
+        return;
+    }
+    ZettaRouteFrame_t* f =
+        &port->txq[(port->txq_head + port->txq_count) % ZETTA_ROUTE_TXQ_DEPTH];
+    f->len = len;
+    memcpy(f->payload, payload, len);
+    port->txq_count++;
+}
+
+static void zetta_route_drain(ZettaRoutePort_t* port, uint8_t type)
+{
+    while (port->txq_count &&
+           port->hzetta->_internal.pstate != ZETTA_STATE_TX_BUSY)
+    {
+        ZettaRouteFrame_t* f = &port->txq[port->txq_head];
+        if (zetta_send(port->hzetta, (ZettaPacketType_t)type, f->payload,
+                       f->len) == ZETTA_ERROR_TX_BUSY)
+            break;
+        port->txq_head = (uint8_t)((port->txq_head + 1) % ZETTA_ROUTE_TXQ_DEPTH);
+        port->txq_count--;
+    }
+}
+
+static void zetta_route_send_vectors(ZettaRouter_t* router, uint8_t i,
+                                     uint32_t now)
+{
+    ZettaRoutePort_t* port = &router->ports[i];
+    uint8_t msg[MAX_PAYLOAD_SIZE];
+    uint8_t r = 0;
+
+    // At least one frame, an empty vector still carries the timestamps
+    do
+    {
+        uint8_t len = ZETTA_ROUTE_VECTOR_HDR;
+        msg[0] = ZR_VECTOR;
+        msg[1] = router->address;
+        msg[2] = port->tx_seq++;
+        zetta_route_put_u16(&msg[3], (uint16_t)now);
+        zetta_route_put_u16(&msg[5], port->echo_t);
+        zetta_route_put_u16(&msg[7], port->neighbor == ZETTA_ROUTE_NONE
+                                         ? 0xFFFF
+                                         : (uint16_t)(now - port->echo_at));
+        for (; r < router->nroutes && len + 3 <= MAX_PAYLOAD_SIZE; r++)
+        {
+            ZettaRouteEntry_t* e = &router->routes[r];
+            // Poisoned reverse: never offer a route back to its next hop
+            uint16_t metric = e->port == i ? ZETTA_ROUTE_INF : e->metric;
+            msg[len] = e->dest;
+            zetta_route_put_u16(&msg[len + 1], metric);
+            len += 3;
+        }
+        zetta_route_tx(port, msg, len, router->type);
+    } while (r < router->nroutes);
+}
+
+static void zetta_route_port_down(ZettaRouter_t* router, uint8_t i,
+                                  uint32_t now)
+{
+    ZettaRoutePort_t* port = &router->ports[i];
+    port->neighbor = ZETTA_ROUTE_NONE;
+    port->srtt = 0;
+    port->loss = 0;
+    for (uint8_t r = 0; r < router->nroutes; r++)
+    {
+        ZettaRouteEntry_t* e = &router->routes[r];
+        if (e->port == i && e->metric != ZETTA_ROUTE_INF)
+        {
+            e->metric = ZETTA_ROUTE_INF;
+            e->updated = now;
+            router->changes++;
+        }
+    }
+    router->triggered = 1;
+}
+
+static void zetta_route_on_vector(ZettaRouter_t* router, uint8_t i,
+                                  const uint8_t* msg, uint8_t len,
+                                  uint32_t now)
+{
+    ZettaRoutePort_t* port = &router->ports[i];
+    uint8_t src = msg[1];
+    uint8_t seq = msg[2];
+    uint16_t hold = zetta_route_get_u16(&msg[7]);
+
+    if (port->neighbor != src)
+    {
+        // New neighbour, the first vector counts no loss
+        port->neighbor = src;
+        port->rx_seq = (uint8_t)(seq - 1);
+        router->triggered = 1;
+    }
+    uint8_t missed = (uint8_t)(seq - port->rx_seq - 1);
+    for (uint8_t k = 0; k < missed && k < 8; k++)
+        port->loss = (uint8_t)(port->loss + ((255 - port->loss) >> 3));
+    port->loss = (uint8_t)(port->loss - (port->loss >> 3));
+    port->rx_seq = seq;
+
+    if (hold != 0xFFFF)
+    {
+        uint16_t rtt = (uint16_t)((uint16_t)now - zetta_route_get_u16(&msg[5]) -
+                                  hold);
+        if (port->srtt == 0)
+            port->srtt = rtt ? rtt : 1;
+        else
+            port->srtt = (uint16_t)(port->srtt + ((int32_t)rtt - port->srtt) / 8);
+        if (port->srtt == 0)
+            port->srtt = 1;
+    }
+    port->echo_t = zetta_route_get_u16(&msg[3]);
+    port->echo_at = now;
+    port->last_rx = now;
+
+    uint16_t cost = zetta_route_link_cost(router, i);
+    zetta_route_update(router, src, i, zetta_route_add_hop(0, cost), now);
+    for (uint8_t p = ZETTA_ROUTE_VECTOR_HDR; p + 3 <= len; p += 3)
+    {
+        zetta_route_update(router, msg[p], i,
+                           zetta_route_add_hop(zetta_route_get_u16(&msg[p + 1]),
+                                               cost),
+                           now);
+    }
+}
+
+static void zetta_route_forward(ZettaRouter_t* router, uint8_t* msg,
+                                uint8_t len)
+{
+    const ZettaRouteEntry_t* e = zetta_route_lookup(router, msg[1]);
+    if (!e)
+    {
+        router->no_route++;
+        return;
+    }
+    zetta_route_tx(&router->ports[e->port], msg, len, router->type);
+}
+
+uint8_t zetta_route_on_rx(ZettaRouter_t* router, Zetta_t* hzetta, uint32_t now)
+{
+    if ((uint8_t)Zetta_GetType(hzetta) != router->type)
+        return 0;
+
+    uint8_t i = 0;
+    while (i < router->nports && router->ports[i].hzetta != hzetta)
+        i++;
+    if (i == router->nports)
+        return 0;
+
+    uint8_t msg[MAX_PAYLOAD_SIZE];
+    uint8_t len = Zetta_GetLength(hzetta);
+    Zetta_GetPayload(hzetta, msg);
+
+    if (len >= ZETTA_ROUTE_VECTOR_HDR && msg[0] == ZR_VECTOR)
+    {
+        zetta_route_on_vector(router, i, msg, len, now);
+    }
+    else if (len >= ZETTA_ROUTE_DATA_HDR && msg[0] == ZR_DATA)
+    {
+        if (msg[1] == router->address)
+        {
+            router->delivered++;
+            if (router->on_deliver)
+                router->on_deliver(router->ctx, msg[2], msg[4],
+                                   &msg[ZETTA_ROUTE_DATA_HDR],
+                                   (uint8_t)(len - ZETTA_ROUTE_DATA_HDR));
+        }
+        else if (msg[3] <= 1)
+        {
+            router->ttl_expired++;
+        }
+        else
+        {
+            msg[3]--;
+            router->forwarded++;
+            zetta_route_forward(router, msg, len);
+        }
+    }
+    return 1;
+}
+
+ZettaError_t zetta_route_send(ZettaRouter_t* router, uint8_t dst, uint8_t type,
+                              const void* pData, uint8_t len)
+{
+    if (len > MAX_PAYLOAD_SIZE - ZETTA_ROUTE_DATA_HDR)
+        return ZETTA_ERROR_PAYLOAD_TOO_LARGE;
+    if (dst == router->address)
+    {
+        router->delivered++;
+        if (router->on_deliver)
+            router->on_deliver(router->ctx, dst, type, (const uint8_t*)pData,
+                               len);
+        return ZETTA_OK;
+    }
+
+    const ZettaRouteEntry_t* e = zetta_route_lookup(router, dst);
+    if (!e)
+    {
+        router->no_route++;
+        return ZETTA_ERROR;
+    }
+    uint8_t msg[MAX_PAYLOAD_SIZE];
+    msg[0] = ZR_DATA;
+    msg[1] = dst;
+    msg[2] = router->address;
+    msg[3] = ZETTA_ROUTE_TTL;
+    msg[4] = type;
+    memcpy(&msg[ZETTA_ROUTE_DATA_HDR], pData, len);
+    zetta_route_tx(&router->ports[e->port], msg,
+                   (uint8_t)(ZETTA_ROUTE_DATA_HDR + len), router->type);
+    return ZETTA_OK;
+}
+
+void zetta_route_poll(ZettaRouter_t* router, uint32_t now)
+{
+    for (uint8_t i = 0; i < router->nports; i++)
+    {
+        ZettaRoutePort_t* port = &router->ports[i];
+        if (port->neighbor != ZETTA_ROUTE_NONE &&
+            now - port->last_rx > router->dead)
+            zetta_route_port_down(router, i, now);
+    }
+
+    for (uint8_t r = 0; r < router->nroutes;)
+    {
+        ZettaRouteEntry_t* e = &router->routes[r];
+        if (now - e->updated > router->dead)
+        {
+            if (e->metric != ZETTA_ROUTE_INF)
+            {
+                e->metric = ZETTA_ROUTE_INF;
+                e->updated = now;
+                router->changes++;
+                router->triggered = 1;
+            }
+            else
+            {
+                // Unreachable for a whole timeout, neighbours know by now
+                *e = router->routes[--router->nroutes];
+                continue;
+            }
+        }
+        r++;
+    }
+
+    uint32_t since = now - router->last_vector;
+    if (since >= router->interval ||
+        (router->triggered && since >= router->interval / 4u))
+    {
+        for (uint8_t i = 0; i < router->nports; i++)
+        {
+            ZettaRoutePort_t* port = &router->ports[i];
+            // Utilization sample, once per interval
+            if (port->txq_count ||
+                port->hzetta->_internal.pstate == ZETTA_STATE_TX_BUSY)
+                port->busy = (uint8_t)(port->busy + ((255 - port->busy) >> 3));
+            else
+                port->busy = (uint8_t)(port->busy - (port->busy >> 3));
+            zetta_route_send_vectors(router, i, now);
+        }
+        router->last_vector = now;
+        router->triggered = 0;
+    }
+
+    for (uint8_t i = 0; i < router->nports; i++)
+        zetta_route_drain(&router->ports[i], router->type);
+}
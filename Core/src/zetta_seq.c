@@ -0,0 +1,149 @@
+#include "zetta_seq.h"
+#include <string.h>
+
+static int16_t zetta_seq_tx_hook(void* ctx, uint8_t type);
+static uint8_t zetta_seq_rx_hook(void* ctx, uint8_t type, uint8_t seq);
+static uint8_t zetta_seq_size_hook(void* ctx, uint8_t type);
+
+void zetta_seq_attach(Zetta_t* hzetta, ZettaSeq_t* seq,
+                      ZettaSeqChannel_t* channels, uint8_t nchannels)
+{
+    memset(channels, 0, nchannels * sizeof(ZettaSeqChannel_t));
+    seq->channels = channels;
+    seq->nchannels = nchannels;
+    seq->count = 0;
+    zetta_set_seq_hooks(hzetta, zetta_seq_tx_hook, zetta_seq_rx_hook, seq);
+    zetta_set_seq_size_hook(hzetta, zetta_seq_size_hook);
+}
+
+ZettaSeqChannel_t* zetta_seq_channel(ZettaSeq_t* seq, uint8_t type)
+{
+    for (uint8_t i = 0; i < seq->count; i++)
+    {
+        if (seq->channels[i].type == type)
+            return &seq->channels[i];
+    }
+    return NULL;
+}
+
+ZettaError_t zetta_seq_enable(ZettaSeq_t* seq, uint8_t type)
+{
+    if (zetta_seq_channel(seq, type))
+        return ZETTA_OK;
+    if (seq->count >= seq->nchannels)
+        return ZETTA_ERROR;
+
+    ZettaSeqChannel_t* ch = &seq->channels[seq->count++];
+    memset(ch, 0, sizeof(ZettaSeqChannel_t));
+    ch->type = type;
+    return ZETTA_OK;
+}
+
+const ZettaSeqStats_t* zetta_seq_get_stats(ZettaSeq_t* seq, uint8_t type)
+{
+    ZettaSeqChannel_t* ch = zetta_seq_channel(seq, type);
+    return ch ? &ch->stats : NULL;
+}
+
+static void zetta_seq_ewma(ZettaSeqStats_t* st, uint8_t lost)
+{
+    if (lost)
+        st->loss_ewma += (uint16_t)((0xFFFFu - st->loss_ewma) >>
+                                    ZETTA_SEQ_EWMA_SHIFT);
+    else
+        st->loss_ewma -= (uint16_t)(st->loss_ewma >> ZETTA_SEQ_EWMA_SHIFT);
+}
+
+static uint8_t zetta_seq_burst_bin(uint8_t burst)
+{
+    uint8_t bin = 0;
+    uint8_t limit = 1;
+    while (bin < ZETTA_SEQ_BURST_BINS - 1 && burst > limit)
+    {
+        bin++;
+        limit <<= 1;
+    }
+    return bin;
+}
+
+void zetta_seq_track(ZettaSeqChannel_t* ch, uint8_t seq)
+{
+    ZettaSeqStats_t* st = &ch->stats;
+    uint8_t gap = (uint8_t)(seq - ch->rx_expected);
+
+    st->received++;
+    if (!ch->rx_synced || (gap >= 128 && ch->stale >= ZETTA_SEQ_RESYNC))
+    {
+        // First frame or the sender restarted
+        if (ch->rx_synced)
+            st->resyncs++;
+        ch->rx_synced = 1;
+        ch->rx_expected = (uint8_t)(seq + 1);
+        ch->window = 0;
+        ch->stale = 0;
+        zetta_seq_ewma(st, 0);
+        return;
+    }
+
+    if (gap < 128)
+    {
+        // In order (gap 0) or after `gap` lost frames
+        ch->stale = 0;
+        if (gap)
+        {
+            st->lost += gap;
+            st->bursts[zetta_seq_burst_bin(gap)]++;
+            for (uint8_t i = 0; i < gap && i < ZETTA_SEQ_WINDOW; i++)
+                zetta_seq_ewma(st, 1);
+        }
+        zetta_seq_ewma(st, 0);
+
+        uint8_t shift = (uint8_t)(gap + 1);
+        ch->window = (shift >= ZETTA_SEQ_WINDOW) ? 0 : ch->window << shift;
+        // bits 1..gap are the frames that were skipped
+        if (gap >= ZETTA_SEQ_WINDOW - 1)
+            ch->window |= 0xFFFFFFFEu;
+        else
+            ch->window |= ((1u << gap) - 1u) << 1;
+        ch->rx_expected = (uint8_t)(seq + 1);
+        return;
+    }
+
+    // Older than expected: late arrival of a lost frame or a duplicate
+    uint8_t age = (uint8_t)(ch->rx_expected - 1 - seq);
+    if (age > 0 && age < ZETTA_SEQ_WINDOW && (ch->window & (1u << age)))
+    {
+        ch->window &= ~(1u << age);
+        st->lost--;
+        st->reordered++;
+        ch->stale = 0;
+    }
+    else
+    {
+        st->duplicates++;
+        st->received--;
+        ch->stale++;
+    }
+}
+
+static int16_t zetta_seq_tx_hook(void* ctx, uint8_t type)
+{
+    ZettaSeqChannel_t* ch = zetta_seq_channel(ctx, type);
+    if (!ch)
+        return -1;
+    return ch->tx_seq++;
+}
+
+static uint8_t zetta_seq_rx_hook(void* ctx, uint8_t type, uint8_t seq)
+{
+    ZettaSeqChannel_t* ch = zetta_seq_channel(ctx, type);
+    if (!ch)
+        return 0;
+    zetta_seq_track(ch, seq);
+    return 1;
+}
+
+static uint8_t zetta_seq_size_hook(void* ctx, uint8_t type)
+{
+    return zetta_seq_channel(ctx, type) ? 1 : 0;
+}
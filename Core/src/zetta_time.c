@@ -0,0 +1,186 @@
+#include "zetta_time.h"
+#include <string.h>
+
+static uint8_t zetta_time_tx_hook(void* ctx, uint8_t type, uint8_t* field);
+static int8_t zetta_time_rx_hook(void* ctx, uint8_t type, const uint8_t* data,
+                                 uint8_t len);
+static int8_t zetta_time_size_hook(void* ctx, uint8_t type,
+                                   const uint8_t* data, uint8_t len);
+static void zetta_time_commit_hook(void* ctx, uint8_t type, uint8_t size);
+
+void zetta_time_attach(Zetta_t* hzetta, ZettaTime_t* tm, ZettaTimeNow now)
+{
+    memset(tm, 0, sizeof(ZettaTime_t));
+    tm->now = now;
+    tm->full_interval = ZETTA_TIME_FULL_INTERVAL;
+    zetta_set_time_hooks(hzetta, zetta_time_tx_hook, zetta_time_rx_hook, tm);
+    zetta_set_time_size_hook(hzetta, zetta_time_size_hook);
+    zetta_set_time_commit_hook(hzetta, zetta_time_commit_hook);
+}
+
+void zetta_time_enable(ZettaTime_t* tm, uint8_t type)
+{
+    tm->type_map[type >> 3] |= (uint8_t)(1u << (type & 7));
+}
+
+uint8_t zetta_time_enabled(ZettaTime_t* tm, uint8_t type)
+{
+    return (tm->type_map[type >> 3] >> (type & 7)) & 1u;
+}
+
+ZettaError_t zetta_time_send(Zetta_t* hzetta, ZettaTime_t* tm,
+                             ZettaPacketType_t type, void* pData, uint8_t len,
+                             uint32_t ticks)
+{
+    tm->tx_next = ticks;
+    tm->tx_given = 1;
+    ZettaError_t err = zetta_send(hzetta, type, pData, len);
+    tm->tx_given = 0;
+    return err;
+}
+
+uint8_t zetta_time_get(ZettaTime_t* tm, uint32_t* ticks)
+{
+    if (!tm->rx_valid)
+        return 0;
+    *ticks = tm->rx_time;
+    return 1;
+}
+
+// Field of ticks against the encoder state, the state is left alone
+static uint8_t zetta_time_field(const ZettaTime_t* tm, uint32_t ticks,
+                                uint8_t* field)
+{
+    int32_t delta = (int32_t)(ticks - tm->tx_ref);
+
+    if (!tm->tx_synced || tm->tx_count >= tm->full_interval ||
+        delta <= -ZETTA_TIME_MEDIUM_DELTA || delta >= ZETTA_TIME_MEDIUM_DELTA)
+    {
+        field[0] = 0xC0;
+        field[1] = (uint8_t)ticks;
+        field[2] = (uint8_t)(ticks >> 8);
+        field[3] = (uint8_t)(ticks >> 16);
+        field[4] = (uint8_t)(ticks >> 24);
+        return 5;
+    }
+    if (delta > -ZETTA_TIME_SHORT_DELTA && delta < ZETTA_TIME_SHORT_DELTA)
+    {
+        field[0] = (uint8_t)(ticks & 0x7F);
+        return 1;
+    }
+    field[0] = (uint8_t)(0x80 | (ticks & 0x3F));
+    field[1] = (uint8_t)(ticks >> 6);
+    return 2;
+}
+
+// Advance the encoder past a field of that size for ticks
+static void zetta_time_advance(ZettaTime_t* tm, uint32_t ticks, uint8_t size)
+{
+    if (size == 5)
+    {
+        tm->tx_synced = 1;
+        tm->tx_count = 0;
+        tm->stats.tx_full++;
+    }
+    else if (size == 1)
+        tm->stats.tx_short++;
+    else
+        tm->stats.tx_medium++;
+    tm->tx_count++;
+    tm->tx_ref = ticks;
+}
+
+uint8_t zetta_time_encode(ZettaTime_t* tm, uint32_t ticks, uint8_t* field)
+{
+    uint8_t size = zetta_time_field(tm, ticks, field);
+    zetta_time_advance(tm, ticks, size);
+    return size;
+}
+
+// Timestamp nearest to ref whose low `bits` bits are low
+static uint32_t zetta_time_unwrap(uint32_t ref, uint32_t low, uint8_t bits)
+{
+    uint32_t mask = (1u << bits) - 1u;
+    uint32_t diff = (low - ref) & mask;
+    if (diff & (1u << (bits - 1)))
+        return ref + diff - (mask + 1u); // behind ref
+    return ref + diff;
+}
+
+// Field size told by its first byte
+static uint8_t zetta_time_field_size(uint8_t tag)
+{
+    return (tag & 0x80) ? ((tag & 0x40) ? 5 : 2) : 1;
+}
+
+int8_t zetta_time_decode(ZettaTime_t* tm, const uint8_t* data, uint8_t len)
+{
+    if (len < 1)
+        return -1;
+    uint8_t tag = data[0];
+    uint8_t size = zetta_time_field_size(tag);
+    if (len < size)
+        return -1;
+
+    tm->stats.rx_frames++;
+    if (size == 5)
+    {
+        tm->rx_time = (uint32_t)data[1] | (uint32_t)data[2] << 8 |
+                      (uint32_t)data[3] << 16 | (uint32_t)data[4] << 24;
+        tm->rx_synced = 1;
+    }
+    else if (!tm->rx_synced)
+    {
+        tm->stats.rx_unsynced++;
+        tm->rx_valid = 0;
+        return (int8_t)size;
+    }
+    else if (size == 1)
+    {
+        tm->rx_time = zetta_time_unwrap(tm->rx_ref, tag & 0x7F, 7);
+    }
+    else
+    {
+        uint32_t low = (uint32_t)(tag & 0x3F) | (uint32_t)data[1] << 6;
+        tm->rx_time = zetta_time_unwrap(tm->rx_ref, low, 14);
+    }
+    tm->rx_ref = tm->rx_time;
+    tm->rx_valid = 1;
+    return (int8_t)size;
+}
+
+static uint8_t zetta_time_tx_hook(void* ctx, uint8_t type, uint8_t* field)
+{
+    ZettaTime_t* tm = ctx;
+    if (!zetta_time_enabled(tm, type))
+        return 0;
+    // zetta_send commits the field once the frame is out
+    tm->tx_pending = tm->tx_given ? tm->tx_next : (tm->now ? tm->now() : 0);
+    return zetta_time_field(tm, tm->tx_pending, field);
+}
+
+static void zetta_time_commit_hook(void* ctx, uint8_t type, uint8_t size)
+{
+    (void)type;
+    zetta_time_advance(ctx, ((ZettaTime_t*)ctx)->tx_pending, size);
+}
+
+static int8_t zetta_time_rx_hook(void* ctx, uint8_t type, const uint8_t* data,
+                                 uint8_t len)
+{
+    ZettaTime_t* tm = ctx;
+    tm->rx_valid = 0;
+    if (!zetta_time_enabled(tm, type))
+        return 0;
+    return zetta_time_decode(tm, data, len);
+}
+
+static int8_t zetta_time_size_hook(void* ctx, uint8_t type,
+                                   const uint8_t* data, uint8_t len)
+{
+    if (!zetta_time_enabled(ctx, type))
+        return 0;
+    if (len < 1)
+        return -1;
+    return (int8_t)zetta_time_field_size(data[0]);
+}
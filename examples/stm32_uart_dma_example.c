@@ -51,6 +51,9 @@ struct MetricPacket
 #pragma pack(pop)
 
 struct MetricPacket metbj = {0};
+// Fixed size type, its frames carry no LEN byte (implicit length)
+#define MSG_METRIC 0x20
+uint8_t zetta_sizes[ZETTA_SIZE_TABLE_LEN];
 
 char test1[] = "hello world";
 #pragma pack(push, 1)
@@ -104,12 +107,18 @@ int main(void)
     memcpy(test2.test3, "moka", 4);
 
     test2.price = 20.2f;
+    zetta_size_table_init(zetta_sizes);
+    zetta_sizes[MSG_METRIC] = sizeof(struct MetricPacket);
     // Transmition
     zetta_init(&hzettatx, zetta1_interface);
+    zetta_set_size_table(&hzettatx, zetta_sizes);
     zetta_send(&hzettatx, MSG_PUBLISH, &test2, sizeof(test2));
     zetta_send(&hzettatx, MSG_PUBLISH, test1, sizeof(test1));
+    zetta_send(&hzettatx, MSG_METRIC, &metbj, sizeof(metbj));
     // reception
     zetta_init(&hzettarx, zetta1_interface);
+    zetta_register_type(&hzettarx, MSG_METRIC);
+    zetta_set_size_table(&hzettarx, zetta_sizes);
 
     HAL_UART_Receive_DMA(&huart2, &rx_byte, 1);
     while (1)
@@ -0,0 +1,336 @@
+/**
+ * Native receive pipeline of python/zetta_native.py.
+ *
+ * A reader thread blocks in poll()/read() on the link descriptor, runs the
+ * bytes through zetta_ParseByte() and appends checked frames to a single
+ * producer / single consumer ring. It never touches Python, so parsing does
+ * not compete with Python code for the GIL. The Python receiver thread takes
+ * ready frames in batches with zrx_take(); ctypes releases the GIL while it
+ * waits there.
+ *
+ * The ring is lock free: the reader only writes head, the consumer only
+ * writes tail. A consumer about to sleep sets `waiting`, and the reader then
+ * wakes it through an eventfd once per read() that produced frames. A full
+ * ring stops the reader (`full`) until the consumer took frames, so a slow
+ * consumer pushes back on the link instead of losing frames.
+ *
+ *   gcc -O2 -shared -fPIC -pthread -ICore/inc examples/zetta_host_rx.c \
+ *       Core/src/zetta_protocol.c Core/src/zetta_check.c -o libzetta_rx.so
+ */
+#include "zetta_check.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define ZRX_READ_SIZE 65536
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t len;
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+} ZrxFrame_t;
+
+// Counters are written by the reader and copied without locking
+typedef struct
+{
+    uint64_t rx_bytes;
+    uint32_t rx_frames;
+    uint32_t rx_errors; // all ZettaError_t counters
+    uint32_t crc_errors;
+    uint32_t stalls; // reader waited for room in the ring
+    uint32_t reads;
+    uint32_t wakeups;
+} ZrxStats_t;
+
+typedef struct
+{
+    Zetta_t hz;
+    int fd;
+    int wake_fd;  // reader -> consumer: frames are ready
+    int space_fd; // consumer -> reader: room in the ring
+    int stop_fd; // zrx_close -> reader
+    pthread_t thread;
+    ZrxFrame_t* ring;
+    uint32_t mask;
+    _Atomic uint32_t head; // written by the reader only
+    _Atomic uint32_t tail; // written by the consumer only
+    atomic_int waiting;    // consumer sleeps on wake_fd
+    atomic_int full;       // reader sleeps on space_fd
+    atomic_int done;       // reader stopped, see error
+    int error;             // errno that stopped the reader, 0 for end of file
+    uint32_t stalls;
+    uint32_t reads;
+    uint32_t wakeups;
+} ZettaRx_t;
+
+static void zrx_send(void* data, uint8_t size)
+{
+    (void)data;
+    (void)size;
+}
+
+static void zrx_wake(ZettaRx_t* rx, int always)
+{
+    uint64_t one = 1;
+
+    // Pairs with the fence in zrx_take: either the consumer sees the new
+    // head, or the reader sees it waiting
+    atomic_thread_fence(memory_order_seq_cst);
+    if (always || atomic_load_explicit(&rx->waiting, memory_order_relaxed))
+    {
+        rx->wakeups++;
+        if (write(rx->wake_fd, &one, sizeof(one)) < 0)
+        {
+            // counter saturated, the consumer is awake anyway
+        }
+    }
+}
+
+static void zrx_finish(ZettaRx_t* rx, int error)
+{
+    rx->error = error;
+    atomic_store(&rx->done, 1);
+    zrx_wake(rx, 1);
+}
+
+// Publish the frames so far and wait until the consumer made room, returns 0
+// when zrx_close() interrupted the wait or poll() failed (the reader stops)
+static int zrx_wait_space(ZettaRx_t* rx, uint32_t head)
+{
+    struct pollfd fds[2] = {{rx->space_fd, POLLIN, 0}, {rx->stop_fd, POLLIN, 0}};
+    uint64_t count;
+
+    atomic_store_explicit(&rx->head, head, memory_order_release);
+    zrx_wake(rx, 0);
+    rx->stalls++;
+    atomic_store_explicit(&rx->full, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    while (head - atomic_load_explicit(&rx->tail, memory_order_acquire) > rx->mask)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            // The ring is still full, writing on would overwrite frames
+            zrx_finish(rx, errno);
+            return 0;
+        }
+        if (fds[1].revents)
+            return 0;
+        if (read(rx->space_fd, &count, sizeof(count)) < 0)
+        {
+            // woken by a stale signal
+        }
+    }
+    atomic_store_explicit(&rx->full, 0, memory_order_relaxed);
+    return 1;
+}
+
+static void* zrx_reader(void* arg)
+{
+    ZettaRx_t* rx = (ZettaRx_t*)arg;
+    uint8_t buf[ZRX_READ_SIZE];
+    struct pollfd fds[2] = {{rx->fd, POLLIN, 0}, {rx->stop_fd, POLLIN, 0}};
+
+    for (;;)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            zrx_finish(rx, errno);
+            break;
+        }
+        if (fds[1].revents)
+            break; // zrx_close
+        ssize_t n = read(rx->fd, buf, sizeof(buf));
+        if (n < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            zrx_finish(rx, errno);
+            break;
+        }
+        if (n == 0)
+        {
+            zrx_finish(rx, 0);
+            break;
+        }
+        rx->reads++;
+
+        uint32_t first = atomic_load_explicit(&rx->head, memory_order_relaxed);
+        uint32_t head = first;
+        uint32_t tail = atomic_load_explicit(&rx->tail, memory_order_acquire);
+        for (ssize_t i = 0; i < n; i++)
+        {
+            if (zetta_ParseByte(&rx->hz, buf[i]) != ZETTA_OK)
+                continue;
+            if (head - tail > rx->mask)
+            {
+                tail = atomic_load_explicit(&rx->tail, memory_order_acquire);
+                if (head - tail > rx->mask)
+                {
+                    if (!zrx_wait_space(rx, head))
+                        return NULL;
+                    tail = atomic_load_explicit(&rx->tail, memory_order_acquire);
+                }
+            }
+            ZrxFrame_t* f = &rx->ring[head & rx->mask];
+            f->type = (uint8_t)Zetta_GetType(&rx->hz);
+            f->len = Zetta_GetLength(&rx->hz);
+            Zetta_GetPayload(&rx->hz, f->payload);
+            head++;
+        }
+        if (head != first)
+        {
+            atomic_store_explicit(&rx->head, head, memory_order_release);
+            zrx_wake(rx, 0);
+        }
+    }
+    return NULL;
+}
+
+int zrx_stats_size(void)
+{
+    return (int)sizeof(ZrxStats_t);
+}
+
+// ring_frames is rounded up to a power of two. fd stays owned by the caller
+// and must stay open until zrx_close().
+ZettaRx_t* zrx_open(int fd, uint32_t ring_frames)
+{
+    ZettaInterface_t itf = {.send = zrx_send, .computeCRC = zetta_crc8};
+    ZettaRx_t* rx = calloc(1, sizeof(ZettaRx_t));
+    uint32_t size = 1;
+
+    if (!rx)
+        return NULL;
+    while (size < ring_frames)
+        size <<= 1;
+    rx->ring = calloc(size, sizeof(ZrxFrame_t));
+    rx->mask = size - 1;
+    rx->fd = fd;
+    rx->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    rx->space_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    rx->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    zetta_init(&rx->hz, itf);
+    if (!rx->ring || rx->wake_fd < 0 || rx->space_fd < 0 || rx->stop_fd < 0 ||
+        pthread_create(&rx->thread, NULL, zrx_reader, rx) != 0)
+    {
+        if (rx->wake_fd >= 0)
+            close(rx->wake_fd);
+        if (rx->space_fd >= 0)
+            close(rx->space_fd);
+        if (rx->stop_fd >= 0)
+            close(rx->stop_fd);
+        free(rx->ring);
+        free(rx);
+        return NULL;
+    }
+    return rx;
+}
+
+// Copy ready frames to out as records [1 + len][type][payload], waiting up to
+// timeout_ms (-1: forever) when there are none. Returns the bytes written, 0
+// on timeout, -1 once the reader stopped and every frame was taken.
+int32_t zrx_take(ZettaRx_t* rx, uint8_t* out, uint32_t size, int timeout_ms)
+{
+    uint32_t tail = atomic_load_explicit(&rx->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&rx->head, memory_order_acquire);
+    uint32_t used = 0;
+    uint64_t count;
+
+    if (head == tail)
+    {
+        atomic_store_explicit(&rx->waiting, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        head = atomic_load_explicit(&rx->head, memory_order_acquire);
+        if (head == tail && !atomic_load(&rx->done))
+        {
+            struct pollfd p = {rx->wake_fd, POLLIN, 0};
+            poll(&p, 1, timeout_ms);
+        }
+        atomic_store_explicit(&rx->waiting, 0, memory_order_relaxed);
+        if (read(rx->wake_fd, &count, sizeof(count)) < 0)
+        {
+            // nothing signalled
+        }
+        head = atomic_load_explicit(&rx->head, memory_order_acquire);
+        if (head == tail)
+        {
+            if (!atomic_load(&rx->done))
+                return 0;
+            // done is set after the last head update
+            head = atomic_load_explicit(&rx->head, memory_order_acquire);
+            if (head == tail)
+                return -1;
+        }
+    }
+    while (tail != head)
+    {
+        const ZrxFrame_t* f = &rx->ring[tail & rx->mask];
+        if (used + f->len + 2u > size)
+            break;
+        out[used++] = (uint8_t)(f->len + 1);
+        out[used++] = f->type;
+        memcpy(&out[used], f->payload, f->len);
+        used += f->len;
+        tail++;
+    }
+    atomic_store_explicit(&rx->tail, tail, memory_order_release);
+    // Pairs with the fence in zrx_wait_space
+    atomic_thread_fence(memory_order_seq_cst);
+    if (used && atomic_load_explicit(&rx->full, memory_order_relaxed))
+    {
+        uint64_t one = 1;
+        if (write(rx->space_fd, &one, sizeof(one)) < 0)
+        {
+            // counter saturated, the reader is awake anyway
+        }
+    }
+    return (int32_t)used;
+}
+
+// errno that stopped the reader, 0 for end of file or while it runs
+int zrx_error(ZettaRx_t* rx)
+{
+    return atomic_load(&rx->done) ? rx->error : 0;
+}
+
+void zrx_get_stats(ZettaRx_t* rx, ZrxStats_t* out)
+{
+    const ZettaStats_t* s = zetta_get_stats(&rx->hz);
+
+    out->rx_bytes = s->rx_bytes;
+    out->rx_frames = s->rx_frames;
+    out->rx_errors = 0;
+    for (int i = 0; i < ZETTA_ERROR_COUNT; i++)
+        out->rx_errors += s->errors[i];
+    out->crc_errors = s->errors[ZETTA_ERROR_CRC_MISMATCH];
+    out->stalls = rx->stalls;
+    out->reads = rx->reads;
+    out->wakeups = rx->wakeups;
+}
+
+// Stops and joins the reader. No zrx_take() call may be running.
+void zrx_close(ZettaRx_t* rx)
+{
+    uint64_t one = 1;
+
+    if (write(rx->stop_fd, &one, sizeof(one)) < 0)
+    {
+        // an eventfd write of 1 only fails on overflow
+    }
+    pthread_join(rx->thread, NULL);
+    close(rx->wake_fd);
+    close(rx->space_fd);
+    close(rx->stop_fd);
+    free(rx->ring);
+    free(rx);
+}
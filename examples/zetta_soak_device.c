@@ -0,0 +1,132 @@
+/**
+ * C core as the simulated device of python/bench_soak.py.
+ *
+ * Built as a shared library and driven through ctypes. The simulator hands
+ * the bytes of the host -> device wire to soak_feed(); frames sent by the
+ * core leave through the tx callback, and soak_tx_done() completes them once
+ * the simulated wire has serialized them. Frames starting with 'E' are echoed
+ * back, soak_publish() sends telemetry. Frames that meet a busy transmitter
+ * wait in a small ring, as they would in firmware.
+ *
+ *   gcc -O2 -shared -fPIC -ICore/inc examples/zetta_soak_device.c \
+ *       Core/src/zetta_protocol.c Core/src/zetta_check.c -o libzetta_soak.so
+ */
+#include "zetta_check.h"
+#include <string.h>
+
+#define SOAK_QUEUE_SIZE 16 // power of two
+
+typedef void (*SoakTx_t)(const uint8_t* data, uint8_t size);
+
+typedef struct
+{
+    uint32_t rx_frames;
+    uint32_t tx_frames;
+    uint32_t rx_errors; // all ZettaError_t counters
+    uint32_t echoed;
+    uint32_t published;
+    uint32_t dropped; // queue full
+    uint32_t queued;  // current depth
+    uint32_t peak;
+} SoakStats_t;
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t len;
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+} SoakFrame_t;
+
+static Zetta_t hz;
+static SoakTx_t soak_tx;
+static SoakFrame_t queue[SOAK_QUEUE_SIZE];
+static uint32_t q_head;
+static uint32_t q_tail;
+static SoakStats_t stats;
+
+static void soak_send(void* data, uint8_t size)
+{
+    if (soak_tx)
+        soak_tx((const uint8_t*)data, size);
+}
+
+static int soak_queue_send(uint8_t type, const uint8_t* data, uint8_t len)
+{
+    if (len > MAX_PAYLOAD_SIZE)
+        return 0;
+    if (hz._internal.pstate != ZETTA_STATE_TX_BUSY && q_head == q_tail)
+    {
+        zetta_send(&hz, (ZettaPacketType_t)type, (void*)data, len);
+        return 1;
+    }
+    if (q_head - q_tail == SOAK_QUEUE_SIZE)
+    {
+        stats.dropped++;
+        return 0;
+    }
+    SoakFrame_t* f = &queue[q_head++ & (SOAK_QUEUE_SIZE - 1)];
+    f->type = type;
+    f->len = len;
+    memcpy(f->payload, data, len);
+    if (q_head - q_tail > stats.peak)
+        stats.peak = q_head - q_tail;
+    return 1;
+}
+
+int soak_init(SoakTx_t tx)
+{
+    ZettaInterface_t itf = {.send = soak_send, .computeCRC = zetta_crc8};
+
+    zetta_init(&hz, itf);
+    soak_tx = tx;
+    q_head = q_tail = 0;
+    memset(&stats, 0, sizeof(stats));
+    return (int)sizeof(SoakStats_t);
+}
+
+void soak_feed(const uint8_t* data, uint32_t size)
+{
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        if (zetta_ParseByte(&hz, data[i]) != ZETTA_OK)
+            continue;
+        uint8_t len = Zetta_GetLength(&hz);
+        Zetta_GetPayload(&hz, payload);
+        if (len && payload[0] == 'E' &&
+            soak_queue_send((uint8_t)Zetta_GetType(&hz), payload, len))
+            stats.echoed++;
+    }
+}
+
+int soak_publish(const uint8_t* data, uint8_t len)
+{
+    if (!soak_queue_send(MSG_PUBLISH, data, len))
+        return 0;
+    stats.published++;
+    return 1;
+}
+
+void soak_tx_done(void)
+{
+    zetta_transmit_cplt_clb(&hz);
+    if (q_head != q_tail)
+    {
+        SoakFrame_t* f = &queue[q_tail++ & (SOAK_QUEUE_SIZE - 1)];
+        zetta_send(&hz, (ZettaPacketType_t)f->type, f->payload, f->len);
+    }
+}
+
+void soak_get_stats(SoakStats_t* out)
+{
+    const ZettaStats_t* s = zetta_get_stats(&hz);
+
+    stats.rx_frames = s->rx_frames;
+    stats.tx_frames = s->tx_frames;
+    stats.rx_errors = 0;
+    for (int i = 0; i < ZETTA_ERROR_COUNT; i++)
+        stats.rx_errors += s->errors[i];
+    stats.queued = q_head - q_tail;
+    *out = stats;
+}
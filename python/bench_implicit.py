@@ -0,0 +1,65 @@
+# bench_implicit.py
+"""
+Implicit length frames against frames that always carry LEN.
+
+A stream of telemetry where most types have a fixed size (packed structs)
+and a few are variable is encoded with the classic profile, once with LEN in
+every frame and once with a size table. Reports wire bytes per frame, the
+frame rate a 115200 baud link carries and host decode time.
+
+    python bench_implicit.py --frames 200000
+"""
+import argparse
+import random
+import struct
+import time
+
+from zetta_profile import FrameDecoder, classic_profile
+
+# type: payload size, None for variable size
+TRAFFIC = {
+    0x20: struct.calcsize('<If5s'),   # metric (examples/stm32_uart_dma_example.c)
+    0x21: struct.calcsize('<4sif'),   # MyStruct
+    0x22: struct.calcsize('<hhh'),    # IMU sample
+    0x23: struct.calcsize('<H'),      # status word
+    0x01: None,                       # MSG_PUBLISH text
+}
+
+def stream(frames: int, seed: int = 1):
+    rng = random.Random(seed)
+    types = list(TRAFFIC)
+    weights = [20, 10, 50, 15, 5]
+    for packet_type in rng.choices(types, weights, k=frames):
+        size = TRAFFIC[packet_type]
+        if size is None:
+            size = rng.randint(0, 25)
+        yield packet_type, bytes(rng.getrandbits(8) for _ in range(size))
+
+def run(frames: int, baud: int, implicit: bool) -> dict:
+    sizes = {t: s for t, s in TRAFFIC.items() if s is not None} if implicit else None
+    profile = classic_profile(sizes=sizes)
+    data = b''.join(profile.encode(t, p) for t, p in stream(frames))
+    decoder = FrameDecoder((profile,))
+    start = time.perf_counter()
+    decoded = 0
+    for pos in range(0, len(data), 4096):
+        decoded += len(decoder.feed(data[pos:pos + 4096]))
+    elapsed = time.perf_counter() - start
+    assert decoded == frames
+    per_frame = len(data) / frames
+    return {'bytes/frame': per_frame, 'frames/s @baud': baud / 10 / per_frame,
+            'decode us/frame': elapsed / frames * 1e6}
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--frames', type=int, default=200000)
+    parser.add_argument('--baud', type=int, default=115200)
+    args = parser.parse_args()
+    for implicit in (False, True):
+        r = run(args.frames, args.baud, implicit)
+        print(f"{'implicit' if implicit else 'explicit':>9}  {r['bytes/frame']:6.2f} bytes/frame  "
+              f"{r['frames/s @baud']:8.0f} frames/s at {args.baud} baud  "
+              f"decode {r['decode us/frame']:5.2f} us/frame")
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,82 @@
+# bench_join.py
+"""
+Throughput, latency and memory of StreamJoin.
+
+Several devices sample at their own rate on a common timebase. Their samples
+reach the host over links with a fixed delay plus jitter, a few are delayed
+far beyond the lateness bound. Events are replayed in host arrival order
+through the join as fast as possible; the benchmark reports the join rate,
+the emission latency (host time - sample time), the peak buffer size and
+the late samples.
+
+    python bench_join.py --rates 1000 500 200 100 --seconds 20
+"""
+import argparse
+import heapq
+import random
+import statistics
+import time
+
+from zetta_join import StreamJoin
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--rates', type=float, nargs='+', default=[1000, 500, 200, 100],
+                        help='samples per second of every stream, first is the reference')
+    parser.add_argument('--seconds', type=float, default=20.0)
+    parser.add_argument('--delay', type=float, default=0.002, help='link delay (s)')
+    parser.add_argument('--jitter', type=float, default=0.002, help='link jitter (s)')
+    parser.add_argument('--straggle', type=float, default=0.001,
+                        help='fraction of samples delayed by 50 ms')
+    parser.add_argument('--tolerance', type=float, default=0.005)
+    parser.add_argument('--lateness', type=float, default=0.003)
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    events = []
+    for i, rate in enumerate(args.rates):
+        phase = rng.random() / rate
+        delay = args.delay * (1 + i)  # every link a little slower
+        for k in range(int(args.seconds * rate)):
+            t = phase + k / rate
+            arrival = t + delay + rng.random() * args.jitter
+            if rng.random() < args.straggle:
+                arrival += 0.05
+            events.append((arrival, i, t))
+    heapq.heapify(events)
+    events = [heapq.heappop(events) for _ in range(len(events))]
+
+    now = [0.0]
+    latency = []
+    join = StreamJoin(lambda r: latency.append(now[0] - r.time),
+                      tolerance=args.tolerance, lateness=args.lateness,
+                      clock=lambda: now[0])
+    names = [f"s{i}" for i in range(len(args.rates))]
+    for name in names:
+        join.add_stream(name)
+
+    start = time.perf_counter()
+    for arrival, i, t in events:
+        now[0] = arrival
+        join.push(names[i], t, t)
+    elapsed = time.perf_counter() - start
+    join.flush()
+
+    stats = join.get_stats()
+    total_rate = sum(args.rates)
+    print(f"{len(events)} samples in {elapsed:.2f} s: {len(events) / elapsed:,.0f} samples/s "
+          f"({len(events) / elapsed / total_rate:.0f}x the offered {total_rate:,.0f}/s)")
+    lat = sorted(latency)
+    print(f"records {stats['emitted']}, incomplete {stats['incomplete']}, latency ms "
+          f"mean {statistics.mean(lat) * 1e3:.1f} p99 {lat[int(0.99 * (len(lat) - 1))] * 1e3:.1f} "
+          f"max {lat[-1] * 1e3:.1f}")
+    print(f"{'stream':>6} {'rate':>6} {'peak buf':>8} {'matched':>8} {'late':>6} {'dropped':>7} "
+          f"{'late max ms':>11}")
+    for name, rate in zip(names, args.rates):
+        s = stats['streams'][name]
+        print(f"{name:>6} {rate:>6.0f} {s['peak']:>8} {s['matched']:>8} {s['late']:>6} "
+              f"{s['dropped']:>7} {s['late_max'] * 1e3:>11.1f}")
+
+if __name__ == '__main__':
+    main()
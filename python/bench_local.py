@@ -0,0 +1,114 @@
+# bench_local.py
+"""
+Process to process Zetta traffic on one host: framed byte stream against
+SOCK_SEQPACKET messages.
+
+A child process sends N frames as fast as it can. The host receives them with
+ZettaProtocol and counts them in rx_callback. Compared links:
+
+- stream: Unix SOCK_STREAM socket carrying classic frames (payload <= 25) or
+  wide frames (larger payloads). The receiver hunts for START, tracks LEN
+  and checks the CRC.
+- seqpacket: SeqpacketTransport, one message per frame (TYPE + payload),
+  nothing to hunt for or check.
+- native (with --lib, classic frames only): the stream link read and parsed
+  by the C core in a native thread (zetta_native.NativeRxTransport).
+
+Reports frames/s and host CPU time per frame (receiver thread included).
+A run ends after --seconds even if not every frame arrived.
+
+    python bench_local.py --frames 100000 --payload 20 --payload 1000 --lib ../libzetta_rx.so
+"""
+import argparse
+import os
+import socket
+import threading
+import time
+
+from zetta_profile import MessageProfile, classic_profile, wide_profile
+from zetta_protocol import ZettaPacketType, ZettaProtocol
+from zetta_native import NativeRxTransport
+from zetta_transport import FdTransport, SeqpacketTransport
+
+def _sender(sock: socket.socket, frames, count: int, stream: bool):
+    """Child process: write count frames, joined into large writes on a stream"""
+    try:
+        _send(sock, frames, count, stream)
+        sock.recv(1)  # hold the link open until the host counted everything
+    except OSError:
+        pass  # host gave up after --seconds
+    os._exit(0)
+
+def _send(sock: socket.socket, frames, count: int, stream: bool):
+    if stream:
+        per_chunk = max(1, 65536 // len(frames[0]))
+        chunk = b''.join(frames[i % len(frames)] for i in range(per_chunk))
+        sent = 0
+        while sent < count:
+            n = min(per_chunk, count - sent)
+            sock.sendall(chunk if n == per_chunk else chunk[:n * len(frames[0])])
+            sent += n
+    else:
+        for i in range(count):
+            sock.send(frames[i % len(frames)])
+
+def run(kind: str, count: int, payload_size: int, seconds: float, lib: str = None) -> dict:
+    profile = classic_profile() if payload_size <= 25 else wide_profile()
+    stream = kind != 'seqpacket'
+    host, child = socket.socketpair(socket.AF_UNIX,
+                                    socket.SOCK_STREAM if stream else socket.SOCK_SEQPACKET)
+    encode = profile.encode if stream else MessageProfile().encode
+    frames = [encode(ZettaPacketType.MSG_PUBLISH, bytes([i]) * payload_size) for i in range(16)]
+
+    done = threading.Event()
+    received = [0]
+    def on_packet(packet):
+        received[0] += 1
+        if received[0] == count:
+            done.set()
+    cpu, wall = time.process_time(), time.perf_counter()
+    pid = os.fork()
+    if pid == 0:
+        host.close()  # the host closing its end must reach the sender
+        _sender(child, frames, count, stream)
+    child.close()
+    # After the fork: the native reader thread must live in this process
+    if kind == 'native':
+        transport = NativeRxTransport(lib, host.detach())
+    elif stream:
+        transport = FdTransport(host.detach())
+    else:
+        transport = SeqpacketTransport(host)
+    zetta = ZettaProtocol(transport=transport, rx_callback=on_packet,
+                          profiles=(profile,), tx_profile=profile)
+    zetta.start()
+    done.wait(seconds)
+    wall = time.perf_counter() - wall
+    cpu = time.process_time() - cpu
+    zetta.stop()
+    os.waitpid(pid, 0)
+    stats = zetta.get_stats()
+    return {'frames/s': received[0] / wall, 'cpu us/frame': cpu / max(1, received[0]) * 1e6,
+            'wire bytes/frame': stats['bytes_received'] / max(1, received[0])}
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--frames', type=int, default=100000)
+    parser.add_argument('--payload', type=int, action='append',
+                        help='payload bytes, repeatable (default 20 and 1000)')
+    parser.add_argument('--seconds', type=float, default=20.0,
+                        help='longest run, slower links count what arrived')
+    parser.add_argument('--lib', help='libzetta_rx.so, adds the native reader')
+    args = parser.parse_args()
+    for payload in args.payload or (20, 1000):
+        kinds = ['stream', 'seqpacket']
+        if args.lib and payload <= 25:
+            kinds.insert(1, 'native')
+        for kind in kinds:
+            r = run(kind, args.frames, payload, args.seconds, args.lib)
+            print(f"{kind:>10} payload {payload:5d}  {r['frames/s']:10.0f} frames/s  "
+                  f"cpu {r['cpu us/frame']:6.2f} us/frame  "
+                  f"{r['wire bytes/frame']:7.1f} bytes/frame")
+
+if __name__ == '__main__':
+    main()
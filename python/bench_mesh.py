@@ -0,0 +1,101 @@
+# bench_mesh.py
+"""
+Mesh routing on the simulator.
+
+Four nodes in a diamond, node 1 sends telemetry to node 4:
+
+        2
+      /   \\
+    1       4
+      \\   /
+        3
+
+The 1-3 line runs at a lower baud rate, so traffic starts over node 2.
+The script then saturates the 2 -> 4 line with cross traffic (traffic
+should move to node 3), and finally cuts the 1-3 line (traffic must come
+back over the congested node 2). It reports the next hop, delivery and
+latency of every phase.
+
+    python bench_mesh.py --interval 0.05
+"""
+import argparse
+import statistics
+import struct
+
+from zetta_protocol import ZettaPacketType
+from zetta_route import ZettaRouter
+from zetta_sim import SimClock, connect, sim_endpoint
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--interval', type=float, default=0.05)
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--slow-baud', type=int, default=38400)
+    parser.add_argument('--rate', type=float, default=50.0, help='telemetry frames per second')
+    parser.add_argument('--phase', type=float, default=10.0, help='seconds per phase')
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    clock = SimClock()
+    lines = {(1, 2): args.baud, (2, 4): args.baud, (1, 3): args.slow_baud, (3, 4): args.baud}
+    ports = {n: [] for n in (1, 2, 3, 4)}
+    wires = {}
+    for k, ((a, b), baud) in enumerate(lines.items()):
+        ea = sim_endpoint(clock, f"{a}-{b}")
+        eb = sim_endpoint(clock, f"{b}-{a}")
+        wires[(a, b)] = connect(clock, ea, eb, seed=args.seed + k, baud=baud, jitter=0.0005)
+        ports[a].append(ea)
+        ports[b].append(eb)
+
+    latency = []
+    routers = {n: ZettaRouter(n, ports[n], args.interval, clock=clock.time)
+               for n in ports}
+    routers[4].on_deliver = lambda src, t, data: latency.append(
+        clock.now - struct.unpack('<d', data)[0])
+    for router in routers.values():
+        clock.every(args.interval / 4, router.tick)
+
+    sent = [0]
+
+    def telemetry():
+        if routers[1].send(4, ZettaPacketType.MSG_PUBLISH, struct.pack('<d', clock.now)):
+            sent[0] += 1
+
+    congest = [False]
+    cross = ports[2][1]  # node 2 port towards node 4
+
+    def cross_traffic():
+        # Keep about 150 ms of frames queued on the 2 -> 4 line
+        while congest[0] and cross.tx_backlog() < args.baud // 10 * 0.15:
+            cross.send_raw(ZettaPacketType.MSG_PUBLISH, bytes(24))
+
+    clock.every(1.0 / args.rate, telemetry)
+    clock.every(0.005, cross_traffic)
+    clock.run_for(2.0)  # convergence
+
+    def next_hop():
+        route = routers[1].lookup(4)
+        return 'none' if route is None else routers[1].ports[route.port].neighbor
+
+    phases = [('fast path', None),
+              ('2 -> 4 congested', lambda: congest.__setitem__(0, True)),
+              ('1-3 cut', lambda: [w.cut() for w in wires[(1, 3)]])]
+    print(f"{'phase':>18} {'next hop':>9} {'delivered':>10} {'latency ms mean/p95':>21} {'route changes':>14}")
+    for name, action in phases:
+        if action:
+            action()
+        latency.clear()
+        sent[0] = 0
+        changes = routers[1].stats['changes']
+        hops = set()
+        for _ in range(int(args.phase * 10)):
+            clock.run_for(0.1)
+            hops.add(next_hop())
+        lat = sorted(latency) or [float('nan')]
+        hop = '/'.join(str(h) for h in sorted(hops, key=str))
+        print(f"{name:>18} {hop:>9} {len(latency):>5}/{sent[0]:<4} "
+              f"{statistics.mean(lat) * 1e3:>10.1f}/{lat[int(0.95 * (len(lat) - 1))] * 1e3:<10.1f} "
+              f"{routers[1].stats['changes'] - changes:>14}")
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,80 @@
+# bench_preempt.py
+"""
+Urgent frame latency behind bulk transfers, measured on the simulator.
+
+A sender streams bulk messages over a wide-profile link and injects urgent
+frames at random times. Without preemption (one fragment per frame of the
+largest size) an urgent frame waits for the frame on the wire; smaller
+fragments bound the wait to one fragment time at a small throughput cost.
+
+    python bench_preempt.py --baud 115200 --fragments 1020 256 64 32
+"""
+import argparse
+import random
+import statistics
+
+from zetta_bulk import BulkReceiver, BulkSender
+from zetta_protocol import ZettaPacketType
+from zetta_sim import SimClock, connect, sim_endpoint
+
+def run(fragment: int, baud: int, duration: float, urgent_rate: float, seed: int) -> dict:
+    rng = random.Random(seed)
+    clock = SimClock()
+    a = sim_endpoint(clock, 'a', profiles=('wide',), tx_profile='wide')
+    b = sim_endpoint(clock, 'b', profiles=('wide',), tx_profile='wide')
+    connect(clock, a, b, seed=seed, baud=baud)
+
+    sender = BulkSender(a, fragment_size=fragment)
+    received = [0]
+    BulkReceiver(b, lambda ptype, data: received.__setitem__(0, received[0] + len(data)))
+    sent_at = {}
+    latency = []
+
+    def on_packet(packet):
+        if packet.type == ZettaPacketType.MSG_SUBSCRIBE:
+            n = int.from_bytes(packet.data, 'little')
+            latency.append(clock.now - sent_at.pop(n))
+
+    b.add_rx_listener(on_packet)
+    message = bytes(rng.randrange(256) for _ in range(4096))
+
+    def refill():
+        while len(sender._messages) < 2:
+            sender.send(ZettaPacketType.MSG_PUBLISH, message)
+
+    counter = [0]
+
+    def urgent():
+        sent_at[counter[0]] = clock.now
+        sender.send_urgent(ZettaPacketType.MSG_SUBSCRIBE, counter[0].to_bytes(4, 'little'))
+        counter[0] += 1
+        clock.call_later(rng.expovariate(urgent_rate), urgent)
+
+    clock.every(0.0002, refill)
+    clock.every(0.0002, sender.pump)
+    clock.call_later(rng.expovariate(urgent_rate), urgent)
+    clock.run_for(duration)
+    return {
+        'mean': statistics.mean(latency),
+        'max': max(latency),
+        'throughput': received[0] / duration,
+        'preemptions': sender.stats['preemptions'],
+    }
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--fragments', type=int, nargs='+', default=[1020, 256, 64, 32])
+    parser.add_argument('--duration', type=float, default=20.0, help='simulated seconds')
+    parser.add_argument('--urgent-rate', type=float, default=5.0, help='urgent frames per second')
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    print(f"{'fragment B':>10} {'urgent mean ms':>15} {'urgent max ms':>14} {'bulk KB/s':>10}")
+    for fragment in args.fragments:
+        r = run(fragment, args.baud, args.duration, args.urgent_rate, args.seed)
+        print(f"{fragment:>10} {r['mean'] * 1e3:>15.2f} {r['max'] * 1e3:>14.2f} "
+              f"{r['throughput'] / 1024:>10.2f}")
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,127 @@
+# bench_relay.py
+"""
+Benchmark ZettaRelay splice mode against read/write copying.
+
+Each link is two socket pairs: a traffic generator process writes Zetta
+frames into one end and drains the other while the relay moves the bytes in
+between. Reports throughput and relay CPU time per MB.
+
+With --churn, another thread adds and removes an idle link at that rate
+while the traffic runs, like a gateway being reconfigured, and the time
+add_link/remove_link take is reported as well. remove_link waits for the
+poll iteration in progress, the relay loop itself never waits.
+
+    python bench_relay.py --links 200 --mbytes 4 --churn 200
+"""
+import argparse
+import os
+import socket
+import threading
+import time
+
+from zetta_relay import ZettaRelay
+
+def _frames(size: int) -> bytes:
+    frame = bytes([0xAA, 0x01, 20]) + bytes(range(20)) + bytes([0x00, 0xBC])
+    return (frame * (size // len(frame) + 1))[:size]
+
+def _generator(pairs, total: int):
+    """Child process: write total bytes per link and read them back"""
+    data = _frames(1 << 16)
+    sent = [0] * len(pairs)
+    received = [0] * len(pairs)
+    for src, dst in pairs:
+        src.setblocking(False)
+        dst.setblocking(False)
+    while min(received) < total:
+        for i, (src, dst) in enumerate(pairs):
+            if sent[i] < total:
+                try:
+                    sent[i] += src.send(data[:min(len(data), total - sent[i])])
+                except BlockingIOError:
+                    pass
+            try:
+                received[i] += len(dst.recv(1 << 16))
+            except BlockingIOError:
+                pass
+    os._exit(0)
+
+def _churn(relay: ZettaRelay, rate: float, stop: threading.Event, latencies: list):
+    """Add and remove an idle link `rate` times per second"""
+    while not stop.wait(1.0 / rate):
+        a, b = socket.socketpair()
+        start = time.perf_counter()
+        relay.add_link('churn', a.fileno(), b.fileno())
+        added = time.perf_counter()
+        # Returns once the relay let go of the descriptors
+        relay.remove_link('churn')
+        latencies.append((added - start, time.perf_counter() - added))
+        a.close()
+        b.close()
+
+def run(mode: str, links: int, total: int, sniff: bool = False, churn: float = 0) -> dict:
+    relay = ZettaRelay(mode=mode, sniff=sniff)
+    ends, pairs, relayed = [], [], []
+    for i in range(links):
+        gen_a, relay_a = socket.socketpair()
+        relay_b, gen_b = socket.socketpair()
+        # Kept here, the links leave the relay when the generator exits
+        relayed.append(relay.add_link(f'link{i}', relay_a.fileno(), relay_b.fileno()))
+        ends += [relay_a, relay_b]
+        pairs.append((gen_a, gen_b))
+
+    start_wall = time.perf_counter()
+    start_cpu = time.thread_time()
+    pid = os.fork()
+    if pid == 0:
+        _generator(pairs, total)
+    for a, b in pairs:
+        a.close()
+        b.close()
+    stop, latencies = threading.Event(), []
+    churner = None
+    if churn:
+        churner = threading.Thread(target=_churn, args=(relay, churn, stop, latencies))
+        churner.start()
+
+    # Bytes are counted when read, the generator exits once everything
+    # was written back to it as well
+    while os.waitpid(pid, os.WNOHANG)[0] == 0:
+        relay.poll(0.05)
+    wall = time.perf_counter() - start_wall
+    cpu = time.thread_time() - start_cpu
+    stop.set()
+    if churner:
+        churner.join()
+    syscalls = sum(l.a_to_b.stats.syscalls for l in relayed)
+    relay_mode = relayed[0].a_to_b.stats.mode
+    relay.close()
+    for s in ends:
+        s.close()
+    mb = links * total / 1e6
+    return {'mode': relay_mode, 'links': links, 'MB': mb, 'MB/s': mb / wall,
+            'cpu_s_per_MB': cpu / mb, 'syscalls': syscalls,
+            'reconfigs': len(latencies),
+            'add_max': max((l[0] for l in latencies), default=0.0),
+            'remove_max': max((l[1] for l in latencies), default=0.0)}
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--links', type=int, default=100)
+    parser.add_argument('--mbytes', type=float, default=2.0, help='MB per link')
+    parser.add_argument('--churn', type=float, default=0.0,
+                        help='link add/remove per second during the run')
+    args = parser.parse_args()
+    total = int(args.mbytes * 1e6)
+    for mode, sniff in (('copy', False), ('copy', True), ('splice', False)):
+        r = run(mode, args.links, total, sniff, args.churn)
+        label = f"{r['mode']}{'+sniff' if sniff else ''}"
+        line = (f"{label:12s} links={r['links']:4d} {r['MB/s']:8.1f} MB/s "
+                f"relay cpu {r['cpu_s_per_MB'] * 1e3:7.3f} ms/MB syscalls={r['syscalls']}")
+        if args.churn:
+            line += (f" reconfigs={r['reconfigs']} add max {r['add_max'] * 1e3:.2f} ms"
+                     f" remove max {r['remove_max'] * 1e3:.2f} ms")
+        print(line)
+
+if __name__ == '__main__':
+    main()
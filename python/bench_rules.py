@@ -0,0 +1,125 @@
+# bench_rules.py
+"""
+Cost of the RuleEngine with thousands of rules.
+
+Telemetry frames (sensor id, temperature, voltage, current) from a number of
+sensors are checked against a rule set made of per-sensor thresholds, global
+thresholds and generic rules (rate of change, combined conditions). The
+benchmark reports the time per frame of single frame evaluation, of batch
+evaluation and, for comparison, of one Python lambda per rule.
+
+    python bench_rules.py --thresholds 4000 --generic 50 --frames 100000
+"""
+import argparse
+import random
+import struct
+import time
+
+from zetta_protocol import ZettaPacketType
+from zetta_rules import RuleEngine
+
+FMT = '<BhHh'
+NAMES = ('sensor', 'temp', 'volt', 'amps')
+
+def make_rules(rng, sensors, thresholds, generic):
+    rules = []
+    for i in range(thresholds):
+        field, lo, hi = rng.choice((('temp', -400, 1200), ('volt', 2800, 3600),
+                                    ('amps', -2000, 2000)))
+        op = rng.choice(('>', '>=', '<', '<='))
+        expr = f"{field} {op} {rng.randint(lo, hi)}"
+        if rng.random() < 0.8:
+            expr = f"sensor == {rng.randrange(sensors)} and {expr}"
+        rules.append((f"t{i}", expr))
+    for i in range(generic):
+        sensor = rng.randrange(sensors)
+        expr = rng.choice((
+            f"sensor == {sensor} and rate(temp) > {rng.randint(200, 2000)}",
+            f"sensor == {sensor} and abs(amps) * volt > {rng.randint(1, 6) * 10 ** 6}",
+            f"temp > {rng.randint(600, 1200)} and volt < {rng.randint(2900, 3300)}",
+            f"abs(delta(amps)) > {rng.randint(500, 3000)}",
+        ))
+        rules.append((f"g{i}", expr))
+    return rules
+
+def make_frames(rng, sensors, count):
+    state = [[rng.randint(0, 800), rng.randint(3000, 3400), 0] for _ in range(sensors)]
+    frames = []
+    for _ in range(count):
+        s = rng.randrange(sensors)
+        st = state[s]
+        st[0] = max(-400, min(1200, st[0] + rng.randint(-20, 20)))
+        st[1] = max(2800, min(3600, st[1] + rng.randint(-10, 10)))
+        st[2] = max(-2000, min(2000, st[2] + rng.randint(-100, 100)))
+        frames.append(struct.pack(FMT, s, *st))
+    return frames
+
+def naive(rules, frames):
+    """One compiled lambda per rule, the baseline"""
+    fns = [eval(f"lambda sensor, temp, volt, amps: {expr}", {})
+           for _, expr in rules if 'rate(' not in expr and 'delta(' not in expr]
+    unpack = struct.Struct(FMT).unpack
+    start = time.perf_counter()
+    fired = 0
+    for payload in frames:
+        vals = unpack(payload)
+        for fn in fns:
+            if fn(*vals):
+                fired += 1
+    return time.perf_counter() - start, len(fns)
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--sensors', type=int, default=64)
+    parser.add_argument('--thresholds', type=int, default=4000)
+    parser.add_argument('--generic', type=int, default=50)
+    parser.add_argument('--frames', type=int, default=100000)
+    parser.add_argument('--batch', type=int, default=32)
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    rules = make_rules(rng, args.sensors, args.thresholds, args.generic)
+    frames = make_frames(rng, args.sensors, args.frames)
+    ptype = ZettaPacketType.MSG_PUBLISH
+
+    def engine():
+        alerts = []
+        e = RuleEngine(alerts.append, clock=lambda: 0.0)
+        e.define_fields(ptype, FMT, NAMES, key='sensor')
+        for name, expr in rules:
+            e.add_rule(name, ptype, expr)
+        e.get_stats()  # compiles, keep it out of the timing
+        return e, alerts
+
+    e, alerts = engine()
+    stats = e.get_stats()[int(ptype)]
+    print(f"{len(rules)} rules: {stats['threshold_tables']} threshold tables, "
+          f"{stats['generic']} generic, {args.sensors} sensors")
+
+    now = 0.0
+    start = time.perf_counter()
+    for payload in frames:
+        now += 1e-4
+        e.evaluate(ptype, payload, now)
+    single = time.perf_counter() - start
+    fired = len(alerts)
+
+    e, alerts = engine()
+    now = 0.0
+    start = time.perf_counter()
+    for i in range(0, len(frames), args.batch):
+        now += 1e-4 * args.batch
+        e.evaluate_batch(ptype, frames[i:i + args.batch], now)
+    batched = time.perf_counter() - start
+
+    base, nbase = naive(rules, frames)
+    n = len(frames)
+    print(f"{'mode':<22} {'us/frame':>9} {'frames/s':>11}")
+    print(f"{'evaluate':<22} {single / n * 1e6:>9.2f} {n / single:>11,.0f}")
+    print(f"{f'evaluate_batch({args.batch})':<22} {batched / n * 1e6:>9.2f} {n / batched:>11,.0f}")
+    print(f"{f'lambda per rule ({nbase})':<22} {base / n * 1e6:>9.2f} {n / base:>11,.0f}")
+    print(f"alerts (fire + clear): {fired}, {fired / n:.2f} per frame")
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,407 @@
+# bench_soak.py
+"""
+Soak test: hours of simulated load, fails on drift.
+
+A device streams telemetry to the host and echoes the host's requests over
+a simulated serial line, for hours of simulated time (much faster than real
+time). The device is the C core (examples/zetta_soak_device.c built as a
+shared library, --lib) or, without --lib, a Python endpoint. The host is the
+regular ZettaProtocol stack; an application consumer drains rx_queue.
+
+Every --sample seconds of simulated time the harness records throughput,
+echo round trip percentiles, process RSS, allocator statistics (Python
+blocks, glibc mallinfo2 when available) and the depth of every queue: host
+rx_queue and TX backlog, both wires, the device TX ring and the simulator
+event queue. After --warmup the run fails when
+
+  - telemetry throughput of the last quarter dropped by more than
+    --max-throughput-drop against the first quarter,
+  - the p99 round trip of the last quarter grew by more than
+    --max-latency-growth,
+  - the floor (minimum) of RSS, heap, allocated blocks or a queue depth
+    rose between the first and the last quarter by more than
+    --max-rss-growth, --max-block-growth or --max-queue-growth per
+    simulated hour.
+
+    gcc -O2 -shared -fPIC -ICore/inc examples/zetta_soak_device.c \\
+        Core/src/zetta_protocol.c Core/src/zetta_check.c -o libzetta_soak.so
+    python bench_soak.py --lib ../libzetta_soak.so --hours 4 --csv soak.csv
+
+--inject slow-consumer or leak breaks the host on purpose, to check that the
+detectors fire.
+"""
+import argparse
+import ctypes
+import csv
+import os
+import random
+import struct
+import sys
+import time
+from typing import Dict, List
+
+from zetta_protocol import ZettaPacketType
+from zetta_sim import SimClock, attach_device, connect, sim_endpoint
+
+_echo = struct.Struct('<cId')   # 'E', sequence, host send time
+_telemetry = struct.Struct('<cIhH')  # 'T', sequence, value, status
+
+class SoakStats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_uint32) for name in
+                ('rx_frames', 'tx_frames', 'rx_errors', 'echoed', 'published',
+                 'dropped', 'queued', 'peak')]
+
+_SoakTx = ctypes.CFUNCTYPE(None, ctypes.POINTER(ctypes.c_uint8), ctypes.c_uint8)
+
+class CDevice:
+    """The C core as device, see examples/zetta_soak_device.c"""
+
+    def __init__(self, path: str):
+        lib = ctypes.CDLL(os.path.abspath(path))
+        lib.soak_init.argtypes = [_SoakTx]
+        lib.soak_init.restype = ctypes.c_int
+        lib.soak_feed.argtypes = [ctypes.c_char_p, ctypes.c_uint32]
+        lib.soak_feed.restype = None
+        lib.soak_publish.argtypes = [ctypes.c_char_p, ctypes.c_uint8]
+        lib.soak_publish.restype = ctypes.c_int
+        lib.soak_tx_done.argtypes = []
+        lib.soak_tx_done.restype = None
+        lib.soak_get_stats.argtypes = [ctypes.POINTER(SoakStats)]
+        lib.soak_get_stats.restype = None
+        self.lib = lib
+        self.wire = None
+        self._tx = _SoakTx(self._on_tx)  # keep a reference for the C side
+        if lib.soak_init(self._tx) != ctypes.sizeof(SoakStats):
+            raise RuntimeError(f"{path}: SoakStats_t layout does not match")
+
+    def connect(self, clock: SimClock, host, seed: int, **wire_kwargs):
+        to_dev, self.wire = attach_device(clock, host, self.feed, seed=seed, **wire_kwargs)
+        return to_dev, self.wire
+
+    def feed(self, data: bytes):
+        self.lib.soak_feed(data, len(data))
+
+    def _on_tx(self, data, size):
+        self.wire.send(ctypes.string_at(data, size), on_sent=self.lib.soak_tx_done)
+
+    def publish(self, payload: bytes) -> bool:
+        return bool(self.lib.soak_publish(payload, len(payload)))
+
+    def stats(self) -> Dict[str, int]:
+        s = SoakStats()
+        self.lib.soak_get_stats(ctypes.byref(s))
+        return {name: getattr(s, name) for name, _ in SoakStats._fields_}
+
+class PyDevice:
+    """A Python endpoint as device"""
+
+    def __init__(self, clock: SimClock):
+        self.ep = sim_endpoint(clock, 'device')
+        self.ep.add_rx_listener(self._on_packet)
+        self.echoed = 0
+        self.published = 0
+
+    def connect(self, clock: SimClock, host, seed: int, **wire_kwargs):
+        return connect(clock, host, self.ep, seed=seed, **wire_kwargs)
+
+    def _on_packet(self, packet):
+        self.ep.rx_queue.get_nowait()  # nobody reads the device queue
+        if packet.data[:1] == b'E' and self.ep.send_raw(packet.type, packet.data):
+            self.echoed += 1
+
+    def publish(self, payload: bytes) -> bool:
+        if not self.ep.send_raw(ZettaPacketType.MSG_PUBLISH, payload):
+            return False
+        self.published += 1
+        return True
+
+    def stats(self) -> Dict[str, int]:
+        s = self.ep.get_stats()
+        return {'rx_frames': s['packets_received'], 'tx_frames': s['packets_sent'],
+                'rx_errors': s['crc_errors'] + s['frame_errors'],
+                'echoed': self.echoed, 'published': self.published,
+                'dropped': 0, 'queued': 0, 'peak': 0}
+
+def rss_bytes() -> int:
+    try:
+        with open('/proc/self/statm') as f:
+            return int(f.read().split()[1]) * os.sysconf('SC_PAGE_SIZE')
+    except (OSError, ValueError):
+        import resource
+        return resource.getrusage(resource.RUSAGE_SELF).ru_maxrss * 1024
+
+class _MallInfo2(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_size_t) for name in
+                ('arena', 'ordblks', 'smblks', 'hblks', 'hblkhd', 'usmblks',
+                 'fsmblks', 'uordblks', 'fordblks', 'keepcost')]
+
+def _mallinfo():
+    """glibc heap statistics, None elsewhere"""
+    try:
+        libc = ctypes.CDLL(None)
+        fn = libc.mallinfo2
+    except (OSError, AttributeError):
+        return None
+    fn.restype = _MallInfo2
+    return fn
+
+def percentile(values: List[float], q: float) -> float:
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(q * len(values)))]
+
+def floor_growth(first: List[dict], last: List[dict], key: str) -> float:
+    """
+    Growth of the minimum of a metric per simulated hour.
+
+    A healthy queue drains back to its floor and the heap returns to its
+    low-water mark between bursts, a leak lifts the floor. Comparing floors
+    ignores the noise of single samples (a frame in flight, GC timing).
+    """
+    hours = (last[-1]['time'] - first[-1]['time']) / 3600
+    if hours <= 0:
+        return 0.0
+    return (min(r[key] for r in last) - min(r[key] for r in first)) / hours
+
+class Soak:
+    def __init__(self, args):
+        self.args = args
+        self.clock = clock = SimClock()
+        self.host = sim_endpoint(clock, 'host')
+        self.device = CDevice(args.lib) if args.lib else PyDevice(clock)
+        self.wires = self.device.connect(clock, self.host, seed=args.seed, baud=args.baud,
+                                         jitter=args.jitter, ber=args.ber)
+        self.host.add_rx_listener(self._on_host_packet)
+        self.mallinfo = _mallinfo()
+        self.samples: List[dict] = []
+        self.leak = []
+        self.echo_seq = 0
+        self.tel_seq = 0
+        self.tel_gaps = 0
+        self.tel_last = None
+        self.window_rtt: List[float] = []
+        self.queue_min: Dict[str, int] = {}
+        self.queue_max: Dict[str, int] = {}
+        self.rng = random.Random(args.seed)
+        self.window = {'telemetry': 0, 'echo': 0, 'sent': 0, 'busy': 0}
+        self.consume_batch = args.consume_batch
+        self.last_sample = (0.0, time.perf_counter())
+
+    def start(self):
+        a = self.args
+        c = self.clock
+        c.every(1.0 / a.telemetry, self._telemetry)
+        c.every(1.0 / a.echo, self._echo)
+        c.every(a.consume_period, self._consume)
+        c.every(a.sample, self._sample)
+        self._poll_queues()
+
+    def _telemetry(self):
+        payload = _telemetry.pack(b'T', self.tel_seq, self.tel_seq & 0x7FFF, 0)
+        if self.device.publish(payload):
+            self.tel_seq += 1
+        else:
+            self.window['busy'] += 1
+
+    def _echo(self):
+        if self.host.send_raw(ZettaPacketType.MSG_PUBLISH,
+                              _echo.pack(b'E', self.echo_seq, self.clock.now)):
+            self.echo_seq += 1
+            self.window['sent'] += 1
+
+    def _on_host_packet(self, packet):
+        if packet.data[:1] == b'E':
+            _, _, sent = _echo.unpack_from(packet.data)
+            self.window_rtt.append(self.clock.now - sent)
+
+    def _consume(self):
+        """The application: drains rx_queue in bounded batches"""
+        q = self.host.rx_queue
+        batch = self.consume_batch
+        if self.args.inject == 'slow-consumer':
+            # Gets a little slower every period, like a growing backlog of work
+            self.consume_batch = max(1, self.consume_batch - 0.0005)
+            batch = int(self.consume_batch)
+        for _ in range(int(batch)):
+            if q.empty():
+                break
+            packet = q.get_nowait()
+            if self.args.inject == 'leak':
+                self.leak.append(packet)
+            if packet.data[:1] == b'T':
+                self.window['telemetry'] += 1
+                _, seq, _, _ = _telemetry.unpack_from(packet.data)
+                if self.tel_last is not None and seq != self.tel_last + 1:
+                    self.tel_gaps += 1
+                self.tel_last = seq
+            elif packet.data[:1] == b'E':
+                self.window['echo'] += 1
+
+    def _poll_queues(self):
+        # Random poll times do not alias with the periodic traffic
+        self._track_queues()
+        self.clock.call_later(self.args.poll * (0.5 + self.rng.random()), self._poll_queues)
+
+    def _queues(self) -> Dict[str, int]:
+        return {
+            'rx_queue': self.host.rx_queue.qsize(),
+            'host_tx_backlog': self.host.tx_backlog(),
+            'wire_to_dev_bytes': self.wires[0].out_waiting(),
+            'wire_to_host_bytes': self.wires[1].out_waiting(),
+            'dev_queue': self.device.stats()['queued'] if self.args.lib else 0,
+            'sim_events': self.clock.pending(),
+        }
+
+    def _track_queues(self):
+        """Floor and peak of every queue depth within the sample window"""
+        lo, hi = self.queue_min, self.queue_max
+        for key, depth in self._queues().items():
+            if depth < lo.get(key, depth + 1):
+                lo[key] = depth
+            if depth > hi.get(key, -1):
+                hi[key] = depth
+
+    def _sample(self):
+        now = self.clock.now
+        t0, wall0 = self.last_sample
+        wall = time.perf_counter()
+        span = now - t0
+        rtt = self.window_rtt
+        dev = self.device.stats()
+        host = self.host.get_stats()
+        s = {
+            'time': now,
+            'telemetry_per_s': self.window['telemetry'] / span,
+            'echo_per_s': self.window['echo'] / span,
+            'rtt_p50_ms': percentile(rtt, 0.50) * 1e3,
+            'rtt_p99_ms': percentile(rtt, 0.99) * 1e3,
+            'rtt_max_ms': max(rtt) * 1e3 if rtt else 0.0,
+            'rss_mb': rss_bytes() / 2 ** 20,
+            'py_blocks': sys.getallocatedblocks(),
+            'dev_dropped': dev['dropped'],
+            'dev_rx_errors': dev['rx_errors'],
+            'host_crc_errors': host['crc_errors'],
+            'telemetry_gaps': self.tel_gaps,
+            'publish_busy': self.window['busy'],
+            'speedup': span / (wall - wall0) if wall > wall0 else 0.0,
+        }
+        # Queue depths as their floor within the window, a frame that happens
+        # to be in flight at the sample instant is not growth
+        self._track_queues()
+        s.update(self.queue_min)
+        s.update({f"{key}_peak": depth for key, depth in self.queue_max.items()})
+        self.queue_min, self.queue_max = {}, {}
+        if self.mallinfo is not None:
+            m = self.mallinfo()
+            s['heap_used_mb'] = m.uordblks / 2 ** 20
+            # Free but not returned to the OS: fragmentation of the arena
+            s['heap_free_mb'] = m.fordblks / 2 ** 20
+        self.samples.append(s)
+        self.window_rtt = []
+        self.window = dict.fromkeys(self.window, 0)
+        self.last_sample = (now, wall)
+        if self.args.verbose:
+            print(f"{now / 3600:6.2f} h  tel {s['telemetry_per_s']:7.1f}/s  "
+                  f"rtt p99 {s['rtt_p99_ms']:6.2f} ms  rss {s['rss_mb']:6.1f} MB  "
+                  f"blocks {s['py_blocks']:8d}  rx_queue {s['rx_queue']:5d}  "
+                  f"{s['speedup']:5.0f}x real time", flush=True)
+
+def check_drift(samples: List[dict], args) -> List[str]:
+    """Failure messages, empty when the run was stable"""
+    steady = [s for s in samples if s['time'] > args.warmup]
+    if len(steady) < 8:
+        return [f"only {len(steady)} samples after warmup, run longer"]
+    q = len(steady) // 4
+    first, last = steady[:q], steady[-q:]
+    failures = []
+
+    def mean(rows, key):
+        return sum(r[key] for r in rows) / len(rows)
+
+    tp0, tp1 = mean(first, 'telemetry_per_s'), mean(last, 'telemetry_per_s')
+    if tp0 > 0 and (tp0 - tp1) / tp0 > args.max_throughput_drop:
+        failures.append(f"throughput dropped {100 * (tp0 - tp1) / tp0:.1f}% "
+                        f"({tp0:.1f} -> {tp1:.1f} frames/s)")
+    p0, p1 = mean(first, 'rtt_p99_ms'), mean(last, 'rtt_p99_ms')
+    if p0 > 0 and (p1 - p0) / p0 > args.max_latency_growth:
+        failures.append(f"p99 round trip grew {100 * (p1 - p0) / p0:.0f}% "
+                        f"({p0:.2f} -> {p1:.2f} ms)")
+
+    limits = {'rss_mb': args.max_rss_growth, 'heap_used_mb': args.max_rss_growth,
+              'py_blocks': args.max_block_growth}
+    for key in ('rx_queue', 'host_tx_backlog', 'wire_to_dev_bytes', 'wire_to_host_bytes',
+                'dev_queue', 'sim_events'):
+        limits[key] = args.max_queue_growth
+    for key, limit in limits.items():
+        if key not in steady[0]:
+            continue
+        growth = floor_growth(first, last, key)
+        if growth > limit:
+            failures.append(f"{key} floor grows {growth:.1f}/h (limit {limit:g}/h)")
+    return failures
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--lib', help='shared library built from zetta_soak_device.c')
+    parser.add_argument('--hours', type=float, default=1.0, help='simulated hours')
+    parser.add_argument('--sample', type=float, default=60.0, help='sample period (s)')
+    parser.add_argument('--warmup', type=float, default=300.0, help='ignored start (s)')
+    parser.add_argument('--telemetry', type=float, default=200.0, help='frames per second')
+    parser.add_argument('--echo', type=float, default=20.0, help='requests per second')
+    parser.add_argument('--poll', type=float, default=0.01,
+                        help='mean queue depth poll period (s)')
+    parser.add_argument('--consume-period', type=float, default=0.01)
+    parser.add_argument('--consume-batch', type=float, default=8)
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--jitter', type=float, default=0.0005)
+    parser.add_argument('--ber', type=float, default=0.0)
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--max-throughput-drop', type=float, default=0.02)
+    parser.add_argument('--max-latency-growth', type=float, default=0.5)
+    parser.add_argument('--max-rss-growth', type=float, default=2.0, help='MB per hour')
+    parser.add_argument('--max-block-growth', type=float, default=20000, help='per hour')
+    parser.add_argument('--max-queue-growth', type=float, default=20, help='entries (bytes on wires) per hour')
+    parser.add_argument('--inject', choices=('none', 'slow-consumer', 'leak'), default='none')
+    parser.add_argument('--csv', help='write every sample to this file')
+    parser.add_argument('-v', '--verbose', action='store_true', help='print every sample')
+    args = parser.parse_args()
+
+    soak = Soak(args)
+    soak.start()
+    device = 'C core' if args.lib else 'Python'
+    print(f"soak: {args.hours:g} h simulated, {device} device, telemetry {args.telemetry:g}/s, "
+          f"echo {args.echo:g}/s, {args.baud} baud")
+    wall = time.perf_counter()
+    soak.clock.run_for(args.hours * 3600)
+    wall = time.perf_counter() - wall
+    samples = soak.samples
+
+    if args.csv and samples:
+        with open(args.csv, 'w', newline='') as f:
+            writer = csv.DictWriter(f, fieldnames=list(samples[0]))
+            writer.writeheader()
+            writer.writerows(samples)
+
+    last = samples[-1]
+    print(f"ran in {wall:.0f} s ({args.hours * 3600 / wall:.0f}x real time), "
+          f"{len(samples)} samples")
+    for key in ('telemetry_per_s', 'rtt_p50_ms', 'rtt_p99_ms', 'rss_mb', 'py_blocks',
+                'heap_used_mb', 'heap_free_mb', 'rx_queue', 'rx_queue_peak',
+                'dev_queue_peak', 'sim_events'):
+        if key in last:
+            values = [s[key] for s in samples if s['time'] > args.warmup] or [last[key]]
+            print(f"  {key:<16} last {last[key]:>10.2f}   min {min(values):>10.2f}   "
+                  f"max {max(values):>10.2f}")
+    print(f"  telemetry gaps {last['telemetry_gaps']}, device drops {last['dev_dropped']}, "
+          f"rx errors host {last['host_crc_errors']} device {last['dev_rx_errors']}")
+    failures = check_drift(samples, args)
+    for failure in failures:
+        print(f"FAIL: {failure}")
+    if failures:
+        sys.exit(1)
+    print("PASS: no drift beyond the thresholds")
+
+if __name__ == '__main__':
+    main()
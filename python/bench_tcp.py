@@ -0,0 +1,168 @@
+# bench_tcp.py
+"""
+TCP transport on loopback: one send() per frame against batched writes.
+
+- frames: send_raw() of N frames (30 bytes each) to a sink process.
+  "naive" writes every frame with its own send() (FdTransport, no writer
+  thread), with and without TCP_NODELAY. "batched" is TcpTransport with the
+  writer thread: queued frames go out with one sendmsg() per batch, corked
+  while the queue drains.
+- bulk: 64 KB writes of pre-encoded frames, plain copies against
+  MSG_ZEROCOPY.
+- rtt: request of two frames, the peer answers once both arrived. Nagle
+  holds the second frame back until the first is acknowledged, and the peer
+  delays that acknowledgement.
+
+    python bench_tcp.py --frames 200000 --bulk-mb 512 --rtt 200
+"""
+import argparse
+import os
+import socket
+import statistics
+import time
+
+from zetta_protocol import ZettaPacketType, ZettaProtocol
+from zetta_transport import FdTransport, TcpTransport
+
+PAYLOAD = bytes(range(25))
+BULK_WRITE = 1 << 16
+
+def _listener() -> socket.socket:
+    server = socket.socket()
+    server.bind(('127.0.0.1', 0))
+    server.listen(1)
+    return server
+
+def _fork_sink(total: int):
+    """Child process that reads total bytes, then writes one byte to a pipe"""
+    server = _listener()
+    done_r, done_w = os.pipe()
+    pid = os.fork()
+    if pid == 0:
+        conn, _ = server.accept()
+        got = 0
+        while got < total:
+            data = conn.recv(1 << 20)
+            if not data:
+                break
+            got += len(data)
+        os.write(done_w, b'D')
+        while conn.recv(1 << 16):
+            pass
+        os._exit(0)
+    sock = socket.create_connection(server.getsockname())
+    server.close()
+    os.close(done_w)
+    return pid, sock, done_r
+
+def _finish(done_r: int):
+    os.read(done_r, 1)
+    os.close(done_r)
+
+def _transport(mode: str, sock: socket.socket, zerocopy: bool = False):
+    if mode == 'naive':
+        return FdTransport(sock.fileno(), owns=False), False
+    if mode == 'naive+nodelay':
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        return FdTransport(sock.fileno(), owns=False), False
+    threshold = BULK_WRITE // 4 if zerocopy else None
+    return TcpTransport(sock, nodelay=True, zerocopy_threshold=threshold), True
+
+def bench_frames(mode: str, frames: int) -> dict:
+    frame_size = len(ZettaProtocol(transport=FdTransport(-1, owns=False))
+                     ._create_packet(ZettaPacketType.MSG_PUBLISH, PAYLOAD))
+    pid, sock, done_r = _fork_sink(frames * frame_size)
+    transport, tx_thread = _transport(mode, sock)
+    zetta = ZettaProtocol(transport=transport, tx_thread=tx_thread)
+    if tx_thread:
+        zetta.start()
+    cpu, wall = time.process_time(), time.perf_counter()
+    for _ in range(frames):
+        zetta.send_raw(ZettaPacketType.MSG_PUBLISH, PAYLOAD)
+    _finish(done_r)
+    wall = time.perf_counter() - wall
+    cpu = time.process_time() - cpu
+    writes = transport.stats['writes'] if isinstance(transport, TcpTransport) else frames
+    zetta.stop()
+    sock.close()
+    os.waitpid(pid, 0)
+    return {'frames/s': frames / wall, 'cpu us/frame': cpu / frames * 1e6,
+            'frames/write': frames / writes}
+
+def bench_bulk(zerocopy: bool, mbytes: int) -> dict:
+    chunk = bytes(BULK_WRITE)
+    count = mbytes * (1 << 20) // BULK_WRITE
+    pid, sock, done_r = _fork_sink(count * BULK_WRITE)
+    transport, _ = _transport('batched', sock, zerocopy)
+    cpu, wall = time.process_time(), time.perf_counter()
+    for _ in range(count):
+        transport.write(chunk)
+    _finish(done_r)
+    wall = time.perf_counter() - wall
+    cpu = time.process_time() - cpu
+    transport.close()
+    os.waitpid(pid, 0)
+    st = transport.stats
+    return {'MB/s': count * BULK_WRITE / wall / 1e6,
+            'cpu ms/GB': cpu / (count * BULK_WRITE / 1e9) * 1e3,
+            'zerocopy': st['zerocopy'], 'copied': st['zerocopy_copied']}
+
+def bench_rtt(mode: str, rounds: int) -> dict:
+    server = _listener()
+    pid = os.fork()
+    if pid == 0:
+        conn, _ = server.accept()
+        reply = ZettaProtocol(transport=FdTransport(-1, owns=False))._create_packet(
+            ZettaPacketType.MSG_ACK, b'\x00')
+        pending = b''
+        while True:
+            data = conn.recv(4096)
+            if not data:
+                os._exit(0)
+            pending += data
+            # Answer once the whole two frame request is in
+            while len(pending) >= 60:
+                pending = pending[60:]
+                conn.sendall(reply)
+    sock = socket.create_connection(server.getsockname())
+    server.close()
+    transport, tx_thread = _transport(mode, sock)
+    zetta = ZettaProtocol(transport=transport, tx_thread=tx_thread)
+    zetta.start()
+    samples = []
+    for _ in range(rounds):
+        start = time.perf_counter()
+        zetta.send_raw(ZettaPacketType.MSG_PUBLISH, PAYLOAD)
+        zetta.send_raw(ZettaPacketType.MSG_PUBLISH, PAYLOAD)
+        zetta.get_packet(timeout=1.0)
+        samples.append(time.perf_counter() - start)
+    zetta.stop()
+    sock.close()
+    os.waitpid(pid, 0)
+    samples.sort()
+    return {'p50 ms': statistics.median(samples) * 1e3,
+            'p99 ms': samples[int(0.99 * (len(samples) - 1))] * 1e3}
+
+def _print(name: str, result: dict):
+    print(f"{name:>16} " + "  ".join(f"{k} {v:10.2f}" if isinstance(v, float) else f"{k} {v:6d}"
+                                     for k, v in result.items()))
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--frames', type=int, default=200000)
+    parser.add_argument('--bulk-mb', type=int, default=512)
+    parser.add_argument('--rtt', type=int, default=200, help='request rounds')
+    args = parser.parse_args()
+
+    print("send_raw throughput")
+    for mode in ('naive', 'naive+nodelay', 'batched'):
+        _print(mode, bench_frames(mode, args.frames))
+    print("64 KB writes")
+    for zerocopy in (False, True):
+        _print('zerocopy' if zerocopy else 'copy', bench_bulk(zerocopy, args.bulk_mb))
+    print("two frame request round trip")
+    for mode in ('naive', 'naive+nodelay', 'batched'):
+        _print(mode, bench_rtt(mode, args.rtt))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,89 @@
+# bench_time.py
+"""
+Accuracy and cost of device timestamps against host arrival stamps.
+
+A device samples at a fixed rate with a drifting clock and stamps every
+frame (zetta_time). The host sees each frame after a variable delay: the
+transmission time, USB/serial buffering up to the poll interval and
+occasional scheduler stalls. Some frames are lost. Frames are decoded with
+DeviceTime and compared against the true acquisition times:
+
+- abs error: time of a sample on the host clock minus its true time, after
+  removing the smallest latency (one-way delay cannot be measured)
+- interval error: error of the time between consecutive samples, what
+  control loop analysis sees as jitter
+
+    python bench_time.py --rate 1000 --drift 40e-6 --seconds 120
+"""
+import argparse
+import random
+
+from zetta_time import DeviceTime
+
+def percentile(values, q):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(q * len(values)))]
+
+def run(args):
+    rng = random.Random(args.seed)
+    dev = DeviceTime(tick=args.tick, full_interval=args.full_interval)
+    sender = DeviceTime(tick=args.tick, full_interval=args.full_interval)
+    period = 1.0 / args.rate
+    frame_time = 20 * 10 / args.baud  # 20 byte frame on the wire
+    boot = 1234.5  # host time of device tick 0
+    t = 0.0
+    field_bytes = 0
+    host, rebuilt, truth = [], [], []
+    for _ in range(int(args.seconds * args.rate)):
+        t += period
+        ticks_time = t * (1 + args.drift)
+        field = sender.encoder.encode(int(round(ticks_time / args.tick)))
+        field_bytes += len(field)
+        if rng.random() < args.loss:
+            continue
+        delay = frame_time + rng.uniform(0, args.poll)
+        if rng.random() < args.stall_rate:
+            delay += rng.uniform(0.002, args.stall)
+        arrival = boot + t + delay
+        _, device_time, _ = dev.decode(field, arrival)
+        host.append(arrival)
+        rebuilt.append(device_time)
+        truth.append(boot + t)
+    base = frame_time  # smallest possible latency
+    warm = int(2 * args.rate)  # first two seconds settle the offset fit
+    out = {}
+    for name, stamps in (('host arrival', host), ('device', rebuilt)):
+        err = [s - r - base for s, r in zip(stamps[warm:], truth[warm:])]
+        step = [abs((s1 - s0) - (r1 - r0)) for s0, s1, r0, r1 in
+                zip(stamps[warm:], stamps[warm + 1:], truth[warm:], truth[warm + 1:])]
+        out[name] = (err, step)
+    return out, field_bytes / int(args.seconds * args.rate), dev.get_stats()
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--rate', type=float, default=1000.0, help='samples per second')
+    parser.add_argument('--seconds', type=float, default=120.0)
+    parser.add_argument('--tick', type=float, default=1e-6, help='device tick in seconds')
+    parser.add_argument('--drift', type=float, default=40e-6, help='device clock rate error')
+    parser.add_argument('--baud', type=int, default=921600)
+    parser.add_argument('--poll', type=float, default=0.001, help='host buffering up to')
+    parser.add_argument('--stall', type=float, default=0.02, help='longest scheduler stall')
+    parser.add_argument('--stall-rate', type=float, default=0.01)
+    parser.add_argument('--loss', type=float, default=0.01)
+    parser.add_argument('--full-interval', type=int, default=32)
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    results, field, stats = run(args)
+    print(f"{'stamp':>12} {'abs p50 us':>10} {'abs p99 us':>10} {'abs max us':>10} "
+          f"{'interval p99 us':>15} {'interval max us':>15}")
+    for name, (err, step) in results.items():
+        print(f"{name:>12} {percentile([abs(e) for e in err], 0.5) * 1e6:>10.1f} "
+              f"{percentile([abs(e) for e in err], 0.99) * 1e6:>10.1f} "
+              f"{max(abs(e) for e in err) * 1e6:>10.1f} "
+              f"{percentile(step, 0.99) * 1e6:>15.1f} {max(step) * 1e6:>15.1f}")
+    print(f"timestamp field {field:.2f} bytes per frame (8 for a double), "
+          f"skew estimate {stats['skew'] * 1e6:+.1f} ppm (true {-args.drift * 1e6:+.1f})")
+
+if __name__ == '__main__':
+    main()
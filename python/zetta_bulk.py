@@ -0,0 +1,179 @@
+# zetta_bulk.py
+"""
+Bulk messages with preemption, mirror of Core/inc/zetta_bulk.h.
+
+Large messages are cut into MSG_BULK fragments. The sender keeps at most
+`lookahead` bytes queued in the transport, so an urgent frame waits for one
+fragment instead of the whole message:
+
+    fragment payload: [FIRST|LAST|id, type, offset u16, data...]
+
+The receiver reassembles messages and hands them over once complete.
+"""
+import struct
+import threading
+import time
+from collections import deque
+from typing import Callable, Optional
+
+from zetta_protocol import PacketType, ZettaPacket, ZettaPacketType, lookup_packet_type
+
+FLAG_FIRST = 0x80
+FLAG_LAST = 0x40
+ID_MASK = 0x3F
+HEADER_SIZE = 4
+
+_header = struct.Struct('<BBH')
+
+def fragments(msg_id: int, packet_type: int, data: bytes, size: int):
+    """Yield the fragment payloads of one message"""
+    total = len(data)
+    for off in range(0, total, size):
+        flags = msg_id & ID_MASK
+        if off == 0:
+            flags |= FLAG_FIRST
+        if off + size >= total:
+            flags |= FLAG_LAST
+        yield _header.pack(flags, packet_type, off) + data[off:off + size]
+
+class BulkSender:
+    """
+    Send large messages as fragments, letting urgent frames through.
+
+    Args:
+        zetta: ZettaProtocol instance
+        fragment_size: Data bytes per fragment (default: largest that fits)
+        lookahead: Bytes allowed in the TX backlog before the next fragment
+            (default: one fragment frame)
+    """
+
+    def __init__(self, zetta, fragment_size: Optional[int] = None,
+                 lookahead: Optional[int] = None):
+        self.zetta = zetta
+        max_size = zetta.tx_profile.max_payload - HEADER_SIZE
+        self.fragment_size = min(fragment_size or max_size, max_size)
+        self.lookahead = (self.fragment_size + HEADER_SIZE + zetta.tx_profile.overhead
+                          if lookahead is None else lookahead)
+        self.type = ZettaPacketType.MSG_BULK
+        self._messages = deque()
+        self._current = None
+        self._msg_id = 0
+        self._wake = threading.Event()
+        self._thread = None
+        self._stop = False
+        self.stats = {'messages': 0, 'fragments': 0, 'urgent': 0, 'preemptions': 0}
+
+    def send(self, packet_type: PacketType, data: bytes):
+        """Queue a message, fragments go out from pump()"""
+        if not data:
+            raise ValueError("empty bulk message")
+        if len(data) > 0xFFFF:
+            raise ValueError(f"bulk message too large: {len(data)}")
+        self._messages.append((int(packet_type), bytes(data)))
+        self._wake.set()
+
+    def send_urgent(self, packet_type: PacketType, payload: bytes) -> bool:
+        """Send immediately, between two fragments of a message in progress"""
+        self.stats['urgent'] += 1
+        if self._current is not None:
+            self.stats['preemptions'] += 1
+        return self.zetta.send_raw(packet_type, payload)
+
+    def busy(self) -> bool:
+        return self._current is not None or bool(self._messages)
+
+    def pump(self) -> bool:
+        """Send the next fragment when the TX backlog allows it, True if sent"""
+        if self._current is None:
+            if not self._messages:
+                return False
+            packet_type, data = self._messages.popleft()
+            self._msg_id = (self._msg_id + 1) & ID_MASK
+            self._current = fragments(self._msg_id, packet_type, data, self.fragment_size)
+        if self.zetta.tx_backlog() > self.lookahead:
+            return False
+        fragment = next(self._current, None)
+        if fragment is None:
+            self._current = None
+            self.stats['messages'] += 1
+            return self.pump()
+        self.zetta.send_raw(self.type, fragment)
+        self.stats['fragments'] += 1
+        if fragment[0] & FLAG_LAST:
+            self._current = None
+            self.stats['messages'] += 1
+        return True
+
+    def start(self, poll: float = 0.0005):
+        """Pump fragments from a background thread"""
+        self._stop = False
+
+        def run():
+            while not self._stop:
+                if not self.busy():
+                    self._wake.wait(0.1)
+                    self._wake.clear()
+                    continue
+                if not self.pump():
+                    time.sleep(poll)
+
+        self._thread = threading.Thread(target=run, name='zetta-bulk', daemon=True)
+        self._thread.start()
+
+    def stop(self):
+        self._stop = True
+        self._wake.set()
+        if self._thread:
+            self._thread.join(timeout=1.0)
+            self._thread = None
+
+class BulkReceiver:
+    """
+    Reassemble bulk messages received on a ZettaProtocol instance.
+
+    Args:
+        zetta: ZettaProtocol instance (or anything with add_rx_listener)
+        on_message: Called with (packet type, data) for every complete message
+        max_size: Largest accepted message
+    """
+
+    def __init__(self, zetta, on_message: Callable[[PacketType, bytes], None],
+                 max_size: int = 1 << 16):
+        self.zetta = zetta
+        self.on_message = on_message
+        self.max_size = max_size
+        self.type = ZettaPacketType.MSG_BULK
+        self._buf = None
+        self._id = 0
+        self._ptype = 0
+        self.stats = {'messages': 0, 'dropped': 0}
+        zetta.add_rx_listener(self.feed)
+
+    def close(self):
+        self.zetta.remove_rx_listener(self.feed)
+
+    def feed(self, packet: ZettaPacket):
+        if packet.type != self.type or len(packet.data) < HEADER_SIZE:
+            return
+        flags, ptype, off = _header.unpack_from(packet.data)
+        data = packet.data[HEADER_SIZE:]
+        msg_id = flags & ID_MASK
+        if flags & FLAG_FIRST:
+            if self._buf is not None:
+                self.stats['dropped'] += 1  # previous message never completed
+            self._buf = bytearray()
+            self._id = msg_id
+            self._ptype = ptype
+        # A lost fragment shows up as an offset or id mismatch
+        buf = self._buf
+        if (buf is None or msg_id != self._id or off != len(buf) or
+                off + len(data) > self.max_size):
+            if buf is not None:
+                self.stats['dropped'] += 1
+            self._buf = None
+            return
+        buf += data
+        if flags & FLAG_LAST:
+            self._buf = None
+            self.stats['messages'] += 1
+            self.on_message(lookup_packet_type(self._ptype), bytes(buf))
@@ -0,0 +1,198 @@
+# zetta_cache.py
+"""
+Request coalescing and response caching for device queries.
+
+Several host components often ask a device for the same parameter at the
+same time. ZettaQueryBroker sends one request frame per key, fans the
+response out to every waiter and serves repeats from a TTL cache. Frames the
+device publishes on its own for a key invalidate the cached value.
+
+Requests and responses are matched on a key: the first ``key_len`` payload
+bytes (for example a parameter id). Requests with the same key are
+considered identical.
+
+Every waiter times out on its own: a blocking query() gives up after its own
+timeout without affecting the callers merged with it. The shared request
+fails with TimeoutError once it is ``timeout`` seconds old; expired requests
+are failed the next time the broker sees a query or a frame.
+"""
+import threading
+import time
+from concurrent.futures import Future, TimeoutError as FutureTimeout
+from dataclasses import dataclass
+from typing import Callable, Dict, Optional, Tuple
+
+from zetta_protocol import PacketType, ZettaPacket
+
+@dataclass
+class _Pending:
+    future: Future
+    sent: float
+    deadline: float
+
+class ZettaQueryBroker:
+    """
+    Coalesce identical in-flight queries and cache their responses.
+
+    Args:
+        zetta: ZettaProtocol instance
+        request_type: Packet type of query frames
+        response_type: Packet type the device answers with
+        update_type: Packet type of device published updates, None to disable
+        ttl: Seconds a response stays valid
+        key_len: Payload bytes that identify a query
+        timeout: Default seconds to wait for a response
+    """
+
+    def __init__(self, zetta, request_type: PacketType, response_type: PacketType,
+                 update_type: Optional[PacketType] = None, ttl: float = 1.0,
+                 key_len: int = 1, timeout: float = 1.0,
+                 key_fn: Optional[Callable[[bytes], bytes]] = None):
+        self.zetta = zetta
+        self.request_type = request_type
+        self.response_type = response_type
+        self.update_type = update_type
+        self.ttl = ttl
+        self.timeout = timeout
+        self.key_fn = key_fn or (lambda payload: bytes(payload[:key_len]))
+        self._lock = threading.Lock()
+        self._pending: Dict[bytes, _Pending] = {}
+        self._cache: Dict[bytes, Tuple[bytes, float]] = {}
+        self.stats = {
+            'requests': 0,
+            'hits': 0,
+            'merges': 0,
+            'misses': 0,
+            'timeouts': 0,
+            'invalidations': 0,
+            'unsolicited': 0,
+        }
+        zetta.add_rx_listener(self._on_packet)
+
+    def close(self):
+        self.zetta.remove_rx_listener(self._on_packet)
+        with self._lock:
+            pending = list(self._pending.values())
+            self._pending.clear()
+        for p in pending:
+            if not p.future.done():
+                p.future.cancel()
+
+    def query_async(self, payload: bytes, max_age: Optional[float] = None) -> Future:
+        """
+        Start a query, returns a Future resolved with the response payload.
+
+        Args:
+            payload: Request payload, starts with the key
+            max_age: Accept cached values up to this age (default: ttl)
+        """
+        key = self.key_fn(payload)
+        now = time.monotonic()
+        send = False
+        with self._lock:
+            self.stats['requests'] += 1
+            cached = self._cache.get(key)
+            if cached is not None:
+                value, stamp = cached
+                if now - stamp <= (self.ttl if max_age is None else max_age):
+                    self.stats['hits'] += 1
+                    future = Future()
+                    future.set_result(value)
+                    return future
+                del self._cache[key]
+
+            pending = self._pending.get(key)
+            if pending is not None and now < pending.deadline:
+                self.stats['merges'] += 1
+                return pending.future
+
+            self.stats['misses'] += 1
+            expired = self._take_expired(now)
+            pending = _Pending(Future(), now, now + self.timeout)
+            self._pending[key] = pending
+            send = True
+
+        self._expire(expired)
+        if send and not self.zetta.send_raw(self.request_type, payload):
+            self._fail(key, pending, ConnectionError("request not sent"))
+        return pending.future
+
+    def query(self, payload: bytes, timeout: Optional[float] = None,
+              max_age: Optional[float] = None) -> Optional[bytes]:
+        """
+        Blocking query, returns the response payload or None on timeout.
+
+        The timeout applies to this caller only. Callers merged into the same
+        request keep waiting; the request itself fails after ``self.timeout``.
+        """
+        key = self.key_fn(payload)
+        future = self.query_async(payload, max_age)
+        try:
+            return future.result(self.timeout if timeout is None else timeout)
+        except FutureTimeout:
+            now = time.monotonic()
+            with self._lock:
+                self.stats['timeouts'] += 1
+                pending = self._pending.get(key)
+                if pending is not None and pending.future is future and now >= pending.deadline:
+                    del self._pending[key]
+                else:
+                    pending = None
+            if pending is not None:
+                self._expire([pending])
+            return None
+        except Exception:
+            return None
+
+    def invalidate(self, key: Optional[bytes] = None):
+        """Drop one cached key, or the whole cache"""
+        with self._lock:
+            if key is None:
+                self._cache.clear()
+            else:
+                self._cache.pop(key, None)
+
+    def get_stats(self) -> dict:
+        with self._lock:
+            stats = self.stats.copy()
+        served = stats['hits'] + stats['merges']
+        stats['hit_ratio'] = served / stats['requests'] if stats['requests'] else 0.0
+        return stats
+
+    def _fail(self, key: bytes, pending: _Pending, error: Exception):
+        with self._lock:
+            if self._pending.get(key) is pending:
+                del self._pending[key]
+        if not pending.future.done():
+            pending.future.set_exception(error)
+
+    def _take_expired(self, now: float) -> list:
+        """Remove requests past their deadline, caller holds the lock"""
+        expired = [k for k, p in self._pending.items() if now >= p.deadline]
+        return [self._pending.pop(k) for k in expired]
+
+    def _expire(self, expired: list):
+        for pending in expired:
+            if not pending.future.done():
+                pending.future.set_exception(TimeoutError("no response"))
+
+    def _on_packet(self, packet: ZettaPacket):
+        if packet.type == self.response_type:
+            key = self.key_fn(packet.data)
+            now = time.monotonic()
+            with self._lock:
+                pending = self._pending.pop(key, None)
+                self._cache[key] = (packet.data, now)
+                if pending is None:
+                    self.stats['unsolicited'] += 1
+                expired = self._take_expired(now)
+            self._expire(expired)
+            if pending is not None:
+                self.zetta.record_rtt(now - pending.sent)
+                if not pending.future.done():
+                    pending.future.set_result(packet.data)
+        elif self.update_type is not None and packet.type == self.update_type:
+            key = self.key_fn(packet.data)
+            with self._lock:
+                if self._cache.pop(key, None) is not None:
+                    self.stats['invalidations'] += 1
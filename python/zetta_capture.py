@@ -0,0 +1,150 @@
+# zetta_capture.py
+"""
+Host side of the triggered burst capture service (Core/inc/zetta_capture.h).
+
+The device records samples at full acquisition rate into a pre/post trigger
+ring buffer and drains the captured window in the background as MSG_CAPTURE
+frames. CaptureClient configures and arms the device and reassembles the
+drained windows.
+"""
+import struct
+import time
+from dataclasses import dataclass, field
+from enum import IntEnum
+from typing import Callable, Dict, List, Optional
+
+from zetta_protocol import ZettaPacket, ZettaPacketType
+
+class CaptureCmd(IntEnum):
+    """Host -> device, must match ZettaCaptureCmd_t"""
+    CONFIGURE = 0x00
+    ARM = 0x01
+    DISARM = 0x02
+    TRIGGER = 0x03
+    LEVEL = 0x04
+
+class CaptureMsg(IntEnum):
+    """Device -> host, must match ZettaCaptureMsg_t"""
+    BEGIN = 0x80
+    DATA = 0x81
+    END = 0x82
+
+class CaptureLevel(IntEnum):
+    """Level trigger modes, must match ZettaCaptureLevel_t"""
+    OFF = 0
+    ABOVE = 1
+    BELOW = 2
+    RISING = 3
+    FALLING = 4
+
+FLAG_REARM = 0x01
+
+@dataclass
+class Capture:
+    """A captured window, samples[pre] is the first sample after the trigger"""
+    id: int
+    total: int
+    pre: int
+    sample_size: int
+    samples: List[Optional[bytes]] = field(default_factory=list)
+    overruns: int = 0
+    complete: bool = False
+    started: float = 0.0
+    finished: float = 0.0
+
+    @property
+    def missing(self) -> List[int]:
+        return [i for i, s in enumerate(self.samples) if s is None]
+
+    def unpack(self, format_str: str) -> List[tuple]:
+        """Decode every received sample with a struct format"""
+        return [struct.unpack(format_str, s) for s in self.samples if s is not None]
+
+class CaptureClient:
+    """
+    Control a device capture service and collect its captures.
+
+    Feed every received packet to ``feed`` (for example from rx_callback);
+    completed captures are returned and passed to ``on_capture``.
+    """
+
+    def __init__(self, zetta, packet_type: int = ZettaPacketType.MSG_CAPTURE,
+                 on_capture: Optional[Callable[[Capture], None]] = None):
+        self.zetta = zetta
+        self.packet_type = packet_type
+        self.on_capture = on_capture
+        self._current: Dict[int, Capture] = {}
+        self.stats = {'captures': 0, 'incomplete': 0, 'samples': 0}
+
+    # Commands
+    def configure(self, pre: int, post: int, rearm: bool = False) -> bool:
+        flags = FLAG_REARM if rearm else 0
+        return self._command(struct.pack('<BHHB', CaptureCmd.CONFIGURE, pre, post, flags))
+
+    def arm(self) -> bool:
+        return self._command(bytes([CaptureCmd.ARM]))
+
+    def disarm(self) -> bool:
+        return self._command(bytes([CaptureCmd.DISARM]))
+
+    def trigger(self) -> bool:
+        return self._command(bytes([CaptureCmd.TRIGGER]))
+
+    def set_level_trigger(self, offset: int, width: int, mode: CaptureLevel,
+                          level: int) -> bool:
+        """
+        Trigger on a signed little endian field of each sample.
+
+        Args:
+            offset: Byte offset of the field in the sample
+            width: Field size, 1, 2 or 4 bytes
+            mode: CaptureLevel mode, OFF disables the level trigger
+            level: Threshold
+        """
+        if width not in (1, 2, 4):
+            raise ValueError("width must be 1, 2 or 4")
+        return self._command(struct.pack('<BBBBi', CaptureCmd.LEVEL, offset,
+                                         width, mode, level))
+
+    def _command(self, payload: bytes) -> bool:
+        return self.zetta.send_raw(self.packet_type, payload)
+
+    # Reception
+    def feed(self, packet: ZettaPacket) -> Optional[Capture]:
+        """Process a received packet, returns a capture once it is complete"""
+        data = packet.data
+        if packet.type != self.packet_type or len(data) < 2:
+            return None
+
+        msg, cid = data[0], data[1]
+        if msg == CaptureMsg.BEGIN and len(data) >= 7:
+            total, pre, sample_size = struct.unpack_from('<HHB', data, 2)
+            if cid in self._current:
+                self.stats['incomplete'] += 1
+            self._current[cid] = Capture(cid, total, pre, sample_size,
+                                         [None] * total, started=time.time())
+        elif msg == CaptureMsg.DATA and len(data) >= 4:
+            cap = self._current.get(cid)
+            if cap is None:
+                return None
+            index = struct.unpack_from('<H', data, 2)[0]
+            body = data[4:]
+            size = cap.sample_size
+            for i in range(len(body) // size):
+                if index + i < cap.total:
+                    cap.samples[index + i] = bytes(body[i * size:(i + 1) * size])
+        elif msg == CaptureMsg.END and len(data) >= 6:
+            cap = self._current.pop(cid, None)
+            if cap is None:
+                return None
+            cap.overruns = struct.unpack_from('<H', data, 4)[0]
+            cap.complete = not cap.missing
+            cap.finished = time.time()
+            self.stats['captures'] += 1
+            self.stats['samples'] += cap.total - len(cap.missing)
+            if not cap.complete:
+                self.stats['incomplete'] += 1
+            if self.on_capture:
+                self.on_capture(cap)
+            return cap
+        return None
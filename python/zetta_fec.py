@@ -0,0 +1,259 @@
+# zetta_fec.py
+"""
+Inter-frame XOR parity, mirror of Core/inc/zetta_fec.h.
+
+Frames sent through ZettaFec.send travel as MSG_FEC frames in groups of N.
+After the last frame of a group, a parity frame carries the XOR of the
+group's types, lengths and payloads. The receiver delivers data frames as
+they arrive and rebuilds any single lost frame of a group from the parity,
+with no round trip, at a cost of one frame per N.
+
+N adapts to the frame loss rate p: the largest N (2..15) whose residual loss
+N * p^2 stays under `target`. The loss rate comes from the peer's loss
+reports (report_interval) or, on one-way links, from set_loss().
+
+    data:   [group, N << 4 | index, type, payload...]
+    parity: [group, K << 4 | K, xor types, xor lengths, xor payloads...]
+    report: [0xFF, 0x00, loss u16]
+
+Loss rates are fractions here and 0..65535 on the wire and in C.
+"""
+import struct
+import threading
+import time
+from typing import Callable, Optional
+
+from zetta_protocol import PacketType, ZettaPacket, ZettaPacketType, lookup_packet_type
+
+HEADER_SIZE = 3
+MIN_N = 2
+MAX_N = 15
+EWMA_SHIFT = 10  # loss rate over about 1000 frame slots
+DEFAULT_TARGET = 66 / 65535
+REPORT_GROUP = 0xFF
+
+_report = struct.Struct('<BBH')
+
+def group_size(loss: float, target: float = DEFAULT_TARGET) -> int:
+    """Largest group whose residual loss N * p^2 stays under target"""
+    loss16 = min(0xFFFF, int(loss * 0xFFFF))
+    target16 = min(0xFFFF, int(target * 0xFFFF + 0.5))
+    if loss16 == 0:
+        return MAX_N
+    # Same integer arithmetic as zetta_fec_group_size
+    n = (target16 << 16) // (loss16 * loss16)
+    return max(MIN_N, min(MAX_N, n))
+
+def _xor_into(acc: bytearray, data: bytes):
+    for i, b in enumerate(data):
+        acc[i] ^= b
+
+class ZettaFec:
+    """
+    Parity protected frames over one ZettaProtocol instance, both directions.
+
+    Args:
+        zetta: ZettaProtocol instance
+        on_frame: Called with (packet type, payload, recovered) for every
+            data frame received or rebuilt
+        group: Fixed group size, None for adaptive
+        target: Residual loss target of the adaptive group size
+        flush: Seconds without data before a partial group gets its parity
+        report_interval: Seconds between loss reports to the peer, None for
+            one-way links
+        clock: Time source in seconds
+    """
+
+    def __init__(self, zetta, on_frame: Optional[Callable[[PacketType, bytes, bool], None]] = None,
+                 group: Optional[int] = None, target: float = DEFAULT_TARGET,
+                 flush: Optional[float] = 0.05, report_interval: Optional[float] = None,
+                 clock: Callable[[], float] = time.monotonic):
+        if group is not None and not MIN_N <= group <= MAX_N:
+            raise ValueError(f"group size must be {MIN_N}..{MAX_N}")
+        self.zetta = zetta
+        self.on_frame = on_frame
+        self.group = group
+        self.target = target
+        self.flush = flush
+        self.report_interval = report_interval
+        self.clock = clock
+        self.type = ZettaPacketType.MSG_FEC
+        self.max_data = zetta.tx_profile.max_payload - HEADER_SIZE - 1
+        self._lock = threading.Lock()
+        # sender
+        self.n = MAX_N
+        self.tx_loss = 0.0
+        self._tx_group = 0
+        self._tx_index = 0
+        self._tx_type_x = 0
+        self._tx_len_x = 0
+        self._tx_parity = bytearray(self.max_data)
+        self._tx_max_len = 0
+        self._last_tx = 0.0
+        self._last_report = clock()
+        # receiver
+        self._rx_group = 0
+        self._rx_n = 0
+        self._rx_open = False
+        self._rx_synced = False
+        self._rx_mask = 0
+        self._rx_type_x = 0
+        self._rx_len_x = 0
+        self._rx_x = bytearray(256)
+        self._loss_acc = 0  # 2**32 = 100%
+        self.loss_ewma = 0  # 0..65535 like the C side
+        self.stats = {'tx_frames': 0, 'tx_parity': 0, 'rx_frames': 0, 'recovered': 0,
+                      'lost': 0, 'unrecoverable': 0}
+        zetta.add_rx_listener(self.feed)
+
+    def close(self):
+        self.zetta.remove_rx_listener(self.feed)
+
+    @property
+    def loss(self) -> float:
+        """Smoothed loss rate of received frame slots"""
+        return self.loss_ewma / 0xFFFF
+
+    def set_loss(self, loss: float):
+        """Loss rate for the adaptive group size when the peer cannot report it"""
+        self.tx_loss = loss
+
+    # Sender
+
+    def send(self, packet_type: PacketType, payload: bytes) -> bool:
+        """Send one frame, the group's parity follows its last frame"""
+        if len(payload) > self.max_data:
+            raise ValueError(f"payload too large for FEC: {len(payload)} > {self.max_data}")
+        with self._lock:
+            if self._tx_index == 0:
+                self.n = self.group or group_size(self.tx_loss, self.target)
+                self._tx_type_x = self._tx_len_x = self._tx_max_len = 0
+                self._tx_parity = bytearray(self.max_data)
+            header = bytes((self._tx_group, self.n << 4 | self._tx_index, int(packet_type)))
+            if not self.zetta.send_raw(self.type, header + payload):
+                return False
+            self._tx_type_x ^= int(packet_type)
+            self._tx_len_x ^= len(payload)
+            _xor_into(self._tx_parity, payload)
+            self._tx_max_len = max(self._tx_max_len, len(payload))
+            self.stats['tx_frames'] += 1
+            self._last_tx = self.clock()
+            self._tx_index += 1
+            if self._tx_index == self.n:
+                self._send_parity()
+            return True
+
+    def _send_parity(self):
+        k = self._tx_index
+        frame = (bytes((self._tx_group, k << 4 | k, self._tx_type_x, self._tx_len_x)) +
+                 bytes(self._tx_parity[:self._tx_max_len]))
+        self.zetta.send_raw(self.type, frame)
+        self._tx_group = (self._tx_group + 1) & 0xFF
+        self._tx_index = 0
+        self.stats['tx_parity'] += 1
+
+    def tick(self, now: Optional[float] = None):
+        """Flush timeout of partial groups and loss reports, call periodically"""
+        now = self.clock() if now is None else now
+        with self._lock:
+            if self._tx_index and self.flush is not None and now - self._last_tx >= self.flush:
+                self._send_parity()
+            if (self.report_interval is not None and
+                    now - self._last_report >= self.report_interval):
+                self._last_report = now
+                self.zetta.send_raw(self.type, _report.pack(REPORT_GROUP, 0, self.loss_ewma))
+
+    # Receiver
+
+    def _slots(self, received: int, lost: int):
+        acc = self._loss_acc
+        for _ in range(received):
+            acc -= acc >> EWMA_SHIFT
+        for _ in range(lost):
+            acc += (0xFFFFFFFF - acc) >> EWMA_SHIFT
+        self._loss_acc = acc
+        self.loss_ewma = acc >> 16
+
+    def _close(self):
+        """Close a group whose parity never came"""
+        if not self._rx_open:
+            return
+        missing = self._rx_n - bin(self._rx_mask).count('1')
+        self.stats['lost'] += missing
+        if missing > 1:
+            self.stats['unrecoverable'] += 1
+        self._slots(0, missing + 1)
+        self._rx_open = False
+
+    def _start(self, group: int, n: int):
+        self._close()
+        if self._rx_synced:
+            # Whole groups lost in between, sized like the last one
+            gap = min(8, (group - self._rx_group - 1) & 0xFF)
+            self.stats['lost'] += gap * self._rx_n
+            self._slots(0, gap * (self._rx_n + 1))
+        self._rx_synced = True
+        self._rx_open = True
+        self._rx_group = group
+        self._rx_n = n
+        self._rx_mask = 0
+        self._rx_type_x = self._rx_len_x = 0
+        self._rx_x = bytearray(256)
+
+    def feed(self, packet: ZettaPacket):
+        if packet.type != self.type:
+            return
+        with self._lock:
+            delivered = self._handle(packet.data)
+        # Handlers run outside the lock, they may send
+        if delivered is not None and self.on_frame is not None:
+            self.on_frame(*delivered)
+
+    def _handle(self, data: bytes):
+        if len(data) < 2:
+            return None
+        group, n, index = data[0], data[1] >> 4, data[1] & 0x0F
+        if n == 0:
+            if len(data) >= _report.size:
+                self.tx_loss = _report.unpack_from(data)[2] / 0xFFFF
+            return None
+        if index > n or len(data) < HEADER_SIZE + (index == n):
+            return None
+        if not self._rx_synced or group != self._rx_group:
+            self._start(group, n)
+        elif not self._rx_open:
+            return None  # late duplicate of a finished group
+
+        if index < n:
+            body = data[HEADER_SIZE:]
+            if self._rx_mask & (1 << index):
+                return None
+            self._rx_mask |= 1 << index
+            self._rx_type_x ^= data[2]
+            self._rx_len_x ^= len(body)
+            _xor_into(self._rx_x, body)
+            self.stats['rx_frames'] += 1
+            self._slots(1, 0)
+            return lookup_packet_type(data[2]), body, False
+
+        # Parity: n is the number of data frames it covers
+        missing = n - bin(self._rx_mask & ((1 << n) - 1)).count('1')
+        self._rx_open = False
+        self._slots(1, missing)
+        if missing == 0:
+            return None
+        if missing > 1:
+            self.stats['lost'] += missing
+            self.stats['unrecoverable'] += 1
+            return None
+        parity = data[HEADER_SIZE + 1:]
+        size = data[3] ^ self._rx_len_x
+        if size > len(parity):
+            self.stats['lost'] += 1
+            return None
+        frame = bytes(p ^ x for p, x in zip(parity[:size], self._rx_x))
+        self.stats['recovered'] += 1
+        return lookup_packet_type(data[2] ^ self._rx_type_x), frame, True
+
+    def get_stats(self) -> dict:
+        return dict(self.stats, loss=self.loss, group=self.n, tx_loss=self.tx_loss)
@@ -0,0 +1,379 @@
+# zetta_filter.py
+"""
+Compiler for Zetta publish filters.
+
+Filter expressions are compiled into the bytecode run by the C core
+(Core/inc/zetta_filter.h) and uploaded with MSG_FILTER frames. The device
+then only publishes frames of the target type the expression accepts.
+
+Expression syntax:
+    u8[0] == 3 and i16[2] > -100
+    f32[4] >= 20.5 or len < 4
+    every(10)                      # every 10th frame
+    count % 4 == 0 and not (u16[1] & 0x8000)
+
+Fields: u8, i8, u16, i16, i32 and f32 at a payload byte offset (little
+endian), len (payload length) and count (previous runs of the program).
+f32 values are compared in fixed point with F32_SCALE.
+"""
+import re
+import struct
+from dataclasses import dataclass
+from enum import IntEnum
+from typing import List, Optional, Union
+
+MAX_INSNS = 32
+MEM_WORDS = 4
+INSNS_PER_FRAME = 2
+MAX_PAYLOAD_SIZE = 25
+F32_SCALE = 1000
+
+class Op(IntEnum):
+    """Opcodes, must match ZettaFilterOp_t"""
+    RET = 0
+    LDI = 1
+    LD_U8 = 2
+    LD_I8 = 3
+    LD_U16 = 4
+    LD_I16 = 5
+    LD_I32 = 6
+    LD_F32 = 7
+    LD_LEN = 8
+    LD_CNT = 9
+    LDM = 10
+    ST = 11
+    ADD = 12
+    SUB = 13
+    MUL = 14
+    MOD = 15
+    AND = 16
+    NEG = 17
+    SUBM = 18
+    JA = 19
+    JEQ = 20
+    JGT = 21
+    JGE = 22
+    JSET = 23
+
+class Cmd(IntEnum):
+    """MSG_FILTER commands, must match ZettaFilterCmd_t"""
+    CLEAR = 0
+    LOAD = 1
+    COMMIT = 2
+
+_LOADS = {'u8': (Op.LD_U8, 1), 'i8': (Op.LD_I8, 1),
+          'u16': (Op.LD_U16, 2), 'i16': (Op.LD_I16, 2),
+          'i32': (Op.LD_I32, 4), 'f32': (Op.LD_F32, 4)}
+_JUMPS = (Op.JA, Op.JEQ, Op.JGT, Op.JGE, Op.JSET)
+
+@dataclass
+class Insn:
+    op: Op
+    arg: int = 0
+    jt: int = 0
+    jf: int = 0
+    k: int = 0
+
+    def encode(self) -> bytes:
+        return struct.pack('<BBBBi', self.op, self.arg, self.jt, self.jf, self.k)
+
+class FilterError(ValueError):
+    """Raised for invalid filter expressions or programs"""
+
+# Expression tree
+@dataclass
+class _Cmp:
+    load: List[Insn]
+    op: str
+    value: int
+
+@dataclass
+class _Bool:
+    op: str  # 'and', 'or', 'not', 'const'
+    args: list
+
+_TOKEN = re.compile(r"\s*(?:(0x[0-9a-fA-F]+|-?\d+\.\d*|-?\d+)|(==|!=|<=|>=|[<>()\[\]%&])|([A-Za-z_]\w*))")
+
+def _tokenize(text: str) -> List[str]:
+    pos, tokens = 0, []
+    text = text.strip()
+    while pos < len(text):
+        m = _TOKEN.match(text, pos)
+        if not m or m.end() == pos:
+            raise FilterError(f"Unexpected input at {pos}: {text[pos:]!r}")
+        tokens.append(m.group(m.lastindex))
+        pos = m.end()
+    return tokens
+
+class _Parser:
+    def __init__(self, text: str):
+        self.tokens = _tokenize(text)
+        self.pos = 0
+
+    def peek(self) -> Optional[str]:
+        return self.tokens[self.pos] if self.pos < len(self.tokens) else None
+
+    def take(self, expected: Optional[str] = None) -> str:
+        tok = self.peek()
+        if tok is None or (expected is not None and tok != expected):
+            raise FilterError(f"Expected {expected or 'token'}, got {tok!r}")
+        self.pos += 1
+        return tok
+
+    def number(self) -> Union[int, float]:
+        tok = self.take()
+        try:
+            return int(tok, 0) if '.' not in tok else float(tok)
+        except ValueError:
+            raise FilterError(f"Expected number, got {tok!r}")
+
+    def parse(self):
+        node = self.or_expr()
+        if self.peek() is not None:
+            raise FilterError(f"Trailing input: {self.peek()!r}")
+        return node
+
+    def or_expr(self):
+        node = self.and_expr()
+        while self.peek() == 'or':
+            self.take()
+            node = _Bool('or', [node, self.and_expr()])
+        return node
+
+    def and_expr(self):
+        node = self.not_expr()
+        while self.peek() == 'and':
+            self.take()
+            node = _Bool('and', [node, self.not_expr()])
+        return node
+
+    def not_expr(self):
+        if self.peek() == 'not':
+            self.take()
+            return _Bool('not', [self.not_expr()])
+        return self.atom()
+
+    def atom(self):
+        tok = self.peek()
+        if tok == '(':
+            self.take()
+            node = self.or_expr()
+            self.take(')')
+            return node
+        if tok in ('true', 'false'):
+            self.take()
+            return _Bool('const', [tok == 'true'])
+        if tok == 'every':
+            self.take()
+            self.take('(')
+            n = self.number()
+            self.take(')')
+            if not isinstance(n, int) or n <= 0:
+                raise FilterError("every() needs a positive integer")
+            return _Cmp([Insn(Op.LD_CNT), Insn(Op.MOD, k=n)], '==', 0)
+        return self.comparison()
+
+    def value(self):
+        name = self.take()
+        scale = 1
+        if name in _LOADS:
+            op, size = _LOADS[name]
+            self.take('[')
+            off = self.number()
+            self.take(']')
+            if not isinstance(off, int) or off < 0 or off + size > MAX_PAYLOAD_SIZE:
+                raise FilterError(f"Bad offset for {name}: {off}")
+            if op == Op.LD_F32:
+                scale = F32_SCALE
+                load = [Insn(op, arg=off, k=F32_SCALE)]
+            else:
+                load = [Insn(op, arg=off)]
+        elif name == 'len':
+            load = [Insn(Op.LD_LEN)]
+        elif name == 'count':
+            load = [Insn(Op.LD_CNT)]
+        else:
+            raise FilterError(f"Unknown field {name!r}")
+
+        # Optional single arithmetic modifier: field % N, field & MASK
+        if self.peek() in ('%', '&'):
+            op = Op.MOD if self.take() == '%' else Op.AND
+            k = self.number()
+            if not isinstance(k, int) or (op == Op.MOD and k <= 0):
+                raise FilterError("Modifier needs a positive integer")
+            load.append(Insn(op, k=k))
+            scale = 1
+        return load, scale
+
+    def comparison(self):
+        load, scale = self.value()
+        if self.peek() not in ('==', '!=', '<', '<=', '>', '>='):
+            # Bare value: true when non zero
+            return _Cmp(load, '!=', 0)
+        op = self.take()
+        value = round(self.number() * scale)
+        if not -2**31 <= value < 2**31:
+            raise FilterError(f"Constant out of range: {value}")
+        return _Cmp(load, op, value)
+
+class _Label:
+    pass
+
+def _emit(node, t: _Label, f: _Label, out: list):
+    if isinstance(node, _Cmp):
+        out.extend(Insn(i.op, i.arg, i.jt, i.jf, i.k) for i in node.load)
+        # a < k  <=>  not (a >= k), a <= k  <=>  not (a > k)
+        op, jt, jf = {
+            '==': (Op.JEQ, t, f), '!=': (Op.JEQ, f, t),
+            '>': (Op.JGT, t, f), '>=': (Op.JGE, t, f),
+            '<': (Op.JGE, f, t), '<=': (Op.JGT, f, t),
+        }[node.op]
+        out.append((Insn(op, k=node.value), jt, jf))
+    elif node.op == 'const':
+        out.append((Insn(Op.JA), t if node.args[0] else f, None))
+    elif node.op == 'not':
+        _emit(node.args[0], f, t, out)
+    else:
+        mid = _Label()
+        if node.op == 'and':
+            _emit(node.args[0], mid, f, out)
+        else:
+            _emit(node.args[0], t, mid, out)
+        out.append(mid)
+        _emit(node.args[1], t, f, out)
+
+def compile_filter(expression: str) -> List[Insn]:
+    """
+    Compile a filter expression into a verified program.
+
+    Args:
+        expression: Filter expression (see module documentation)
+
+    Returns:
+        List of instructions accepted by zetta_filter_verify
+    """
+    accept, reject = _Label(), _Label()
+    out: list = []
+    _emit(_Parser(expression).parse(), accept, reject, out)
+    out += [accept, Insn(Op.RET, k=1), reject, Insn(Op.RET, k=0)]
+
+    # Resolve labels into forward relative jumps
+    program, where, pending = [], {}, []
+    for item in out:
+        if isinstance(item, _Label):
+            where[item] = len(program)
+        elif isinstance(item, tuple):
+            pending.append((len(program), item))
+            program.append(item[0])
+        else:
+            program.append(item)
+    for pc, (insn, jt, jf) in pending:
+        insn.jt = where[jt] - pc - 1
+        insn.jf = where[jf] - pc - 1 if jf is not None else 0
+    verify(program)
+    return program
+
+def verify(program: List[Insn]):
+    """Host side copy of zetta_filter_verify, raises FilterError"""
+    if not 0 < len(program) <= MAX_INSNS:
+        raise FilterError(f"Program size {len(program)} not in 1..{MAX_INSNS}")
+    n = len(program)
+    for pc, insn in enumerate(program):
+        size = next((s for op, s in _LOADS.values() if op == insn.op), 0)
+        if size and insn.arg + size > MAX_PAYLOAD_SIZE:
+            raise FilterError(f"{pc}: load out of range")
+        if insn.op in (Op.LDM, Op.ST, Op.SUBM) and insn.arg >= MEM_WORDS:
+            raise FilterError(f"{pc}: bad memory index")
+        if insn.op == Op.MOD and insn.k == 0:
+            raise FilterError(f"{pc}: modulo by zero")
+        if not 0 <= insn.jt <= 0xFF or not 0 <= insn.jf <= 0xFF:
+            raise FilterError(f"{pc}: jump too far")
+        if insn.op in _JUMPS:
+            if pc + 1 + insn.jt >= n or (insn.op != Op.JA and pc + 1 + insn.jf >= n):
+                raise FilterError(f"{pc}: jump out of program")
+        elif insn.op != Op.RET and pc + 1 >= n:
+            raise FilterError(f"{pc}: falls off the end")
+
+def run(program: List[Insn], payload: bytes, state: Optional[dict] = None) -> bool:
+    """
+    Reference interpreter, evaluates a program like zetta_filter_run.
+
+    Args:
+        program: Verified program
+        payload: Candidate payload
+        state: Optional dict holding 'runs' and 'mem' between calls
+    """
+    state = state if state is not None else {}
+    mem = state.setdefault('mem', [0] * MEM_WORDS)
+    runs = state.get('runs', 0)
+    wrap = lambda v: (v + 2**31) % 2**32 - 2**31
+    a, pc, verdict = 0, 0, False
+    fmt = {Op.LD_U8: '<B', Op.LD_I8: '<b', Op.LD_U16: '<H', Op.LD_I16: '<h',
+           Op.LD_I32: '<i', Op.LD_F32: '<f'}
+    while pc < len(program):
+        i = program[pc]
+        pc += 1
+        if i.op in fmt:
+            size = struct.calcsize(fmt[i.op])
+            if i.arg + size > len(payload):
+                break
+            a = struct.unpack_from(fmt[i.op], payload, i.arg)[0]
+            if i.op == Op.LD_F32:
+                a = a * i.k
+                a = 0 if a != a else int(max(min(a, 2**31 - 1), -2**31))
+        elif i.op == Op.RET:
+            verdict = i.k != 0
+            break
+        elif i.op == Op.LDI: a = i.k
+        elif i.op == Op.LD_LEN: a = len(payload)
+        elif i.op == Op.LD_CNT: a = wrap(runs)
+        elif i.op == Op.LDM: a = mem[i.arg]
+        elif i.op == Op.ST: mem[i.arg] = a
+        elif i.op == Op.ADD: a = wrap(a + i.k)
+        elif i.op == Op.SUB: a = wrap(a - i.k)
+        elif i.op == Op.MUL: a = wrap(a * i.k)
+        elif i.op == Op.MOD: a = wrap((a % 2**32) % (i.k % 2**32))
+        elif i.op == Op.AND: a = a & i.k
+        elif i.op == Op.NEG: a = wrap(-a)
+        elif i.op == Op.SUBM: a = wrap(a - mem[i.arg])
+        elif i.op == Op.JA: pc += i.jt
+        elif i.op == Op.JEQ: pc += i.jt if a == i.k else i.jf
+        elif i.op == Op.JGT: pc += i.jt if a > i.k else i.jf
+        elif i.op == Op.JGE: pc += i.jt if a >= i.k else i.jf
+        elif i.op == Op.JSET: pc += i.jt if a & i.k else i.jf
+    state['runs'] = runs + 1
+    return verdict
+
+def build_frames(slot: int, packet_type: int, program: List[Insn]) -> List[bytes]:
+    """Build the MSG_FILTER payloads that install a program in a slot"""
+    verify(program)
+    frames = [bytes([Cmd.CLEAR, slot])]
+    for index in range(0, len(program), INSNS_PER_FRAME):
+        chunk = program[index:index + INSNS_PER_FRAME]
+        frames.append(bytes([Cmd.LOAD, slot, index]) + b''.join(i.encode() for i in chunk))
+    frames.append(bytes([Cmd.COMMIT, slot, int(packet_type), len(program)]))
+    return frames
+
+def upload_filter(zetta, slot: int, packet_type: int,
+                  expression: Union[str, List[Insn]]) -> bool:
+    """
+    Compile and install a filter on the device.
+
+    Args:
+        zetta: ZettaProtocol instance
+        slot: Filter slot on the device
+        packet_type: Type the filter applies to
+        expression: Filter expression or compiled program
+
+    Returns:
+        True if all frames were sent
+    """
+    from zetta_protocol import ZettaPacketType
+    program = compile_filter(expression) if isinstance(expression, str) else expression
+    return all(zetta.send_raw(ZettaPacketType.MSG_FILTER, frame)
+               for frame in build_frames(slot, packet_type, program))
+
+def clear_filter(zetta, slot: int) -> bool:
+    """Remove the filter installed in a slot"""
+    from zetta_protocol import ZettaPacketType
+    return zetta.send_raw(ZettaPacketType.MSG_FILTER, bytes([Cmd.CLEAR, slot]))
@@ -0,0 +1,316 @@
+# zetta_join.py
+"""
+Time-aligned join of sample streams from several links.
+
+Every stream delivers (device timestamp, value) samples, possibly a little
+out of order. The first stream is the reference: for each of its samples the
+join picks, from every other stream, the sample closest in time within
+`tolerance` and emits one fused record.
+
+A record for time t is emitted once every stream has progressed past
+t + tolerance, as told by the watermarks:
+
+    watermark(stream) = newest timestamp - lateness
+    watermark = min over the active streams
+
+so memory and latency are bounded by the slowest stream, `lateness` and
+`tolerance`. A stream that sent nothing for `idle_timeout` seconds of host
+time stops holding the watermark back until it delivers again. Samples that
+arrive behind the watermark are late: they are counted and their lateness is
+recorded, but they still join the records that were not emitted yet. Only a
+late sample whose records are already out is dropped (and counted).
+
+    join = StreamJoin(on_record, tolerance=0.002, lateness=0.005)
+    join.add_stream('imu', imu_link, ZettaPacketType.MSG_PUBLISH, parse_imu)
+    join.add_stream('gps', gps_link, ZettaPacketType.MSG_PUBLISH, parse_gps)
+
+parse() turns a payload into (timestamp in seconds, value). Timestamps of all
+streams must share a timebase, `offset` corrects a known clock offset.
+"""
+import threading
+import time
+from bisect import bisect_left, insort
+from typing import Any, Callable, Dict, List, Optional, Tuple
+
+from zetta_protocol import PacketType, ZettaPacket
+
+class JoinRecord:
+    """Fused record: reference time and one value per stream (None if missing)"""
+    __slots__ = ('time', 'values')
+
+    def __init__(self, t: float, values: Dict[str, Any]):
+        self.time = t
+        self.values = values
+
+    def __repr__(self) -> str:
+        return f"<JoinRecord t={self.time:.6f} {self.values}>"
+
+class JoinStream:
+    """Buffered samples and statistics of one input stream"""
+
+    def __init__(self, name: str, offset: float):
+        self.name = name
+        self.offset = offset
+        self.times: List[float] = []
+        self.values: List[Any] = []
+        self.newest = float('-inf')
+        self.last_rx = 0.0  # host time of the last sample
+        self.received = 0
+        self.late = 0  # arrived behind the watermark
+        self.dropped = 0  # late and no longer usable
+        self.late_max = 0.0
+        self.late_sum = 0.0
+        self.reordered = 0
+        self.overflow = 0
+        self.matched = 0
+        self.peak = 0
+
+    def insert(self, t: float, value: Any):
+        times = self.times
+        if not times or t >= times[-1]:
+            times.append(t)
+            self.values.append(value)
+        else:
+            # Out of order within the lateness bound
+            i = bisect_left(times, t)
+            times.insert(i, t)
+            self.values.insert(i, value)
+            self.reordered += 1
+        if len(times) > self.peak:
+            self.peak = len(times)
+
+    def evict(self, before: float):
+        """Drop samples older than `before`"""
+        k = bisect_left(self.times, before)
+        if k:
+            del self.times[:k]
+            del self.values[:k]
+
+    def nearest(self, t: float, tolerance: float):
+        """Index of the sample closest to t within tolerance, or None"""
+        times = self.times
+        i = bisect_left(times, t)
+        best = None
+        for j in (i - 1, i):
+            if 0 <= j < len(times) and abs(times[j] - t) <= tolerance:
+                if best is None or abs(times[j] - t) < abs(times[best] - t):
+                    best = j
+        return best
+
+    def as_dict(self) -> dict:
+        return {
+            'received': self.received,
+            'buffered': len(self.times),
+            'peak': self.peak,
+            'matched': self.matched,
+            'reordered': self.reordered,
+            'late': self.late,
+            'dropped': self.dropped,
+            'late_max': self.late_max,
+            'late_mean': self.late_sum / self.late if self.late else 0.0,
+            'overflow': self.overflow,
+        }
+
+class StreamJoin:
+    """
+    Watermark based join of time-stamped streams.
+
+    Args:
+        on_record: Called with every fused JoinRecord, in time order and
+            outside the join's lock (it may push samples or read stats)
+        tolerance: Largest time difference between matched samples (seconds)
+        lateness: Out of order delay tolerated per stream (seconds)
+        idle_timeout: Host seconds without samples before a stream stops
+            holding the watermark back
+        max_buffer: Samples kept per stream; beyond that the oldest reference
+            samples are emitted early and counted as overflow
+        require_all: Emit only records where every stream matched
+        clock: Host time source in seconds
+    """
+
+    def __init__(self, on_record: Callable[[JoinRecord], None],
+                 tolerance: float = 0.001, lateness: float = 0.005,
+                 idle_timeout: float = 0.5, max_buffer: int = 4096,
+                 require_all: bool = False,
+                 clock: Callable[[], float] = time.monotonic):
+        self.on_record = on_record
+        self.tolerance = tolerance
+        self.lateness = lateness
+        self.idle_timeout = idle_timeout
+        self.max_buffer = max_buffer
+        self.require_all = require_all
+        self.clock = clock
+        self.streams: List[JoinStream] = []
+        self._by_name: Dict[str, JoinStream] = {}
+        self.watermark = float('-inf')
+        self.emitted_until = float('-inf')  # time of the last emitted record
+        self.emitted = 0
+        self.incomplete = 0
+        self._lock = threading.Lock()
+        self._out: List[JoinRecord] = []  # emitted, not yet delivered
+        self._delivering = False
+        self._listeners = []
+
+    def add_stream(self, name: str, source=None, packet_type: Optional[PacketType] = None,
+                   parse: Optional[Callable[[bytes], Tuple[float, Any]]] = None,
+                   offset: float = 0.0) -> JoinStream:
+        """
+        Add an input stream, the first one is the reference.
+
+        Args:
+            name: Key of the stream in fused records
+            source: ZettaProtocol (or anything with add_rx_listener) to read
+                from, None to feed the stream with push()
+            packet_type: Only packets of this type belong to the stream
+            parse: Payload -> (timestamp in seconds, value)
+            offset: Added to every timestamp of the stream
+        """
+        if name in self._by_name:
+            raise ValueError(f"duplicate stream {name!r}")
+        stream = JoinStream(name, offset)
+        # Counts as heard from now, so a silent stream goes idle in time
+        stream.last_rx = self.clock()
+        with self._lock:
+            self.streams.append(stream)
+            self._by_name[name] = stream
+        if source is not None:
+            if parse is None:
+                raise ValueError("a stream read from a link needs parse()")
+
+            def on_packet(packet: ZettaPacket):
+                if packet_type is None or packet.type == packet_type:
+                    t, value = parse(packet.data)
+                    self.push(name, t, value)
+
+            source.add_rx_listener(on_packet)
+            self._listeners.append((source, on_packet))
+        return stream
+
+    def close(self):
+        for source, listener in self._listeners:
+            source.remove_rx_listener(listener)
+        self._listeners = []
+
+    def push(self, name: str, t: float, value: Any):
+        """Add one sample of a stream (device time in seconds)"""
+        now = self.clock()
+        with self._lock:
+            stream = self._by_name[name]
+            t += stream.offset
+            stream.received += 1
+            stream.last_rx = now
+            lateness = self.watermark - t
+            if lateness > 0:
+                stream.late += 1
+                stream.late_sum += lateness
+                if lateness > stream.late_max:
+                    stream.late_max = lateness
+                # Still usable unless the records it belongs to are gone
+                horizon = (self.emitted_until if stream is self.streams[0]
+                           else self.emitted_until - self.tolerance)
+                if t <= horizon:
+                    stream.dropped += 1
+                    return
+            stream.insert(t, value)
+            if t > stream.newest:
+                stream.newest = t
+            if len(stream.times) > self.max_buffer:
+                self._overflow(stream)
+            self._advance(now)
+        self._deliver()
+
+    def tick(self):
+        """Re-evaluate idle streams, call when streams may go silent"""
+        with self._lock:
+            self._advance(self.clock())
+        self._deliver()
+
+    def flush(self):
+        """Emit every buffered reference sample (end of input)"""
+        with self._lock:
+            self._emit_until(float('inf'))
+        self._deliver()
+
+    def _deliver(self):
+        """Hand emitted records to on_record outside the lock, in time order"""
+        while True:
+            with self._lock:
+                # One thread delivers at a time, it also takes what others emit
+                if self._delivering or not self._out:
+                    return
+                self._delivering = True
+                records, self._out = self._out, []
+            try:
+                for record in records:
+                    self.on_record(record)
+            finally:
+                with self._lock:
+                    self._delivering = False
+
+    def _advance(self, now: float):
+        wm = float('inf')
+        for s in self.streams:
+            if now - s.last_rx > self.idle_timeout:
+                continue
+            w = s.newest - self.lateness
+            if w < wm:
+                wm = w
+        if wm == float('inf'):
+            return  # everything idle, nothing to decide on
+        if wm > self.watermark:
+            self.watermark = wm
+            self._emit_until(wm - self.tolerance)
+
+    def _overflow(self, stream: JoinStream):
+        stream.overflow += 1
+        if stream is self.streams[0]:
+            # Emit the oldest reference sample with what is there
+            self._emit_until(stream.times[0])
+        else:
+            stream.evict(stream.times[1])
+
+    def _emit_until(self, limit: float):
+        """Emit reference samples with time <= limit"""
+        ref = self.streams[0]
+        others = self.streams[1:]
+        tol = self.tolerance
+        n = 0
+        for t in ref.times:
+            if t > limit:
+                break
+            values = {ref.name: ref.values[n]}
+            complete = True
+            for s in others:
+                j = s.nearest(t, tol)
+                if j is None:
+                    values[s.name] = None
+                    complete = False
+                else:
+                    values[s.name] = s.values[j]
+                    s.matched += 1
+            n += 1
+            self.emitted_until = t
+            if complete:
+                ref.matched += 1
+            elif self.require_all:
+                self.incomplete += 1
+                continue
+            else:
+                self.incomplete += 1
+            self.emitted += 1
+            self._out.append(JoinRecord(t, values))
+        if n:
+            del ref.times[:n]
+            del ref.values[:n]
+            # Later references are newer, older samples can never match
+            for s in others:
+                s.evict(self.emitted_until - tol)
+
+    def get_stats(self) -> dict:
+        with self._lock:
+            return {
+                'watermark': self.watermark,
+                'emitted': self.emitted,
+                'incomplete': self.incomplete,
+                'streams': {s.name: s.as_dict() for s in self.streams},
+            }
@@ -0,0 +1,265 @@
+# zetta_link.py
+"""
+Heartbeat, liveness and failover, mirror of Core/inc/zetta_link.h.
+
+A ZettaLogicalLink spreads one logical link over several ZettaProtocol
+instances (primary first, then standbys). Every path is pinged with
+MSG_LINK frames when nothing else was sent on it for `interval` seconds and
+is declared down when nothing was received for its adaptive timeout:
+
+    timeout = max(interval + srtt + 4 * rttvar, gap_avg + 4 * gap_dev)
+
+clamped to [min_timeout, max_timeout], counted from the first tick() for a
+path that never received anything. While the active path is not up, traffic
+moves to the first path that is up together with its unsent frames;
+sequence numbers continue because all paths share the sequence channels.
+
+tick() does all the work and takes the current time from `clock`, so the
+link runs on a thread (start()) or on the simulator (zetta_sim.SimClock).
+"""
+import struct
+import threading
+import time
+from collections import deque
+from enum import IntEnum
+from typing import Callable, List, Optional
+
+from zetta_protocol import PacketType, ZettaPacket, ZettaPacketType
+
+OP_PING = 0x00
+OP_PONG = 0x01
+PROBE_EVERY = 4  # ping at least every 4 intervals to keep RTT fresh
+
+_heartbeat = struct.Struct('<BBI')  # op, seq, t0 (microseconds)
+
+class PathState(IntEnum):
+    UNKNOWN = 0  # nothing received yet
+    UP = 1
+    DOWN = 2
+
+class _Estimator:
+    """Smoothed mean and mean deviation, RFC 6298 style"""
+    __slots__ = ('mean', 'dev', 'valid')
+
+    def __init__(self):
+        self.mean = 0.0
+        self.dev = 0.0
+        self.valid = False
+
+    def update(self, sample: float):
+        if not self.valid:
+            self.mean = sample
+            self.dev = sample / 2
+            self.valid = True
+            return
+        delta = sample - self.mean
+        self.mean += delta / 8
+        self.dev += (abs(delta) - self.dev) / 4
+
+class LinkPath:
+    """Liveness state of one physical path"""
+
+    def __init__(self, endpoint, max_timeout: float):
+        self.endpoint = endpoint
+        self.state = PathState.UNKNOWN
+        self.ping_seq = 0
+        self.last_rx: Optional[float] = None  # first tick() until something arrived
+        self.last_tx = float('-inf')
+        self.last_ping = float('-inf')
+        self.tx_frames = endpoint.stats['packets_sent']
+        self.rtt = _Estimator()
+        self.gap = _Estimator()
+        self.timeout = max_timeout
+        self.downs = 0
+
+    def as_dict(self) -> dict:
+        return {
+            'name': self.endpoint.transport.name,
+            'state': self.state.name,
+            'srtt': self.rtt.mean,
+            'rttvar': self.rtt.dev,
+            'timeout': self.timeout,
+            'downs': self.downs,
+        }
+
+class ZettaLogicalLink:
+    """
+    One logical link over a primary and standby ZettaProtocol instances.
+
+    Args:
+        endpoints: ZettaProtocol instances, primary first
+        interval: Idle time before a path is pinged (seconds)
+        min_timeout: Lower bound of the liveness timeout
+        max_timeout: Upper bound of the liveness timeout
+        clock: Time source in seconds
+        on_failover: Called with (from index, to index) after a switch
+        queue_size: Frames kept while no path is up
+    """
+
+    def __init__(self, endpoints: List, interval: float = 0.02,
+                 min_timeout: float = 0.03, max_timeout: float = 1.0,
+                 clock: Callable[[], float] = time.monotonic,
+                 on_failover: Optional[Callable[[int, int], None]] = None,
+                 queue_size: int = 64):
+        if not endpoints:
+            raise ValueError("a logical link needs at least one endpoint")
+        self.interval = interval
+        self.min_timeout = min_timeout
+        self.max_timeout = max_timeout
+        self.clock = clock
+        self.on_failover = on_failover
+        self.type = ZettaPacketType.MSG_LINK
+        self.paths = [LinkPath(ep, max_timeout) for ep in endpoints]
+        self.active = 0
+        self.failovers = 0
+        self.dropped = 0
+        self._pending = deque(maxlen=queue_size)
+        self._listeners = ()
+        self._thread = None
+        self._stop = threading.Event()
+        # All paths share one set of sequence channels
+        shared = endpoints[0]._seq
+        for ep in endpoints[1:]:
+            shared.update(ep._seq)
+            ep._seq = shared
+        self._rx = []
+        for path in self.paths:
+            listener = self._make_listener(path)
+            path.endpoint.add_rx_listener(listener)
+            self._rx.append(listener)
+
+    @property
+    def endpoint(self):
+        """Endpoint of the active path"""
+        return self.paths[self.active].endpoint
+
+    def add_rx_listener(self, listener: Callable[[ZettaPacket], None]):
+        """Receive application packets of every path (heartbeats excluded)"""
+        self._listeners = self._listeners + (listener,)
+
+    def remove_rx_listener(self, listener: Callable[[ZettaPacket], None]):
+        self._listeners = tuple(l for l in self._listeners if l != listener)
+
+    def send_raw(self, packet_type: PacketType, payload: bytes) -> bool:
+        """Send on the active path, kept until a path comes up when all are down"""
+        path = self.paths[self.active]
+        if path.state != PathState.DOWN and not self._pending:
+            return path.endpoint.send_raw(packet_type, payload)
+        if len(self._pending) == self._pending.maxlen:
+            self.dropped += 1
+        self._pending.append((packet_type, payload))
+        return True
+
+    def _make_listener(self, path: LinkPath):
+        def on_packet(packet: ZettaPacket):
+            self._on_rx(path, packet)
+        return on_packet
+
+    def _on_rx(self, path: LinkPath, packet: ZettaPacket):
+        now = self.clock()
+        if path.state != PathState.UNKNOWN:
+            path.gap.update(now - path.last_rx)
+        path.last_rx = now
+        path.state = PathState.UP
+        if packet.type == self.type:
+            data = packet.data
+            if len(data) >= _heartbeat.size:
+                op, seq, t0 = _heartbeat.unpack_from(data)
+                if op == OP_PING:
+                    path.endpoint.send_raw(self.type, _heartbeat.pack(OP_PONG, seq, t0))
+                elif op == OP_PONG:
+                    now_us = int(now * 1e6) & 0xFFFFFFFF
+                    path.rtt.update(((now_us - t0) & 0xFFFFFFFF) / 1e6)
+            self._update_timeout(path)
+            return
+        self._update_timeout(path)
+        for listener in self._listeners:
+            listener(packet)
+
+    def _update_timeout(self, path: LinkPath):
+        rtt_based = self.interval + path.rtt.mean + 4 * path.rtt.dev
+        gap_based = path.gap.mean + 4 * path.gap.dev
+        path.timeout = min(self.max_timeout,
+                           max(self.min_timeout, rtt_based, gap_based))
+
+    def tick(self, now: Optional[float] = None):
+        """Heartbeats, timeouts, failover and queued frames"""
+        if now is None:
+            now = self.clock()
+        for path in self.paths:
+            ep = path.endpoint
+            # Anything sent on the path proves we are alive to the peer
+            sent = ep.stats['packets_sent']
+            if sent != path.tx_frames:
+                path.tx_frames = sent
+                path.last_tx = now
+            # A path that never answers times out from the first tick
+            if path.last_rx is None:
+                path.last_rx = now
+            if path.state != PathState.DOWN and now - path.last_rx > path.timeout:
+                path.state = PathState.DOWN
+                path.downs += 1
+            if (now - path.last_tx >= self.interval or
+                    now - path.last_ping >= self.interval * PROBE_EVERY):
+                t0 = int(now * 1e6) & 0xFFFFFFFF
+                if ep.send_raw(self.type, _heartbeat.pack(OP_PING, path.ping_seq, t0)):
+                    path.ping_seq = (path.ping_seq + 1) & 0xFF
+                    path.last_ping = now
+                    path.last_tx = now
+                    path.tx_frames = ep.stats['packets_sent']
+
+        if self.paths[self.active].state != PathState.UP:
+            for i, path in enumerate(self.paths):
+                if path.state == PathState.UP:
+                    self._failover(i)
+                    break
+
+        path = self.paths[self.active]
+        while self._pending and path.state != PathState.DOWN:
+            packet_type, payload = self._pending.popleft()
+            path.endpoint.send_raw(packet_type, payload)
+
+    def _failover(self, to: int):
+        prev = self.active
+        old = self.paths[prev].endpoint
+        new = self.paths[to].endpoint
+        # Frames not on the wire yet follow the traffic
+        frames = old.take_tx_queue()
+        self.active = to
+        self.failovers += 1
+        if frames:
+            new.requeue_tx(frames)
+        if self.on_failover:
+            self.on_failover(prev, to)
+
+    def start(self, period: Optional[float] = None):
+        """Run tick() on a background thread"""
+        period = period or self.interval / 4
+        self._stop.clear()
+
+        def run():
+            while not self._stop.wait(period):
+                self.tick()
+
+        self._thread = threading.Thread(target=run, name='zetta-link', daemon=True)
+        self._thread.start()
+
+    def stop(self):
+        self._stop.set()
+        if self._thread:
+            self._thread.join(timeout=1.0)
+            self._thread = None
+
+    def close(self):
+        self.stop()
+        for path, listener in zip(self.paths, self._rx):
+            path.endpoint.remove_rx_listener(listener)
+
+    def get_stats(self) -> dict:
+        return {
+            'active': self.active,
+            'failovers': self.failovers,
+            'queued': len(self._pending),
+            'dropped': self.dropped,
+            'paths': [p.as_dict() for p in self.paths],
+        }
@@ -0,0 +1,224 @@
+# zetta_metrics.py
+"""
+Prometheus metrics endpoint for Zetta links.
+
+Every counter is written by a single thread (the RX thread of a link or the
+writer thread) or under the link TX lock; a scrape only copies them, so
+serving metrics never blocks or slows the receive path.
+
+    exporter = ZettaMetricsExporter({'sensor': zetta})
+    exporter.serve_http(port=9464)          # http://127.0.0.1:9464/metrics
+    exporter.serve_unix('/run/zetta.sock')  # or a local Unix socket
+"""
+import os
+import socketserver
+import threading
+from bisect import bisect_left
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from typing import Dict, List, Optional, Sequence
+
+# Seconds, from serial latency to slow radio links
+DEFAULT_BUCKETS = (0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+                   0.025, 0.05, 0.1, 0.25, 0.5, 1.0)
+
+class Histogram:
+    """Cumulative-on-read histogram with a single writer"""
+
+    def __init__(self, buckets: Sequence[float] = DEFAULT_BUCKETS):
+        self.buckets = tuple(buckets)
+        self.counts = [0] * (len(self.buckets) + 1)
+        self.sum = 0.0
+        self.count = 0
+
+    def observe(self, value: float):
+        self.counts[bisect_left(self.buckets, value)] += 1
+        self.sum += value
+        self.count += 1
+
+    def snapshot(self):
+        """Returns (cumulative bucket counts, sum, count)"""
+        counts, total, n = list(self.counts), self.sum, self.count
+        cumulative, acc = [], 0
+        for c in counts:
+            acc += c
+            cumulative.append(acc)
+        return cumulative, total, n
+
+    def quantile(self, q: float) -> float:
+        """Upper bound of the bucket containing the q quantile"""
+        cumulative, _, n = self.snapshot()
+        if n == 0:
+            return 0.0
+        target = q * n
+        for bound, acc in zip(self.buckets, cumulative):
+            if acc >= target:
+                return bound
+        return float('inf')
+
+def _escape(value: str) -> str:
+    return str(value).replace('\\', '\\\\').replace('"', '\\"').replace('\n', '\\n')
+
+def _labels(**labels) -> str:
+    return '{' + ','.join(f'{k}="{_escape(v)}"' for k, v in labels.items()) + '}'
+
+def _thread_cpu() -> Dict[str, float]:
+    """CPU seconds per thread name of this process (Linux /proc)"""
+    result: Dict[str, float] = {}
+    task_dir = '/proc/self/task'
+    try:
+        tids = os.listdir(task_dir)
+        hz = os.sysconf('SC_CLK_TCK')
+    except (OSError, ValueError):
+        return result
+    names = {t.native_id: t.name for t in threading.enumerate()}
+    for tid in tids:
+        try:
+            with open(f'{task_dir}/{tid}/stat') as f:
+                stat = f.read()
+        except OSError:
+            continue
+        # comm may contain spaces, fields restart after the closing paren
+        fields = stat[stat.rfind(')') + 2:].split()
+        utime, stime = int(fields[11]), int(fields[12])
+        name = names.get(int(tid), stat[stat.find('(') + 1:stat.rfind(')')])
+        result[f'{name}:{tid}'] = (utime + stime) / hz
+    return result
+
+class ZettaMetricsExporter:
+    """
+    Render and serve metrics for a set of named links.
+
+    Args:
+        links: Mapping of link name to ZettaProtocol instance
+    """
+
+    def __init__(self, links: Optional[Dict[str, object]] = None):
+        self.links: Dict[str, object] = dict(links or {})
+        self._servers: List[socketserver.BaseServer] = []
+
+    def add_link(self, name: str, zetta):
+        links = dict(self.links)
+        links[name] = zetta
+        self.links = links
+
+    def remove_link(self, name: str):
+        links = dict(self.links)
+        links.pop(name, None)
+        self.links = links
+
+    def render(self) -> str:
+        """Build a snapshot in Prometheus text exposition format"""
+        out: List[str] = []
+
+        def family(name: str, mtype: str, help_text: str):
+            out.append(f'# HELP {name} {help_text}')
+            out.append(f'# TYPE {name} {mtype}')
+
+        links = list(self.links.items())
+        stats = {name: z.get_stats() for name, z in links}
+
+        family('zetta_frames_total', 'counter', 'Frames per link and direction')
+        for name, s in stats.items():
+            out.append(f'zetta_frames_total{_labels(link=name, direction="rx")} {s.get("packets_received", 0)}')
+            out.append(f'zetta_frames_total{_labels(link=name, direction="tx")} {s.get("packets_sent", 0)}')
+
+        family('zetta_bytes_total', 'counter', 'Bytes per link and direction')
+        for name, s in stats.items():
+            out.append(f'zetta_bytes_total{_labels(link=name, direction="rx")} {s.get("bytes_received", 0)}')
+            out.append(f'zetta_bytes_total{_labels(link=name, direction="tx")} {s.get("bytes_sent", 0)}')
+
+        family('zetta_errors_total', 'counter', 'Errors per link and error code')
+        for name, s in stats.items():
+            for key, value in sorted(s.items()):
+                if key.endswith('_errors'):
+                    out.append(f'zetta_errors_total{_labels(link=name, code=key[:-7])} {value}')
+
+        family('zetta_profile_frames_total', 'counter', 'Received frames per frame variant')
+        for name, z in links:
+            profile_stats = getattr(z, 'profile_stats', None)
+            if profile_stats is None:
+                continue
+            for profile, s in sorted(profile_stats().items()):
+                out.append(f'zetta_profile_frames_total{_labels(link=name, profile=profile)} {s["frames"]}')
+
+        family('zetta_queue_depth', 'gauge', 'Frames waiting in host queues')
+        for name, z in links:
+            out.append(f'zetta_queue_depth{_labels(link=name, queue="rx")} {z.rx_queue.qsize()}')
+            tx_queue_size = getattr(z, 'tx_queue_size', None)
+            if tx_queue_size is not None:
+                out.append(f'zetta_queue_depth{_labels(link=name, queue="tx")} {tx_queue_size()}')
+
+        for metric, attr, help_text in (
+                ('zetta_rx_latency_seconds', 'rx_latency', 'Time from read to dispatch'),
+                ('zetta_rtt_seconds', 'rtt', 'Measured round trip time')):
+            family(metric, 'histogram', help_text)
+            for name, z in links:
+                hist = getattr(z, attr, None)
+                if hist is None:
+                    continue
+                cumulative, total, n = hist.snapshot()
+                for bound, acc in zip(hist.buckets, cumulative):
+                    out.append(f'{metric}_bucket{_labels(link=name, le=repr(float(bound)))} {acc}')
+                out.append(f'{metric}_bucket{_labels(link=name, le="+Inf")} {n}')
+                out.append(f'{metric}_sum{_labels(link=name)} {total}')
+                out.append(f'{metric}_count{_labels(link=name)} {n}')
+
+        family('zetta_thread_cpu_seconds_total', 'counter', 'CPU time per thread')
+        for thread, seconds in sorted(_thread_cpu().items()):
+            out.append(f'zetta_thread_cpu_seconds_total{_labels(thread=thread)} {seconds}')
+
+        return '\n'.join(out) + '\n'
+
+    def _handler(self):
+        exporter = self
+
+        class Handler(BaseHTTPRequestHandler):
+            def do_GET(self):
+                if self.path.split('?')[0] not in ('/metrics', '/'):
+                    self.send_error(404)
+                    return
+                body = exporter.render().encode()
+                self.send_response(200)
+                self.send_header('Content-Type', 'text/plain; version=0.0.4')
+                self.send_header('Content-Length', str(len(body)))
+                self.end_headers()
+                self.wfile.write(body)
+
+            def log_message(self, format, *args):
+                pass
+
+        return Handler
+
+    def serve_http(self, host: str = '127.0.0.1', port: int = 9464):
+        """Serve /metrics over HTTP on a background thread"""
+        server = ThreadingHTTPServer((host, port), self._handler())
+        return self._serve(server)
+
+    def serve_unix(self, path: str):
+        """Serve /metrics over HTTP on a Unix socket"""
+        if os.path.exists(path):
+            os.unlink(path)
+
+        class UnixHTTPServer(socketserver.ThreadingMixIn, socketserver.UnixStreamServer):
+            daemon_threads = True
+
+            def get_request(self):
+                conn, _ = super().get_request()
+                # BaseHTTPRequestHandler expects an (host, port) address
+                return conn, ('local', 0)
+
+        server = UnixHTTPServer(path, self._handler())
+        return self._serve(server)
+
+    def _serve(self, server):
+        thread = threading.Thread(target=server.serve_forever,
+                                  name='zetta-metrics', daemon=True)
+        thread.start()
+        self._servers.append(server)
+        return server
+
+    def close(self):
+        for server in self._servers:
+            server.shutdown()
+            server.server_close()
+        self._servers.clear()
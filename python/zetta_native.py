@@ -0,0 +1,137 @@
+# zetta_native.py
+"""
+Native receive pipeline.
+
+NativeRxTransport reads and parses a classic frame link in a C thread
+(examples/zetta_host_rx.c, built as a shared library and loaded through
+ctypes). That thread never takes the GIL: it blocks in read(), runs the C
+core's zetta_ParseByte() over the bytes and appends checked frames to a lock
+free single producer / single consumer ring. The receiver thread of
+ZettaProtocol takes ready frames in batches, as TYPE + payload messages, so
+Python never scans a byte and parsing keeps pace while Python code is busy.
+
+Writes stay with FdTransport: they block in the kernel with the GIL released,
+from the caller or from the writer thread (tx_thread=True).
+
+Only what the C core parses with its defaults is supported: classic frames,
+CRC-8, LEN in every frame. Other profiles need the Python decoder.
+
+    gcc -O2 -shared -fPIC -pthread -ICore/inc examples/zetta_host_rx.c \\
+        Core/src/zetta_protocol.c Core/src/zetta_check.c -o libzetta_rx.so
+
+    link = NativeRxTransport('../libzetta_rx.so', os.open('/dev/ttyACM0', os.O_RDWR | os.O_NOCTTY))
+    zetta = ZettaProtocol(transport=link, tx_thread=True)
+"""
+import ctypes
+import os
+import threading
+from typing import Dict, List, Optional
+
+from zetta_transport import FdTransport
+
+MAX_PAYLOAD_SIZE = 25  # MAX_PAYLOAD_SIZE of the C core
+
+class ZrxStats(ctypes.Structure):
+    _fields_ = [('rx_bytes', ctypes.c_uint64)] + [
+        (name, ctypes.c_uint32) for name in
+        ('rx_frames', 'rx_errors', 'crc_errors', 'stalls', 'reads', 'wakeups')]
+
+_libs: Dict[str, ctypes.CDLL] = {}
+
+def load(path: str) -> ctypes.CDLL:
+    """Load libzetta_rx once per path"""
+    path = os.path.abspath(path)
+    lib = _libs.get(path)
+    if lib is None:
+        lib = ctypes.CDLL(path)
+        lib.zrx_stats_size.argtypes = []
+        lib.zrx_stats_size.restype = ctypes.c_int
+        lib.zrx_open.argtypes = [ctypes.c_int, ctypes.c_uint32]
+        lib.zrx_open.restype = ctypes.c_void_p
+        lib.zrx_take.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_uint32, ctypes.c_int]
+        lib.zrx_take.restype = ctypes.c_int32
+        lib.zrx_error.argtypes = [ctypes.c_void_p]
+        lib.zrx_error.restype = ctypes.c_int
+        lib.zrx_get_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(ZrxStats)]
+        lib.zrx_get_stats.restype = None
+        lib.zrx_close.argtypes = [ctypes.c_void_p]
+        lib.zrx_close.restype = None
+        if lib.zrx_stats_size() != ctypes.sizeof(ZrxStats):
+            raise RuntimeError(f"{path}: ZrxStats_t layout does not match")
+        _libs[path] = lib
+    return lib
+
+class NativeRxTransport(FdTransport):
+    """
+    Descriptor whose receive side is read and parsed by a native thread.
+
+    ZettaProtocol sees ``parsed = True`` and takes checked frames with
+    read_messages() instead of bytes with read(). When the ring is full the
+    reader stops reading until Python took frames, so a busy consumer pushes
+    back on the link (parse_stats()['stalls']) instead of losing frames.
+
+    Args:
+        lib: Path of libzetta_rx.so
+        fd: Descriptor used for reading (and writing when write_fd is None)
+        write_fd: Separate descriptor for writing
+        ring: Frames the ring holds between two takes
+        batch: Most frames taken per read_messages() call
+        name: Name for log messages
+        owns: Close the descriptors in close()
+    """
+
+    parsed = True
+    max_payload = MAX_PAYLOAD_SIZE
+
+    def __init__(self, lib: str, fd: int, write_fd: Optional[int] = None,
+                 ring: int = 4096, batch: int = 256, name: Optional[str] = None,
+                 owns: bool = True):
+        super().__init__(fd, write_fd, name=name or f"native fd{fd}", owns=owns)
+        self.lib = load(lib)
+        # Record per frame: size, TYPE, payload
+        self._buf = ctypes.create_string_buffer(batch * (MAX_PAYLOAD_SIZE + 2))
+        # zrx_close must not free the reader under zrx_take or zrx_get_stats
+        self._take_lock = threading.Lock()
+        self._stats_lock = threading.Lock()
+        self._rx = self.lib.zrx_open(fd, ring)
+        if not self._rx:
+            raise OSError(f"{self.name}: zrx_open failed")
+
+    def read_messages(self, timeout: Optional[float] = None) -> List[bytes]:
+        """Wait for parsed frames, then take what is ready (up to batch)"""
+        ms = -1 if timeout is None else int(timeout * 1000)
+        with self._take_lock:
+            if not self._rx:
+                raise ConnectionError(f"{self.name} closed")
+            n = self.lib.zrx_take(self._rx, self._buf, len(self._buf), ms)
+            if n < 0:
+                error = self.lib.zrx_error(self._rx)
+                raise ConnectionError(f"{self.name} closed" if not error
+                                      else f"{self.name}: {os.strerror(error)}")
+            raw = ctypes.string_at(self._buf, n)
+        messages = []
+        pos = 0
+        while pos < n:
+            size = raw[pos]
+            messages.append(raw[pos + 1:pos + 1 + size])
+            pos += 1 + size
+        return messages
+
+    def read(self, timeout: Optional[float] = None) -> bytes:
+        raise NotImplementedError("the native reader owns the receive side, use read_messages")
+
+    def parse_stats(self) -> Dict[str, int]:
+        """Counters of the native reader and parser"""
+        s = ZrxStats()
+        with self._stats_lock:
+            if self._rx:
+                self.lib.zrx_get_stats(self._rx, ctypes.byref(s))
+        return {name: getattr(s, name) for name, _ in ZrxStats._fields_}
+
+    def close(self):
+        self.closed = True
+        with self._take_lock, self._stats_lock:
+            if self._rx:
+                self.lib.zrx_close(self._rx)
+                self._rx = None
+        super().close()
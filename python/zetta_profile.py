@@ -0,0 +1,478 @@
+# zetta_profile.py
+"""
+Frame variants (profiles) and a receiver that detects them on one stream.
+
+Every profile starts with its own START byte, so the receiver selects the
+parser with a single table lookup on the leading byte instead of trying each
+parser in turn. Built-in profiles:
+
+    classic  0xAA | TYPE | LEN      | PAYLOAD 0-25   | CRC-8  | 0xBC
+    wide     0xAB | TYPE | LEN (LE) | PAYLOAD 0-1024 | CRC-16 | 0xBC
+    compact  0xA5 | TYPE:3 LEN:5    | PAYLOAD 0-25   | CRC-8  | 0xBC
+
+The check covers everything between START and the check bytes. Statistics
+are kept per profile. The check of a profile can be chosen from CHECKS, the
+same menu as Core/inc/zetta_check.h:
+
+    FrameProfile('classic', 0xAA, check='fletcher16')
+
+Implicit length (classic header, zetta_set_size_table() in C): types with a
+fixed payload size leave out the LEN byte, the receiver takes it from the
+table. The check still covers TYPE, LEN and PAYLOAD as if LEN was sent.
+
+    0xAA | TYPE | PAYLOAD (sizes[TYPE]) | CRC-8 | 0xBC
+
+Links that deliver whole messages and guarantee their integrity (Unix
+SOCK_SEQPACKET sockets between local processes) use MessageProfile instead:
+a message is TYPE | PAYLOAD, with no START/STOP, LEN or check, decoded by
+MessageDecoder.
+"""
+import zlib
+from dataclasses import dataclass
+from typing import Callable, Dict, Iterable, List, NamedTuple, Optional, Union
+from crc import Calculator, Configuration
+
+STOP_BYTE = 0xBC
+
+# Same configuration as the classic ZettaProtocol CRC
+_crc8 = Calculator(Configuration(
+    width=8,
+    polynomial=0x07,
+    init_value=0xFFFFFFFF,
+    final_xor_value=0x00000000,
+    reverse_input=False,
+    reverse_output=False,
+))
+
+# CRC-16/CCITT-FALSE
+_crc16 = Calculator(Configuration(
+    width=16,
+    polynomial=0x1021,
+    init_value=0xFFFF,
+    final_xor_value=0x0000,
+    reverse_input=False,
+    reverse_output=False,
+))
+
+def crc8(data) -> int:
+    return _crc8.checksum(data) & 0xFF
+
+def crc16(data) -> int:
+    return _crc16.checksum(data) & 0xFFFF
+
+def xor8(data) -> int:
+    x = 0
+    for b in data:
+        x ^= b
+    return x
+
+def _sums(data, modulus: int, s1: int):
+    s2 = 0
+    for b in data:
+        s1 += b
+        s2 += s1
+    return s1 % modulus, s2 % modulus
+
+def fletcher16(data) -> int:
+    s1, s2 = _sums(data, 255, 0)
+    return (s2 << 8) | s1
+
+def adler16(data) -> int:
+    s1, s2 = _sums(data, 251, 1)
+    return (s2 << 8) | s1
+
+def adler32(data) -> int:
+    return zlib.adler32(bytes(data))
+
+def crc32(data) -> int:
+    return zlib.crc32(bytes(data))
+
+# name: (function, bytes on the wire), cheapest first
+CHECKS = {
+    'xor8': (xor8, 1),
+    'fletcher16': (fletcher16, 2),
+    'adler16': (adler16, 2),
+    'crc8': (crc8, 1),
+    'adler32': (adler32, 4),
+    'crc16': (crc16, 2),
+    'crc32': (crc32, 4),
+}
+
+HEADER_CLASSIC = 'classic'  # TYPE, LEN
+HEADER_WIDE = 'wide'        # TYPE, LEN little endian 16 bit
+HEADER_COMPACT = 'compact'  # TYPE (3 bits) and LEN (5 bits) in one byte
+
+_HEADER_SIZE = {HEADER_CLASSIC: 2, HEADER_WIDE: 3, HEADER_COMPACT: 1}
+
+@dataclass
+class ProfileStats:
+    frames: int = 0
+    bytes: int = 0
+    crc_errors: int = 0
+    frame_errors: int = 0
+
+    def as_dict(self) -> dict:
+        return {
+            'frames': self.frames,
+            'bytes': self.bytes,
+            'crc_errors': self.crc_errors,
+            'frame_errors': self.frame_errors,
+        }
+
+class DecodedFrame(NamedTuple):
+    profile: 'FrameProfile'
+    type: int
+    payload: bytes
+    raw: bytes
+
+# decode() results besides a DecodedFrame
+NEED_MORE = None
+INVALID = False
+
+class FrameProfile:
+    """
+    Wire format of one frame variant.
+
+    Args:
+        name: Profile name, used in statistics
+        start: START byte, unique per receiver
+        header: HEADER_CLASSIC, HEADER_WIDE or HEADER_COMPACT
+        check: Name from CHECKS or a function computing the integrity check
+            over header + payload
+        check_size: Bytes of the check on the wire (little endian), implied
+            by a check name
+        max_payload: Largest accepted payload
+        stop: STOP byte
+        sizes: Fixed payload size per TYPE, frames of those types carry no
+            LEN byte (classic header only). The size includes a sequence byte
+            and must not be used for timestamped types.
+    """
+
+    def __init__(self, name: str, start: int, header: str = HEADER_CLASSIC,
+                 check: Union[str, Callable[[bytes], int]] = crc8,
+                 check_size: Optional[int] = None,
+                 max_payload: int = 25, stop: int = STOP_BYTE,
+                 sizes: Optional[Dict[int, int]] = None):
+        if header not in _HEADER_SIZE:
+            raise ValueError(f"Unknown header format {header!r}")
+        if header == HEADER_COMPACT and max_payload > 31:
+            raise ValueError("Compact header carries at most 31 payload bytes")
+        if header != HEADER_WIDE and max_payload > 255:
+            raise ValueError("One byte LEN carries at most 255 payload bytes")
+        if isinstance(check, str):
+            try:
+                check, check_size = CHECKS[check]
+            except KeyError:
+                raise ValueError(f"Unknown check {check!r}") from None
+        elif check_size is None:
+            check_size = 1
+        self.name = name
+        self.start = start
+        self.header = header
+        self.check = check
+        self.check_size = check_size
+        self.max_payload = max_payload
+        self.stop = stop
+        self.header_size = _HEADER_SIZE[header]
+        # START + header + check + STOP
+        self.overhead = 1 + self.header_size + check_size + 1
+        self.stats = ProfileStats()
+        # TYPE -> fixed payload size, None for types that send LEN
+        self.sizes: Optional[List[Optional[int]]] = None
+        self._checked_header: List[bytes] = []  # TYPE, LEN covered by the check
+        if sizes:
+            if header != HEADER_CLASSIC:
+                raise ValueError("Implicit length needs the classic header")
+            self.sizes = [None] * 256
+            self._checked_header = [b''] * 256
+            for packet_type, size in sizes.items():
+                if not 0 <= size <= max_payload:
+                    raise ValueError(f"Fixed size {size} of type {packet_type} "
+                                     f"exceeds {max_payload}")
+                self.sizes[int(packet_type)] = size
+                self._checked_header[int(packet_type)] = bytes((int(packet_type), size))
+
+    def _header(self, buf, pos: int):
+        """Returns (type, payload length) from the header at buf[pos + 1]"""
+        if self.header == HEADER_CLASSIC:
+            return buf[pos + 1], buf[pos + 2]
+        if self.header == HEADER_WIDE:
+            return buf[pos + 1], buf[pos + 2] | (buf[pos + 3] << 8)
+        b = buf[pos + 1]
+        return b >> 5, b & 0x1F
+
+    def decode(self, buf, pos: int = 0):
+        """
+        Decode the frame starting at buf[pos].
+
+        Returns:
+            DecodedFrame, NEED_MORE when the frame is incomplete or INVALID
+            when buf[pos] does not start a valid frame of this profile
+        """
+        avail = len(buf) - pos
+        sizes = self.sizes
+        if sizes is not None and avail > 1 and sizes[buf[pos + 1]] is not None:
+            return self._decode_fixed(buf, pos, avail)
+        if avail < self.overhead:
+            return NEED_MORE
+        ptype, length = self._header(buf, pos)
+        st = self.stats
+        if length > self.max_payload:
+            st.frame_errors += 1
+            return INVALID
+        size = self.overhead + length
+        if avail < size:
+            return NEED_MORE
+        end = pos + size
+        if buf[end - 1] != self.stop:
+            st.frame_errors += 1
+            return INVALID
+        body_end = pos + 1 + self.header_size + length
+        received = int.from_bytes(buf[body_end:body_end + self.check_size], 'little')
+        if self.check(buf[pos + 1:body_end]) != received:
+            st.crc_errors += 1
+            return INVALID
+        st.frames += 1
+        st.bytes += size
+        return DecodedFrame(self, ptype, bytes(buf[pos + 1 + self.header_size:body_end]),
+                            bytes(buf[pos:end]))
+
+    def _decode_fixed(self, buf, pos: int, avail: int):
+        """decode() of a type without LEN byte"""
+        ptype = buf[pos + 1]
+        length = self.sizes[ptype]
+        size = self.overhead - 1 + length
+        if avail < size:
+            return NEED_MORE
+        st = self.stats
+        end = pos + size
+        if buf[end - 1] != self.stop:
+            st.frame_errors += 1
+            return INVALID
+        body_end = pos + 2 + length
+        payload = bytes(buf[pos + 2:body_end])
+        received = int.from_bytes(buf[body_end:body_end + self.check_size], 'little')
+        if self.check(self._checked_header[ptype] + payload) != received:
+            st.crc_errors += 1
+            return INVALID
+        st.frames += 1
+        st.bytes += size
+        return DecodedFrame(self, ptype, payload, bytes(buf[pos:end]))
+
+    def encode(self, packet_type: int, payload: bytes) -> bytes:
+        """Build a frame of this profile"""
+        length = len(payload)
+        if length > self.max_payload:
+            raise ValueError(f"Payload too large for {self.name}: {length} > {self.max_payload}")
+        fixed = self.sizes[packet_type] if self.sizes is not None else None
+        if fixed is not None:
+            if length != fixed:
+                raise ValueError(f"Type {packet_type} carries {fixed} bytes on {self.name}, "
+                                 f"got {length}")
+            check = self.check(self._checked_header[packet_type] + payload)
+            return (bytes((self.start, packet_type)) + payload
+                    + check.to_bytes(self.check_size, 'little') + bytes((self.stop,)))
+        frame = bytearray((self.start,))
+        if self.header == HEADER_CLASSIC:
+            frame += bytes((packet_type, length))
+        elif self.header == HEADER_WIDE:
+            frame += bytes((packet_type, length & 0xFF, length >> 8))
+        else:
+            if packet_type > 7:
+                raise ValueError(f"Compact header carries types 0-7, got {packet_type}")
+            frame.append((packet_type << 5) | length)
+        frame += payload
+        frame += self.check(frame[1:]).to_bytes(self.check_size, 'little')
+        frame.append(self.stop)
+        return bytes(frame)
+
+    def __repr__(self) -> str:
+        return f"<FrameProfile {self.name} start=0x{self.start:02X}>"
+
+def classic_profile(check: str = 'crc8', sizes: Optional[Dict[int, int]] = None) -> FrameProfile:
+    return FrameProfile('classic', 0xAA, check=check, sizes=sizes)
+
+def wide_profile(check: str = 'crc16') -> FrameProfile:
+    return FrameProfile('wide', 0xAB, HEADER_WIDE, check, max_payload=1024)
+
+def compact_profile(check: str = 'crc8') -> FrameProfile:
+    return FrameProfile('compact', 0xA5, HEADER_COMPACT, check)
+
+BUILTIN_PROFILES = {
+    'classic': classic_profile,
+    'wide': wide_profile,
+    'compact': compact_profile,
+}
+
+def make_profile(profile) -> FrameProfile:
+    """Accept a FrameProfile or the name of a built-in profile"""
+    if isinstance(profile, FrameProfile):
+        return profile
+    try:
+        return BUILTIN_PROFILES[profile]()
+    except KeyError:
+        raise ValueError(f"Unknown frame profile {profile!r}") from None
+
+class MessageProfile:
+    """
+    Frame of a trusted message link: TYPE followed by the payload.
+
+    The transport keeps message boundaries and integrity, so there is
+    nothing to hunt for and nothing to check. Same interface as FrameProfile
+    for the sender and the statistics.
+
+    Args:
+        name: Profile name, used in statistics
+        max_payload: Largest accepted payload
+    """
+
+    trusted = True
+    start = None
+    check = None
+    check_size = 0
+    header_size = 1
+    overhead = 1
+
+    def __init__(self, name: str = 'local', max_payload: int = 16384):
+        self.name = name
+        self.max_payload = max_payload
+        self.stats = ProfileStats()
+
+    def decode(self, buf, pos: int = 0):
+        """Decode the message buf[pos:], INVALID when it is empty or too long"""
+        st = self.stats
+        size = len(buf) - pos
+        if size < 1 or size - 1 > self.max_payload:
+            st.frame_errors += 1
+            return INVALID
+        st.frames += 1
+        st.bytes += size
+        raw = bytes(buf[pos:])
+        return DecodedFrame(self, raw[0], raw[1:], raw)
+
+    def encode(self, packet_type: int, payload: bytes) -> bytes:
+        if len(payload) > self.max_payload:
+            raise ValueError(f"Payload too large for {self.name}: "
+                             f"{len(payload)} > {self.max_payload}")
+        return bytes((packet_type,)) + payload
+
+    def __repr__(self) -> str:
+        return f"<MessageProfile {self.name} trusted>"
+
+class MessageDecoder:
+    """
+    Receiver of a message link, same interface as FrameDecoder.
+
+    feed() takes a list of messages as the transport delivered them, one
+    frame per message, so no byte is ever scanned or buffered.
+    """
+
+    skipped = 0
+
+    def __init__(self, profile: Optional[MessageProfile] = None):
+        self.message_profile = profile or MessageProfile()
+        self.profiles: Dict[str, MessageProfile] = {self.message_profile.name: self.message_profile}
+
+    def add_profile(self, profile) -> MessageProfile:
+        if profile is not self.message_profile:
+            raise ValueError("Message links carry a single trusted profile")
+        return profile
+
+    def profile(self, name: str) -> MessageProfile:
+        return self.profiles[name]
+
+    def feed(self, messages) -> List[DecodedFrame]:
+        decode = self.message_profile.decode
+        frames = []
+        for message in messages:
+            frame = decode(message)
+            if frame:
+                frames.append(frame)
+        return frames
+
+    def decode(self, raw: bytes):
+        return self.message_profile.decode(raw) or None
+
+    def reset(self):
+        pass
+
+    def get_stats(self) -> Dict[str, dict]:
+        return {name: p.stats.as_dict() for name, p in self.profiles.items()}
+
+class FrameDecoder:
+    """
+    Incremental multi-profile receiver.
+
+    Bytes that do not start a frame of any profile are skipped. After an
+    invalid frame the decoder resynchronises on the next byte, so a frame
+    hidden behind a corrupted one is not lost.
+
+    Note that a corrupted header announcing a long payload holds back the
+    frames behind it until that many bytes arrived; enable only the profiles
+    a link actually uses.
+
+    Args:
+        profiles: FrameProfile objects or built-in profile names
+    """
+
+    def __init__(self, profiles: Iterable = ('classic',)):
+        self.profiles: Dict[str, FrameProfile] = {}
+        self._table: List[Optional[FrameProfile]] = [None] * 256
+        self.buffer = bytearray()
+        self.skipped = 0
+        for p in profiles:
+            self.add_profile(p)
+
+    def add_profile(self, profile) -> FrameProfile:
+        profile = make_profile(profile)
+        other = self._table[profile.start]
+        if other is not None and other is not profile:
+            raise ValueError(f"START byte 0x{profile.start:02X} already used by {other.name}")
+        self._table[profile.start] = profile
+        self.profiles[profile.name] = profile
+        return profile
+
+    def profile(self, name: str) -> FrameProfile:
+        return self.profiles[name]
+
+    def feed(self, data) -> List[DecodedFrame]:
+        """Append received bytes, returns the frames completed by them"""
+        buf = self.buffer
+        buf += data
+        table = self._table
+        frames = []
+        pos, n = 0, len(buf)
+        while pos < n:
+            profile = table[buf[pos]]
+            if profile is None:
+                pos += 1
+                self.skipped += 1
+                continue
+            frame = profile.decode(buf, pos)
+            if frame is NEED_MORE:
+                break
+            if frame is INVALID:
+                pos += 1
+                continue
+            frames.append(frame)
+            pos += len(frame.raw)
+        if pos:
+            del buf[:pos]
+        return frames
+
+    def decode(self, raw: bytes):
+        """Decode one complete frame, DecodedFrame or None"""
+        profile = self._table[raw[0]] if raw else None
+        if profile is None:
+            return None
+        frame = profile.decode(raw)
+        if not frame or len(frame.raw) != len(raw):
+            return None
+        return frame
+
+    def reset(self):
+        self.buffer.clear()
+
+    def get_stats(self) -> Dict[str, dict]:
+        """Statistics per profile"""
+        return {name: p.stats.as_dict() for name, p in self.profiles.items()}
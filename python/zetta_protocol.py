@@ -1,13 +1,19 @@
 # zetta_protocol.py
-import serial
 import time
 import struct
 import threading
+from collections import deque
 from queue import Queue
-from typing import Optional, Callable, Any, Union
+from typing import Optional, Callable, Any, Union, Dict, List
 from dataclasses import dataclass
 from enum import IntEnum
 from crc import Calculator, Configuration
+from zetta_trace import now_ns
+from zetta_metrics import Histogram
+from zetta_seq import SequenceChannel
+from zetta_time import DeviceTime
+from zetta_profile import FrameDecoder, MessageDecoder, MessageProfile
+from zetta_transport import SerialTransport
 
 # CRC Configuration
 _crc_config = Configuration(
@@ -24,14 +30,76 @@ class ZettaPacketType(IntEnum):
     MSG_ACK = 0
     MSG_PUBLISH = 1
     MSG_SUBSCRIBE = 2
+    MSG_FILTER = 3
+    MSG_CAPTURE = 4
+    MSG_LINK = 5
+    MSG_BULK = 6
+    MSG_ROUTE = 7
+    MSG_FEC = 8
+
+class ZettaRawType(int):
+    """Packet type that is not a ZettaPacketType member.
+
+    Behaves like an int and exposes ``name``/``value`` like an enum member, so
+    code written against ZettaPacketType keeps working for new types.
+    """
+    __slots__ = ()
+
+    @property
+    def name(self) -> str:
+        return _type_names.get(int(self), f"TYPE_{int(self)}")
+
+    @property
+    def value(self) -> int:
+        return int(self)
+
+    def __repr__(self) -> str:
+        return f"<ZettaRawType.{self.name}: {int(self)}>"
+
+PacketType = Union[ZettaPacketType, ZettaRawType]
+
+# Type registry: one entry per possible TYPE byte, so decoding is a list index
+_type_names: Dict[int, str] = {}
+_type_table = [ZettaRawType(v) for v in range(256)]
+for _member in ZettaPacketType:
+    _type_table[_member.value] = _member
+
+def register_packet_type(value: int, name: str) -> PacketType:
+    """
+    Register a name for a packet type that is not part of ZettaPacketType.
+
+    Unregistered types still decode (as ZettaRawType), registering only
+    gives them a readable name.
+
+    Args:
+        value: TYPE byte (0-255)
+        name: Human readable name
+
+    Returns:
+        The type object used for received packets of this type
+    """
+    if not 0 <= value <= 0xFF:
+        raise ValueError(f"Packet type out of range: {value}")
+    if isinstance(_type_table[value], ZettaPacketType):
+        return _type_table[value]
+    _type_names[value] = name
+    return _type_table[value]
+
+def lookup_packet_type(value: int) -> PacketType:
+    """Decode a TYPE byte into a ZettaPacketType or ZettaRawType"""
+    return _type_table[value & 0xFF]
 
 @dataclass
 class ZettaPacket:
     """Container for parsed Zetta packet"""
-    type: ZettaPacketType
+    type: PacketType
     data: bytes
     timestamp: float
     raw_packet: bytes  # Original packet bytes for debugging
+    seq: Optional[int] = None  # Sequence number of sequenced types
+    ticks: Optional[int] = None  # Device timestamp of stamped types
+    device_time: Optional[float] = None  # ticks mapped to the time.time() clock
+    profile: str = 'classic'  # Frame variant the packet arrived in
 
 class ZettaProtocol:
     """
@@ -51,7 +119,12 @@ class ZettaProtocol:
                  baudrate: int = 115200, 
                  timeout: float = 0.1,
                  rx_callback: Optional[Callable[[ZettaPacket], None]] = None,
-                 error_callback: Optional[Callable[[str], None]] = None):
+                 error_callback: Optional[Callable[[str], None]] = None,
+                 tracer=None,
+                 profiles=('classic',),
+                 tx_profile='classic',
+                 transport=None,
+                 tx_thread: bool = False):
         """
         Initialize Zetta Protocol instance.
         
@@ -61,15 +134,46 @@ class ZettaProtocol:
             timeout: Serial read timeout in seconds
             rx_callback: Optional callback function for received packets
             error_callback: Optional callback function for errors
+            tracer: Optional ZettaTracer recording host activity
+            profiles: Frame variants accepted on this link (see zetta_profile),
+                ignored on message transports
+            tx_profile: Frame variant used by send_raw, ignored on message
+                transports
+            transport: Byte transport to use instead of opening the serial port
+                (see zetta_transport)
+            tx_thread: Queue frames in send_raw and write them from a writer
+                thread, coalescing frames queued together into one write
         """
-        self.ser = serial.Serial(port, baudrate, timeout=timeout)
+        if transport is None:
+            transport = SerialTransport(port, baudrate, timeout)
+        self.transport = transport
+        self.ser = getattr(transport, 'ser', None)
+        self.timeout = timeout
         self.calculator = Calculator(_crc_config)
         self.rx_queue = Queue()
         self.rx_callback = rx_callback
         self.error_callback = error_callback
         self.stop_threads = False
         self._rx_thread = None
+        # Serialises TX only, reads never take it
         self._lock = threading.Lock()
+        self._tx_thread = None
+        self._tx_pending = deque() if tx_thread else None
+        self._tx_wake = threading.Event()
+        self._tx_busy = False
+        self.tracer = tracer
+        if getattr(transport, 'messages', False):
+            # The transport keeps boundaries and integrity: TYPE + payload only
+            self.decoder = MessageDecoder(MessageProfile(max_payload=transport.max_payload))
+            self.tx_profile = self.decoder.message_profile
+        else:
+            # Frame variants, detected by their START byte
+            self.decoder = FrameDecoder(profiles)
+            self.tx_profile = self.decoder.add_profile(
+                self.decoder.profiles.get(tx_profile, tx_profile))
+            if getattr(transport, 'parsed', False):
+                # Parsed and checked natively (see zetta_native): TYPE + payload
+                self.decoder = MessageDecoder(MessageProfile('native', transport.max_payload))
         
         # Statistics
         self.stats = {
@@ -78,29 +182,49 @@ class ZettaProtocol:
             'crc_errors': 0,
             'frame_errors': 0,
             'bytes_received': 0,
+            'bytes_sent': 0,
+            'tx_errors': 0,
         }
+        # Host side latency (read to dispatch) and round trip times
+        self.rx_latency = Histogram()
+        self.rtt = Histogram()
         
-        # User-defined packet handlers
+        # User-defined packet handlers, replaced on change
         self._packet_handlers = {}
+        # Extra receivers (brokers, capture clients, ...), replaced on change
+        self._rx_listeners = ()
+        # Types delivered in batches instead of per packet, replaced on change
+        self._batch_handlers: Dict[int, Callable[[PacketType, List[bytes]], None]] = {}
+        # Sequenced packet types
+        self._seq: Dict[int, SequenceChannel] = {}
+        # Timestamped packet types, created by enable_timestamp
+        self._time: Optional[DeviceTime] = None
         
     def start(self):
-        """Start the receiver thread"""
+        """Start the receiver (and writer) thread"""
         if self._rx_thread is None or not self._rx_thread.is_alive():
             self.stop_threads = False
-            self._rx_thread = threading.Thread(target=self._receiver_thread, daemon=True)
+            self._rx_thread = threading.Thread(target=self._receiver_thread,
+                                               name='zetta-rx', daemon=True)
             self._rx_thread.start()
-            print(f"Zetta Protocol started on {self.ser.port}")
+            if self._tx_pending is not None:
+                self._tx_thread = threading.Thread(target=self._writer_thread,
+                                                   name='zetta-tx', daemon=True)
+                self._tx_thread.start()
+            print(f"Zetta Protocol started on {self.transport.name}")
     
     def stop(self):
         """Stop the receiver thread and cleanup"""
         self.stop_threads = True
-        if self._rx_thread:
-            self._rx_thread.join(timeout=1.0)
-        self.ser.close()
+        self._tx_wake.set()
+        for thread in (self._rx_thread, self._tx_thread):
+            if thread:
+                thread.join(timeout=1.0)
+        self.transport.close()
         print("Zetta Protocol stopped")
     
     def register_packet_handler(self, 
-                               packet_type: ZettaPacketType, 
+                               packet_type: PacketType, 
                                parser: Callable[[bytes], Any],
                                builder: Optional[Callable[[Any], bytes]] = None):
         """
@@ -111,37 +235,142 @@ class ZettaProtocol:
             parser: Function to parse payload bytes into user data
             builder: Optional function to convert user data to payload bytes
         """
-        self._packet_handlers[packet_type] = {
+        handlers = dict(self._packet_handlers)
+        handlers[packet_type] = {
             'parser': parser,
             'builder': builder
         }
+        self._packet_handlers = handlers
+
+    def unregister_packet_handler(self, packet_type: PacketType):
+        """Remove the handler of a packet type, its packets stay raw"""
+        handlers = dict(self._packet_handlers)
+        handlers.pop(packet_type, None)
+        self._packet_handlers = handlers
     
-    def send_raw(self, packet_type: ZettaPacketType, payload: bytes) -> bool:
+    def add_rx_listener(self, listener: Callable[[ZettaPacket], None]):
+        """
+        Register an additional callback for every received packet.
+
+        Listeners run on the receiver thread after rx_callback.
+        """
+        self._rx_listeners = self._rx_listeners + (listener,)
+
+    def remove_rx_listener(self, listener: Callable[[ZettaPacket], None]):
+        """Remove a callback added with add_rx_listener"""
+        self._rx_listeners = tuple(l for l in self._rx_listeners if l != listener)
+
+    def register_batch_handler(self, packet_type: PacketType,
+                               on_batch: Optional[Callable[[PacketType, List[bytes]], None]]):
+        """
+        Deliver frames of a type in batches instead of one packet at a time.
+
+        Consecutive frames of the type received together are passed as one
+        list of payloads, ``on_batch(packet_type, payloads)``, on the receiver
+        thread. Batched frames bypass rx_queue, rx_callback and rx listeners.
+
+        Args:
+            packet_type: Packet type to batch
+            on_batch: Batch handler, None to restore per packet delivery
+        """
+        handlers = dict(self._batch_handlers)
+        if on_batch is None:
+            handlers.pop(int(packet_type), None)
+        else:
+            handlers[int(packet_type)] = on_batch
+        self._batch_handlers = handlers
+
+    def enable_sequence(self, packet_type: PacketType):
+        """
+        Send and expect a sequence byte in front of the payload of a type.
+
+        Must match the types enabled with zetta_seq_enable on the device.
+        """
+        self._seq.setdefault(int(packet_type), SequenceChannel())
+
+    def sequence_stats(self, packet_type: PacketType) -> Optional[dict]:
+        """Loss statistics of a sequenced type"""
+        channel = self._seq.get(int(packet_type))
+        return channel.stats.as_dict() if channel else None
+
+    def enable_timestamp(self, packet_type: PacketType, tick: float = 1e-6):
+        """
+        Send and expect a device timestamp in front of the payload of a type.
+
+        Must match the types enabled with zetta_time_enable on the device.
+        Received packets get `ticks` and `device_time`. Batch handlers get
+        the payloads without the timestamps.
+
+        Args:
+            packet_type: Type to stamp
+            tick: Seconds per device clock tick, the same for all types
+        """
+        if self._time is None:
+            self._time = DeviceTime(tick)
+        elif self._time.tick != tick:
+            raise ValueError(f"tick already set to {self._time.tick}")
+        self._time.enable(int(packet_type))
+
+    def timestamp_stats(self) -> Optional[dict]:
+        """Field sizes sent, frames decoded and clock skew of the device"""
+        return self._time.get_stats() if self._time else None
+
+    def send_raw(self, packet_type: PacketType, payload: bytes,
+                 acquired: Optional[float] = None) -> bool:
         """
         Send raw bytes as a Zetta packet.
         
         Args:
             packet_type: Type of packet to send
-            payload: Raw payload bytes (max 25 bytes)
+            payload: Raw payload bytes (max 25 bytes with the classic profile)
+            acquired: time.monotonic() of the sample for stamped types, the
+                send time by default
             
         Returns:
-            True if packet was sent successfully
+            True if packet was sent successfully (queued with tx_thread)
         """
-        if len(payload) > self.MAX_PAYLOAD_SIZE:
-            self._handle_error(f"Payload too large: {len(payload)} > {self.MAX_PAYLOAD_SIZE}")
+        channel = self._seq.get(int(packet_type))
+        stamper = self._time if self._time and int(packet_type) in self._time.types else None
+        max_size = self.tx_profile.max_payload - (1 if channel else 0)
+        if len(payload) > max_size:
+            self._handle_error(f"Payload too large: {len(payload)} > {max_size}")
             return False
         
         try:
-            packet = self._create_packet(packet_type, payload)
+            tracer = self.tracer
+            start = now_ns() if tracer else 0
             with self._lock:
-                self.ser.write(packet)
+                # The size checks come before the sequence number and the
+                # timestamp encoder advance, a rejected frame takes neither
+                ticks, field = stamper.field(acquired) if stamper else (0, b'')
+                if len(field) + len(payload) > max_size:
+                    self._handle_error(f"Payload too large with timestamp: {len(payload)}")
+                    return False
+                header = bytes([channel.next_tx()]) if channel else b''
+                header += field
+                packet = self._create_packet(packet_type, header + payload if header else payload)
+                if self._tx_pending is not None:
+                    # Written by the writer thread, in sequence order
+                    self._tx_pending.append(packet)
+                    self._tx_wake.set()
+                    if stamper:
+                        stamper.commit(ticks, field)
+                    return True
+                self.transport.write(packet)
+                if stamper:
+                    stamper.commit(ticks, field)
                 self.stats['packets_sent'] += 1
+                self.stats['bytes_sent'] += len(packet)
+            if tracer:
+                tracer.complete('tx_write', start, {'bytes': len(packet)})
             return True
         except Exception as e:
+            with self._lock:
+                self.stats['tx_errors'] += 1
             self._handle_error(f"Send failed: {e}")
             return False
     
-    def send(self, packet_type: ZettaPacketType, data: Any) -> bool:
+    def send(self, packet_type: PacketType, data: Any) -> bool:
         """
         Send structured data using registered packet builder.
         
@@ -152,11 +381,11 @@ class ZettaProtocol:
         Returns:
             True if packet was sent successfully
         """
-        if packet_type not in self._packet_handlers:
+        handler = self._packet_handlers.get(packet_type)
+        if handler is None:
             self._handle_error(f"No builder registered for packet type {packet_type}")
             return False
         
-        handler = self._packet_handlers[packet_type]
         if not handler['builder']:
             self._handle_error(f"No builder function for packet type {packet_type}")
             return False
@@ -193,13 +422,17 @@ class ZettaProtocol:
         Returns:
             Parsed data if parser exists, raw payload otherwise
         """
-        if packet.type in self._packet_handlers:
-            handler = self._packet_handlers[packet.type]
-            if handler['parser']:
-                try:
-                    return handler['parser'](packet.data)
-                except Exception as e:
-                    self._handle_error(f"Failed to parse packet: {e}")
+        handler = self._packet_handlers.get(packet.type)
+        if handler is not None and handler['parser']:
+            tracer = self.tracer
+            start = now_ns() if tracer else 0
+            try:
+                return handler['parser'](packet.data)
+            except Exception as e:
+                self._handle_error(f"Failed to parse packet: {e}")
+            finally:
+                if tracer:
+                    tracer.complete('handler', start, {'type': packet.type.name})
         
         # Return raw data if no parser registered
         return packet.data
@@ -215,115 +448,280 @@ class ZettaProtocol:
     
     def get_stats(self) -> dict:
         """Get communication statistics"""
-        return self.stats.copy()
+        stats = self.stats.copy()
+        for profile in self.decoder.profiles.values():
+            stats['crc_errors'] += profile.stats.crc_errors
+            stats['frame_errors'] += profile.stats.frame_errors
+        parse_stats = getattr(self.transport, 'parse_stats', None)
+        if parse_stats is not None:
+            native = parse_stats()
+            stats['crc_errors'] += native['crc_errors']
+            stats['frame_errors'] += native['rx_errors'] - native['crc_errors']
+        stats['unsynced_bytes'] = self.decoder.skipped
+        return stats
+
+    def profile_stats(self) -> Dict[str, dict]:
+        """Frames, bytes and errors per frame variant"""
+        return self.decoder.get_stats()
+
+    def record_rtt(self, seconds: float):
+        """Record a measured request/response round trip time"""
+        self.rtt.observe(seconds)
     
     # Internal methods
-    def _create_packet(self, packet_type: ZettaPacketType, payload: bytes) -> bytes:
-        """Create a Zetta protocol packet"""
-        packet = bytearray()
-        packet.append(self.START_BYTE)
-        packet.append(packet_type.value)
-        packet.append(len(payload))
-        packet.extend(payload)
-        
-        # Calculate CRC (type + len + payload)
-        crc_data = packet[1:]  # Everything after START byte
-        checksum = self.calculator.checksum(crc_data) & 0xFF
-        packet.append(checksum)
-        packet.append(self.STOP_BYTE)
-        
-        return bytes(packet)
+    def _create_packet(self, packet_type: PacketType, payload: bytes) -> bytes:
+        """Create a Zetta protocol packet in the TX profile"""
+        return self.tx_profile.encode(int(packet_type), payload)
     
     def _parse_packet(self, raw_packet: bytes) -> Optional[ZettaPacket]:
         """Parse a raw packet and validate"""
-        if len(raw_packet) < 6:
-            return None
-        
-        if raw_packet[0] != self.START_BYTE or raw_packet[-1] != self.STOP_BYTE:
-            return None
-        
-        pkt_type_value = raw_packet[1]
-        length = raw_packet[2]
-        
-        if len(raw_packet) != 5 + length:
-            self.stats['frame_errors'] += 1
+        frame = self.decoder.decode(raw_packet)
+        if frame is None:
             return None
-        
-        payload = raw_packet[3:3+length]
-        crc_received = raw_packet[-2]
-        
-        # Calculate CRC (type + len + payload)
-        crc_calculated = self.calculator.checksum(raw_packet[1:3+length]) & 0xFF
-        
-        if crc_received != crc_calculated:
-            self.stats['crc_errors'] += 1
-            return None
-        
-        try:
-            packet_type = ZettaPacketType(pkt_type_value)
-        except ValueError:
-            packet_type = ZettaPacketType(pkt_type_value)  # Unknown type
+        return self._make_packet(frame)
+
+    def _make_packet(self, frame) -> ZettaPacket:
+        """Build a ZettaPacket from a decoded frame"""
+        payload = frame.payload
+        seq = None
+        channel = self._seq.get(frame.type)
+        if channel and payload:
+            seq = payload[0]
+            payload = payload[1:]
+            channel.track(seq)
+        arrival = time.time()
+        ticks = device_time = None
+        stamper = self._time
+        if stamper and frame.type in stamper.types:
+            ticks, device_time, size = stamper.decode(payload, arrival)
+            payload = payload[size:]
         
         return ZettaPacket(
-            type=packet_type,
+            type=_type_table[frame.type],
             data=payload,
-            timestamp=time.time(),
-            raw_packet=raw_packet
+            timestamp=arrival,
+            raw_packet=frame.raw,
+            seq=seq,
+            ticks=ticks,
+            device_time=device_time,
+            profile=frame.profile.name
         )
     
+    def _dispatch_frames(self, frames, tracer, read_time: float):
+        """Hand decoded frames to batch handlers, rx_queue and callbacks"""
+        batch_handlers = self._batch_handlers
+        batch_type, batch = None, []
+        for frame in frames:
+            if batch_handlers and frame.type in batch_handlers:
+                # Consecutive frames of one type are delivered together
+                if frame.type != batch_type:
+                    self._flush_batch(batch_type, batch, tracer)
+                    batch_type, batch = frame.type, []
+                payload = frame.payload
+                channel = self._seq.get(frame.type)
+                if channel and payload:
+                    channel.track(payload[0])
+                    payload = payload[1:]
+                stamper = self._time
+                if stamper and frame.type in stamper.types:
+                    try:
+                        payload = payload[stamper.decode(payload, time.time())[2]:]
+                    except ValueError as e:
+                        self.stats['frame_errors'] += 1
+                        self._handle_error(f"Parse error: {e}")
+                        continue
+                batch.append(payload)
+                continue
+            if batch:
+                self._flush_batch(batch_type, batch, tracer)
+                batch_type, batch = None, []
+
+            # Parse and validate packet
+            try:
+                packet = self._make_packet(frame)
+            except Exception as e:
+                self.stats['frame_errors'] += 1
+                self._handle_error(f"Parse error: {e}")
+                continue
+            self.stats['packets_received'] += 1
+            self.rx_queue.put(packet)
+            self.rx_latency.observe(time.perf_counter() - read_time)
+            if tracer:
+                tracer.counter('rx_queue', self.rx_queue.qsize())
+                tracer.instant('dispatch', {'type': packet.type.name})
+            
+            # Call user callback if registered
+            if self.rx_callback:
+                cb_start = now_ns() if tracer else 0
+                try:
+                    self.rx_callback(packet)
+                except Exception as e:
+                    self._handle_error(f"RX callback error: {e}")
+                if tracer:
+                    tracer.complete('rx_callback', cb_start)
+            for listener in self._rx_listeners:
+                try:
+                    listener(packet)
+                except Exception as e:
+                    self._handle_error(f"RX listener error: {e}")
+        if batch:
+            self._flush_batch(batch_type, batch, tracer)
+
+    def _flush_batch(self, packet_type: int, payloads: List[bytes], tracer):
+        if not payloads:
+            return
+        self.stats['packets_received'] += len(payloads)
+        start = now_ns() if tracer else 0
+        try:
+            self._batch_handlers[packet_type](_type_table[packet_type], payloads)
+        except Exception as e:
+            self._handle_error(f"Batch handler error: {e}")
+        if tracer:
+            tracer.complete('batch', start, {'type': _type_table[packet_type].name,
+                                             'frames': len(payloads)})
+    
     def _receiver_thread(self):
         """Thread for continuous packet reception"""
-        buffer = bytearray()
+        decoder = self.decoder
+        transport = self.transport
+        # Message and native transports hand over whole frames, a list per read
+        messages = getattr(transport, 'messages', False) or getattr(transport, 'parsed', False)
+        read = transport.read_messages if messages else transport.read
         
         while not self.stop_threads:
             try:
-                # Read available bytes
-                if self.ser.in_waiting > 0:
-                    with self._lock:
-                        data = self.ser.read(self.ser.in_waiting)
-                    self.stats['bytes_received'] += len(data)
-                    buffer.extend(data)
+                # Blocks in the transport (GIL released) until bytes arrive
+                data = read(self.timeout)
+                if not data:
+                    continue
+                read_time = time.perf_counter()
+                tracer = self.tracer
+                start = now_ns() if tracer else 0
+                size = sum(map(len, data)) if messages else len(data)
+                self.stats['bytes_received'] += size
+                if tracer:
+                    tracer.instant('read', {'bytes': size})
+                # Split into frames, the leading byte selects the profile
+                frames = decoder.feed(data)
                 
-                # Process complete packets in buffer
-                while len(buffer) >= 6:  # Minimum packet size
-                    # Find START byte
-                    if buffer[0] != self.START_BYTE:
-                        buffer.pop(0)
-                        continue
-                    
-                    # Check if we have enough data for minimal packet
-                    if len(buffer) < 5:  # start + type + len + crc + stop
-                        break
-                    
-                    length = buffer[2]
-                    expected_size = 5 + length
-                    
-                    if len(buffer) >= expected_size:
-                        # Extract complete packet
-                        raw_packet = bytes(buffer[:expected_size])
-                        buffer = buffer[expected_size:]
-                        
-                        # Parse and validate packet
-                        packet = self._parse_packet(raw_packet)
-                        if packet:
-                            self.stats['packets_received'] += 1
-                            self.rx_queue.put(packet)
-                            
-                            # Call user callback if registered
-                            if self.rx_callback:
-                                try:
-                                    self.rx_callback(packet)
-                                except Exception as e:
-                                    self._handle_error(f"RX callback error: {e}")
-                    else:
-                        # Not enough data for complete packet
-                        break
+                self._dispatch_frames(frames, tracer, read_time)
                 
-                time.sleep(0.001)  # Prevent CPU hogging
+                if tracer:
+                    tracer.complete('parse', start, {'bytes': size, 'frames': len(frames)})
                 
+            except ConnectionError as e:
+                self._handle_error(f"Receiver stopped: {e}")
+                break
             except Exception as e:
+                # Parse errors are handled per frame, this is the transport
+                # failing (e.g. SerialException): back off, do not spin
                 self._handle_error(f"Receiver thread error: {e}")
                 time.sleep(0.1)
+
+    def _writer_thread(self):
+        """Write queued frames, everything queued together goes in one write"""
+        pending = self._tx_pending
+        wake = self._tx_wake
+        transport = self.transport
+        # Transports that take a list of frames get larger batches, unjoined
+        write_frames = getattr(transport, 'write_frames', None)
+        limit = 1 << 16 if write_frames else 4096
+        cork = getattr(transport, 'cork', None)
+        
+        while True:
+            wake.wait(self.timeout)
+            wake.clear()
+            corked = False
+            writes = 0
+            while pending:
+                self._tx_busy = True
+                chunk = []
+                size = 0
+                while pending and size < limit:
+                    frame = pending.popleft()
+                    chunk.append(frame)
+                    size += len(frame)
+                # More than one write: let the kernel fill whole segments
+                if (pending or writes) and cork and not corked:
+                    cork()
+                    corked = True
+                writes += 1
+                tracer = self.tracer
+                start = now_ns() if tracer else 0
+                try:
+                    if write_frames:
+                        write_frames(chunk)
+                    else:
+                        transport.write(b''.join(chunk))
+                    self.stats['packets_sent'] += len(chunk)
+                    self.stats['bytes_sent'] += size
+                except Exception as e:
+                    # Senders count their own errors under the lock too
+                    with self._lock:
+                        self.stats['tx_errors'] += len(chunk)
+                    self._handle_error(f"Send failed: {e}")
+                self._tx_busy = False
+                if tracer:
+                    tracer.complete('tx_write', start, {'bytes': size, 'frames': len(chunk)})
+            if corked:
+                try:
+                    transport.uncork()
+                except OSError as e:
+                    self._handle_error(f"Uncork failed: {e}")
+            if self.stop_threads:
+                break
+
+    def take_tx_queue(self) -> List[bytes]:
+        """Remove and return encoded frames that were not written yet"""
+        frames = []
+        with self._lock:
+            if self._tx_pending is not None:
+                while self._tx_pending:
+                    frames.append(self._tx_pending.popleft())
+            take_pending = getattr(self.transport, 'take_pending', None)
+            if take_pending is not None:
+                frames = take_pending() + frames
+        return frames
+
+    def requeue_tx(self, frames: List[bytes]):
+        """Send frames taken from another link with take_tx_queue"""
+        for frame in frames:
+            try:
+                with self._lock:
+                    if self._tx_pending is not None:
+                        self._tx_pending.append(frame)
+                        self._tx_wake.set()
+                        continue
+                    self.transport.write(frame)
+                    self.stats['packets_sent'] += 1
+                    self.stats['bytes_sent'] += len(frame)
+            except Exception as e:
+                with self._lock:
+                    self.stats['tx_errors'] += 1
+                self._handle_error(f"Send failed: {e}")
+
+    def tx_queue_size(self) -> int:
+        """Frames waiting for the writer thread"""
+        return len(self._tx_pending) if self._tx_pending is not None else 0
+
+    def tx_backlog(self) -> int:
+        """Bytes queued for sending (writer thread and transport buffers)"""
+        backlog = 0
+        if self._tx_pending:
+            backlog += sum(len(f) for f in list(self._tx_pending))
+        out_waiting = getattr(self.transport, 'out_waiting', None)
+        if out_waiting is not None:
+            backlog += out_waiting()
+        return backlog
+
+    def flush_tx(self, timeout: float = 1.0) -> bool:
+        """Wait until the writer thread wrote every queued frame"""
+        deadline = time.monotonic() + timeout
+        while self._tx_pending or self._tx_busy:
+            if time.monotonic() > deadline:
+                return False
+            time.sleep(0.0005)
+        return True
     
     def _handle_error(self, message: str):
         """Handle error messages"""
@@ -347,6 +745,15 @@ def create_struct_builder(format_str: str):
         return struct.pack(format_str, *data)
     return builder
 
+def create_struct_batch_parser(format_str: str):
+    """Create a batch parser unpacking a list of fixed size payloads at once"""
+    unpacker = struct.Struct(format_str)
+    def parser(payloads):
+        if all(len(p) == unpacker.size for p in payloads):
+            return list(unpacker.iter_unpack(b''.join(payloads)))
+        return [unpacker.unpack(p) for p in payloads]
+    return parser
+
 def create_string_parser(encoding: str = 'utf-8'):
     """Create a parser for string data"""
     def parser(payload: bytes):
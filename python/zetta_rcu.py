@@ -0,0 +1,124 @@
+# zetta_rcu.py
+"""
+Read-copy-update for configuration read on every frame.
+
+Tables the hot path consults (relay links, routes, dispatch tables) are
+published as immutable snapshots: a writer builds a new snapshot and
+publishes it with one attribute assignment, readers load the current one
+with one attribute read and never take a lock. Old snapshots themselves are
+freed by reference counting once the last reader drops them.
+
+What a snapshot hands out beyond memory (descriptors, pipes, close
+callbacks) must not be released while a reader still works with the old
+snapshot. Writers pass that cleanup to EpochDomain.retire(); it runs once
+every reader that entered before the retirement has left its read-side
+section.
+
+    reader = domain.reader()          # one per reading thread
+    with reader:                      # or enter() / leave()
+        config = owner.config         # the only shared load
+        ...
+
+    owner.config = new_config         # writer, under its own lock
+    domain.retire(lambda: close(removed))
+
+Epochs: retire() bumps the domain epoch E and queues the callback with E.
+A reader records the epoch at enter(), before it loads any snapshot, so a
+reader that recorded E or later already sees the new snapshot. The callback
+runs when no reader inside a section recorded less than E. Readers outside a
+section hold nothing back, so an idle thread never delays reclamation.
+"""
+import threading
+import time
+from collections import deque
+from typing import Callable, Optional
+
+class Reader:
+    """Read-side section state of one thread"""
+
+    __slots__ = ('domain', 'epoch')
+
+    def __init__(self, domain: 'EpochDomain'):
+        self.domain = domain
+        self.epoch = None  # epoch at enter(), None outside a section
+
+    def enter(self):
+        self.epoch = self.domain.epoch
+
+    def leave(self):
+        self.epoch = None
+        if self.domain._pending:
+            self.domain.reclaim()
+
+    def __enter__(self):
+        self.enter()
+        return self
+
+    def __exit__(self, *exc):
+        self.leave()
+
+class EpochDomain:
+    """Readers and deferred cleanup of one set of snapshots"""
+
+    def __init__(self):
+        self.epoch = 0
+        self._readers = ()  # replaced on change
+        self._pending = deque()  # (epoch, callback)
+        self._lock = threading.Lock()
+        self.stats = {'retired': 0, 'reclaimed': 0}
+
+    def reader(self) -> Reader:
+        reader = Reader(self)
+        with self._lock:
+            self._readers = self._readers + (reader,)
+        return reader
+
+    def remove_reader(self, reader: Reader):
+        with self._lock:
+            self._readers = tuple(r for r in self._readers if r is not reader)
+        self.reclaim()
+
+    def retire(self, callback: Callable[[], None]):
+        """Run callback once no reader can still use the replaced snapshot"""
+        with self._lock:
+            self.epoch += 1
+            self._pending.append((self.epoch, callback))
+            self.stats['retired'] += 1
+        self.reclaim()
+
+    def _safe_epoch(self) -> Optional[int]:
+        epochs = [r.epoch for r in self._readers if r.epoch is not None]
+        return min(epochs) if epochs else None
+
+    def reclaim(self) -> int:
+        """Run the callbacks whose grace period is over, returns how many"""
+        # Readers call this on leave(), they never wait for a writer
+        if not self._lock.acquire(blocking=False):
+            return 0
+        try:
+            safe = self._safe_epoch()
+            ready = []
+            while self._pending and (safe is None or self._pending[0][0] <= safe):
+                ready.append(self._pending.popleft()[1])
+            self.stats['reclaimed'] += len(ready)
+        finally:
+            self._lock.release()
+        for callback in ready:
+            callback()
+        return len(ready)
+
+    def synchronize(self, timeout: Optional[float] = None) -> bool:
+        """
+        Wait until every pending callback ran.
+
+        Must not be called inside a read-side section of the calling thread.
+        """
+        deadline = None if timeout is None else time.monotonic() + timeout
+        while self._pending:
+            self.reclaim()
+            if not self._pending:
+                break
+            if deadline is not None and time.monotonic() > deadline:
+                return False
+            time.sleep(0.0005)
+        return True
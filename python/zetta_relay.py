@@ -0,0 +1,415 @@
+# zetta_relay.py
+"""
+Raw Zetta byte stream relay between file descriptors.
+
+For transparent tunnelling (serial port <-> TCP or Unix socket) frames do
+not need to be parsed and rebuilt. ZettaRelay moves the bytes between the
+two descriptors of each link from a single epoll loop:
+
+- mode="splice": bytes go src -> pipe -> dst with splice(2) and never
+  reach user space. Falls back to copying per direction when the kernel
+  cannot splice from a descriptor (older kernels and some tty drivers).
+- mode="copy": plain read/write, the baseline used by bench_relay.py.
+
+With sniff=True a direction is relayed with the copy path and frame
+boundaries are counted for statistics; frames are never validated or
+modified.
+"""
+import errno
+import os
+import select
+import socket
+import threading
+from dataclasses import dataclass, field
+from typing import Callable, Dict, Optional
+
+from zetta_rcu import EpochDomain
+
+START_BYTE = 0xAA
+STOP_BYTE = 0xBC
+
+_BOUNDARY = bytes([STOP_BYTE, START_BYTE])
+_SPLICE_FLAGS = getattr(os, 'SPLICE_F_MOVE', 1) | getattr(os, 'SPLICE_F_NONBLOCK', 2)
+HAVE_SPLICE = hasattr(os, 'splice')
+_PARKED = -1  # epoll mask of a descriptor taken out of epoll, see _update
+
+class FrameSniffer:
+    """
+    Estimates frames from STOP,START boundaries in the byte stream.
+
+    Runs at memory speed (bytes.count) instead of walking every frame;
+    statistics only, a payload containing 0xBC 0xAA is counted as a boundary.
+    """
+
+    __slots__ = ('last', 'frames')
+
+    def __init__(self):
+        self.last = -1
+        self.frames = 0
+
+    def feed(self, data) -> None:
+        if not data:
+            return
+        self.frames += data.count(_BOUNDARY)
+        if self.last == STOP_BYTE and data[0] == START_BYTE:
+            self.frames += 1
+        self.last = data[-1]
+
+@dataclass
+class DirectionStats:
+    bytes: int = 0
+    frames: int = 0
+    syscalls: int = 0
+    mode: str = ''
+
+class _Direction:
+    def __init__(self, src: int, dst: int, use_splice: bool, sniff: bool, chunk: int):
+        self.src = src
+        self.dst = dst
+        self.chunk = chunk
+        self.sniffer = FrameSniffer() if sniff else None
+        self.splice = use_splice and HAVE_SPLICE and not sniff
+        self.pipe = os.pipe2(os.O_NONBLOCK | os.O_CLOEXEC) if self.splice else None
+        self.pending = 0            # bytes in the pipe (splice)
+        self.buffer = bytearray()   # unwritten bytes (copy)
+        self.eof = False
+        self.shut = False           # end of file passed on to dst
+        self.stats = DirectionStats(mode='splice' if self.splice else 'copy')
+
+    def close(self):
+        if self.pipe:
+            os.close(self.pipe[0])
+            os.close(self.pipe[1])
+            self.pipe = None
+
+    def has_pending(self) -> bool:
+        return self.pending > 0 or len(self.buffer) > 0
+
+    def done(self) -> bool:
+        return self.eof and not self.has_pending()
+
+    def shutdown(self):
+        """Pass a finished direction's end of file on to dst (half close)"""
+        self.shut = True
+        try:
+            sock = socket.socket(fileno=self.dst)
+        except OSError:
+            return  # pipes and ttys have no half close
+        try:
+            sock.shutdown(socket.SHUT_WR)
+        except OSError:
+            pass
+        finally:
+            sock.detach()
+
+    def _fallback_to_copy(self):
+        # Data already moved into the pipe is kept and written first
+        if self.pending:
+            self.buffer += os.read(self.pipe[0], self.pending)
+            self.pending = 0
+        self.close()
+        self.splice = False
+        self.stats.mode = 'copy'
+
+    def _flush(self) -> bool:
+        """Write pending bytes, returns True when everything was written"""
+        st = self.stats
+        try:
+            if self.splice:
+                while self.pending:
+                    n = os.splice(self.pipe[0], self.dst, self.pending, flags=_SPLICE_FLAGS)
+                    st.syscalls += 1
+                    self.pending -= n
+            else:
+                while self.buffer:
+                    n = os.write(self.dst, self.buffer)
+                    st.syscalls += 1
+                    del self.buffer[:n]
+        except BlockingIOError:
+            return False
+        except OSError as e:
+            if self.splice and e.errno == errno.EINVAL:
+                self._fallback_to_copy()
+                return self._flush()
+            raise
+        return True
+
+    def _fill(self) -> Optional[int]:
+        """Read from src, returns bytes moved, 0 on EOF, None when drained"""
+        st = self.stats
+        try:
+            if self.splice:
+                n = os.splice(self.src, self.pipe[1], self.chunk, flags=_SPLICE_FLAGS)
+                self.pending += n
+            else:
+                data = os.read(self.src, self.chunk)
+                n = len(data)
+                if self.sniffer:
+                    self.sniffer.feed(data)
+                self.buffer += data
+        except BlockingIOError:
+            return None
+        except OSError as e:
+            if self.splice and e.errno == errno.EINVAL:
+                self._fallback_to_copy()
+                return self._fill()
+            raise
+        st.syscalls += 1
+        st.bytes += n
+        return n
+
+    def pump(self, budget: int = 16) -> None:
+        for _ in range(budget):
+            if not self._flush():
+                return
+            if self.eof:
+                return
+            n = self._fill()
+            if n is None:
+                return
+            if n == 0:
+                self.eof = True
+        self._flush()
+
+@dataclass
+class RelayLink:
+    name: str
+    a: int
+    b: int
+    a_to_b: _Direction
+    b_to_a: _Direction
+    on_close: Optional[Callable[['RelayLink'], None]] = None
+    closed: bool = False
+    masks: Dict[int, int] = field(default_factory=dict)  # epoll mask per fd
+
+    def stats(self) -> Dict[str, DirectionStats]:
+        for d in (self.a_to_b, self.b_to_a):
+            if d.sniffer:
+                d.stats.frames = d.sniffer.frames
+        return {'a_to_b': self.a_to_b.stats, 'b_to_a': self.b_to_a.stats}
+
+class _RelayConfig:
+    """Immutable link table, replaced as a whole on every change"""
+
+    __slots__ = ('links', 'owner')
+
+    def __init__(self, links: Dict[str, RelayLink]):
+        self.links = links
+        self.owner = {fd: link for link in links.values() for fd in (link.a, link.b)}
+
+class ZettaRelay:
+    """
+    Relay many links from one thread.
+
+    The link table is an RCU snapshot (see zetta_rcu): poll() reads it with
+    one attribute load and takes no lock, so add_link and remove_link never
+    stall the relay loop. A removed link's pipes are closed and its on_close
+    runs only after the loop stopped using it.
+
+    Args:
+        mode: "splice" (zero copy) or "copy"
+        sniff: Count frame boundaries (forces the copy path)
+        chunk: Maximum bytes moved per syscall
+    """
+
+    def __init__(self, mode: str = 'splice', sniff: bool = False, chunk: int = 1 << 16):
+        if mode not in ('splice', 'copy'):
+            raise ValueError(f"Unknown relay mode {mode!r}")
+        self.mode = mode
+        self.sniff = sniff
+        self.chunk = chunk
+        self._config = _RelayConfig({})
+        self._ep = select.epoll()
+        # Serialises writers only, poll() never takes it
+        self._lock = threading.Lock()
+        self.rcu = EpochDomain()
+        self._reader = self.rcu.reader()
+        self._thread: Optional[threading.Thread] = None
+        self._stop = False
+        self._poll_thread = None  # thread id inside poll()
+        self._wake_r, self._wake_w = os.pipe2(os.O_NONBLOCK | os.O_CLOEXEC)
+        self._ep.register(self._wake_r, select.EPOLLIN)
+
+    @property
+    def links(self) -> Dict[str, RelayLink]:
+        """Current link table, do not modify"""
+        return self._config.links
+
+    def add_link(self, name: str, a: int, b: int,
+                 on_close: Optional[Callable[[RelayLink], None]] = None) -> RelayLink:
+        """
+        Relay bytes in both directions between descriptors a and b.
+
+        The descriptors are switched to non-blocking mode and stay owned by
+        the caller. End of file on one side is passed on as a half close
+        (shutdown(SHUT_WR) on sockets) and the other direction keeps
+        flowing. When both directions reached end of file, on_close runs
+        once the relay stopped using the link.
+        """
+        use_splice = self.mode == 'splice'
+        link = RelayLink(name, a, b,
+                         _Direction(a, b, use_splice, self.sniff, self.chunk),
+                         _Direction(b, a, use_splice, self.sniff, self.chunk),
+                         on_close)
+        with self._lock:
+            if name in self._config.links:
+                self._retire(self._config.links[name])
+            for fd in (a, b):
+                os.set_blocking(fd, False)
+                # Registered before it is published, poll() skips unknown fds
+                link.masks[fd] = select.EPOLLIN
+                self._ep.register(fd, select.EPOLLIN)
+            links = dict(self._config.links)
+            links[name] = link
+            self._config = _RelayConfig(links)
+        return link
+
+    def remove_link(self, name: str):
+        """
+        Stop relaying a link.
+
+        Once this returns the relay no longer touches the link's descriptors
+        and the caller may close them (called from the relay thread itself,
+        e.g. an on_close callback, the current iteration skips the link).
+        """
+        with self._lock:
+            link = self._config.links.get(name)
+            if link is not None:
+                self._unpublish(link)
+        os.write(self._wake_w, b'\0')
+        if link is not None and self._poll_thread != threading.get_ident():
+            # An iteration in progress may still pump the old descriptors
+            self.rcu.synchronize()
+
+    def _unpublish(self, link: RelayLink, notify: bool = False):
+        links = dict(self._config.links)
+        if links.get(link.name) is link:
+            del links[link.name]
+            self._config = _RelayConfig(links)
+        self._retire(link, notify)
+
+    def _retire(self, link: RelayLink, notify: bool = False):
+        """Under the writer lock: stop polling the link, release it later"""
+        link.closed = True
+        # Unregistered now, the descriptor numbers may be reused by the
+        # caller; poll() skips events already fetched for them (owner/closed)
+        for fd in (link.a, link.b):
+            if link.masks.pop(fd, None) is not None:
+                try:
+                    self._ep.unregister(fd)
+                except (OSError, ValueError):
+                    pass
+        self.rcu.retire(lambda: self._release(link, notify))
+
+    def _release(self, link: RelayLink, notify: bool):
+        """Runs after the grace period, nothing uses the link anymore"""
+        link.a_to_b.close()
+        link.b_to_a.close()
+        if notify and link.on_close:
+            link.on_close(link)
+
+    def _update(self, link: RelayLink, fd: int):
+        # a_to_b reads a and writes b, b_to_a the other way round
+        src, dst = (link.a_to_b, link.b_to_a) if fd == link.a else (link.b_to_a, link.a_to_b)
+        mask = 0
+        if not src.eof and not src.has_pending():
+            mask |= select.EPOLLIN
+        if dst.has_pending():
+            mask |= select.EPOLLOUT
+        # Nothing left to read or write: EPOLLHUP cannot be masked and would
+        # fire on every iteration, so the fd leaves epoll until it has output
+        target = _PARKED if mask == 0 and src.eof else mask
+        current = link.masks.get(fd)
+        if current is None or current == target:
+            return  # retired meanwhile, or unchanged
+        if current == _PARKED or target == _PARKED:
+            # Rare, at end of file: under the writer lock so a concurrent
+            # remove_link cannot leave the fd registered
+            with self._lock:
+                if link.masks.get(fd) != current:
+                    return
+                if target == _PARKED:
+                    self._ep.unregister(fd)
+                else:
+                    self._ep.register(fd, target)
+                link.masks[fd] = target
+            return
+        try:
+            self._ep.modify(fd, target)
+        except FileNotFoundError:
+            return  # unregistered by a concurrent remove_link
+        link.masks[fd] = target
+
+    def poll(self, timeout: float = 0.1) -> int:
+        """Run one epoll iteration, returns the number of events handled"""
+        events = self._ep.poll(timeout)
+        reader = self._reader
+        self._poll_thread = threading.get_ident()
+        reader.enter()
+        try:
+            owner = self._config.owner
+            for fd, ev in events:
+                if fd == self._wake_r:
+                    try:
+                        os.read(self._wake_r, 4096)
+                    except BlockingIOError:
+                        pass
+                    continue
+                link = owner.get(fd)
+                if link is None or link.closed:
+                    continue
+                dirs = []
+                if ev & (select.EPOLLIN | select.EPOLLHUP | select.EPOLLERR):
+                    dirs.append(link.a_to_b if fd == link.a else link.b_to_a)
+                if ev & select.EPOLLOUT:
+                    dirs.append(link.b_to_a if fd == link.a else link.a_to_b)
+                try:
+                    for d in dirs:
+                        d.pump()
+                except OSError:
+                    link.a_to_b.eof = link.b_to_a.eof = True
+                    link.a_to_b.buffer.clear()
+                    link.b_to_a.buffer.clear()
+                    link.a_to_b.pending = link.b_to_a.pending = 0
+                for d in (link.a_to_b, link.b_to_a):
+                    if d.done() and not d.shut:
+                        d.shutdown()
+                if link.a_to_b.shut and link.b_to_a.shut:
+                    with self._lock:
+                        self._unpublish(link, notify=True)
+                    continue
+                self._update(link, link.a)
+                self._update(link, link.b)
+        finally:
+            reader.leave()
+            self._poll_thread = None
+        return len(events)
+
+    def start(self):
+        """Run the relay loop on a background thread"""
+        self._stop = False
+        self._thread = threading.Thread(target=self._run, name='zetta-relay', daemon=True)
+        self._thread.start()
+
+    def _run(self):
+        while not self._stop:
+            self.poll(0.1)
+
+    def stop(self):
+        self._stop = True
+        os.write(self._wake_w, b'\0')
+        if self._thread:
+            self._thread.join(timeout=1.0)
+            self._thread = None
+
+    def close(self):
+        self.stop()
+        with self._lock:
+            links = list(self._config.links.values())
+            self._config = _RelayConfig({})
+            for link in links:
+                self._retire(link)
+        self.rcu.synchronize(timeout=1.0)
+        self._ep.close()
+        os.close(self._wake_r)
+        os.close(self._wake_w)
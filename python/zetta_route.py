@@ -0,0 +1,351 @@
+# zetta_route.py
+"""
+Multi-hop mesh routing, mirror of Core/inc/zetta_route.h.
+
+A ZettaRouter owns several ZettaProtocol ports of one node. Nodes exchange
+distance vectors on every port each `interval`; vectors carry timestamps
+and sequence numbers, so every port measures RTT and loss to its neighbour.
+The link cost in milliseconds is
+
+    cost = max(1, srtt / 2) * (256 + 4 * loss + 4 * busy) / 256
+
+with loss and busy (TX backlog non-empty when sampled) as 0..255 EWMAs.
+Vectors queue behind data, so congestion also raises the RTT. Routes follow
+the smallest summed cost (a different next hop must be 1/8 better) and keep
+the hop count in the top 4 bits of the metric, 15 hops being unreachable.
+Split horizon with poisoned reverse and triggered updates reroute around
+failed links within a few intervals.
+
+    payload data:   [DATA, dst, src, ttl, type, payload...]
+    payload vector: [VECTOR, src, seq, t_tx u16, t_echo u16, hold u16,
+                     (dest, metric u16)...]
+
+tick() does all the work and takes the current time from `clock`, so the
+router runs on a thread (start()) or on the simulator (zetta_sim.SimClock).
+Forwarding reads a next hop snapshot, republished whenever a route changes
+port or reachability, and never takes the router lock.
+"""
+import struct
+import threading
+import time
+from typing import Callable, Dict, List, Optional
+
+from zetta_protocol import PacketType, ZettaPacket, ZettaPacketType, lookup_packet_type
+
+KIND_DATA = 0x00
+KIND_VECTOR = 0x01
+TTL = 15
+INF = 0xFFFF
+MAX_COST = 0x0FFF
+NONE = 0xFF
+
+_data = struct.Struct('<BBBBB')
+_vector = struct.Struct('<BBBHHH')
+_entry = struct.Struct('<BH')
+
+def hops(metric: int) -> int:
+    return metric >> 12
+
+def cost(metric: int) -> int:
+    return metric & MAX_COST
+
+def add_hop(metric: int, link_cost: int) -> int:
+    if metric == INF or hops(metric) + 1 >= 15:
+        return INF
+    return ((hops(metric) + 1) << 12) | min(MAX_COST, cost(metric) + link_cost)
+
+class RoutePort:
+    """Neighbour and link cost state of one port"""
+
+    def __init__(self, endpoint):
+        self.endpoint = endpoint
+        self.neighbor = NONE
+        self.rx_seq = 0
+        self.tx_seq = 0
+        self.loss = 0
+        self.busy = 0
+        self.srtt = 0
+        self.echo_t = 0
+        self.echo_at = 0
+        self.last_rx = 0
+
+    def as_dict(self) -> dict:
+        return {
+            'name': self.endpoint.transport.name,
+            'neighbor': None if self.neighbor == NONE else self.neighbor,
+            'srtt': self.srtt,
+            'loss': self.loss,
+            'busy': self.busy,
+        }
+
+class Route:
+    __slots__ = ('dest', 'port', 'metric', 'updated')
+
+    def __init__(self, dest: int, port: int, metric: int, updated: int):
+        self.dest = dest
+        self.port = port
+        self.metric = metric
+        self.updated = updated
+
+class ZettaRouter:
+    """
+    Distance vector router of one node.
+
+    Args:
+        address: Node address (0..254)
+        endpoints: ZettaProtocol instances, one per port
+        interval: Vector interval (seconds)
+        dead_interval: Neighbour and route timeout (default: 4 intervals)
+        clock: Time source in seconds
+        on_deliver: Called with (source address, packet type, payload) for
+            packets addressed to this node
+    """
+
+    def __init__(self, address: int, endpoints: List, interval: float = 0.05,
+                 dead_interval: Optional[float] = None,
+                 clock: Callable[[], float] = time.monotonic,
+                 on_deliver: Optional[Callable[[int, PacketType, bytes], None]] = None):
+        if not 0 <= address < NONE:
+            raise ValueError(f"invalid node address: {address}")
+        self.address = address
+        self.interval = max(1, int(interval * 1000))
+        self.dead = int((dead_interval or interval * 4) * 1000)
+        self.clock = clock
+        self.on_deliver = on_deliver
+        self.type = ZettaPacketType.MSG_ROUTE
+        self.ports = [RoutePort(ep) for ep in endpoints]
+        self.routes: Dict[int, Route] = {}
+        # dest -> port of reachable routes, immutable, replaced on change
+        self.next_hop: Dict[int, int] = {}
+        self._dirty = False
+        self.triggered = True
+        self.last_vector = None
+        self.stats = {'delivered': 0, 'forwarded': 0, 'no_route': 0,
+                      'ttl_expired': 0, 'changes': 0}
+        self._thread = None
+        self._stop = threading.Event()
+        self._lock = threading.Lock()
+        self._rx = []
+        for i, port in enumerate(self.ports):
+            listener = self._make_listener(i)
+            port.endpoint.add_rx_listener(listener)
+            self._rx.append(listener)
+
+    def _now(self) -> int:
+        return int(self.clock() * 1000)
+
+    def link_cost(self, i: int) -> int:
+        port = self.ports[i]
+        # No RTT sample yet: assume one interval
+        base = max(1, port.srtt // 2 if port.srtt else self.interval)
+        return max(1, min(MAX_COST, base * (256 + 4 * port.loss + 4 * port.busy) // 256))
+
+    def lookup(self, dst: int) -> Optional[Route]:
+        """Route to dst, None when unreachable"""
+        route = self.routes.get(dst)
+        return route if route is not None and route.metric != INF else None
+
+    def send(self, dst: int, packet_type: PacketType, payload: bytes) -> bool:
+        """Send to a node through the port of the next hop"""
+        if dst == self.address:
+            self._deliver(dst, int(packet_type), payload)
+            return True
+        port = self.next_hop.get(dst)
+        if port is None:
+            self.stats['no_route'] += 1
+            return False
+        msg = _data.pack(KIND_DATA, dst, self.address, TTL, int(packet_type)) + payload
+        return self.ports[port].endpoint.send_raw(self.type, msg)
+
+    def _deliver(self, src: int, packet_type: int, payload: bytes):
+        self.stats['delivered'] += 1
+        if self.on_deliver:
+            self.on_deliver(src, lookup_packet_type(packet_type), payload)
+
+    def _make_listener(self, i: int):
+        def on_packet(packet: ZettaPacket):
+            if packet.type == self.type:
+                self._on_rx(i, packet.data)
+        return on_packet
+
+    def _on_rx(self, i: int, msg: bytes):
+        if len(msg) >= _vector.size and msg[0] == KIND_VECTOR:
+            with self._lock:
+                self._on_vector(i, msg, self._now())
+                self._publish()
+        elif len(msg) >= _data.size and msg[0] == KIND_DATA:
+            _, dst, src, ttl, packet_type = _data.unpack_from(msg)
+            if dst == self.address:
+                self._deliver(src, packet_type, msg[_data.size:])
+            elif ttl <= 1:
+                self.stats['ttl_expired'] += 1
+            else:
+                self.stats['forwarded'] += 1
+                port = self.next_hop.get(dst)
+                if port is None:
+                    self.stats['no_route'] += 1
+                    return
+                fwd = msg[:3] + bytes((ttl - 1,)) + msg[4:]
+                self.ports[port].endpoint.send_raw(self.type, fwd)
+
+    def _on_vector(self, i: int, msg: bytes, now: int):
+        port = self.ports[i]
+        _, src, seq, t_tx, t_echo, hold = _vector.unpack_from(msg)
+        if port.neighbor != src:
+            # New neighbour, the first vector counts no loss
+            port.neighbor = src
+            port.rx_seq = (seq - 1) & 0xFF
+            self.triggered = True
+        missed = (seq - port.rx_seq - 1) & 0xFF
+        for _ in range(min(missed, 8)):
+            port.loss += (255 - port.loss) >> 3
+        port.loss -= port.loss >> 3
+        port.rx_seq = seq
+        if hold != 0xFFFF:
+            rtt = (now - t_echo - hold) & 0xFFFF
+            if port.srtt == 0:
+                port.srtt = rtt or 1
+            else:
+                port.srtt = max(1, port.srtt + int((rtt - port.srtt) / 8))
+        port.echo_t = t_tx
+        port.echo_at = now
+        port.last_rx = now
+
+        link = self.link_cost(i)
+        self._update(src, i, add_hop(0, link), now)
+        for off in range(_vector.size, len(msg) - _entry.size + 1, _entry.size):
+            dest, metric = _entry.unpack_from(msg, off)
+            self._update(dest, i, add_hop(metric, link), now)
+
+    def _update(self, dest: int, i: int, metric: int, now: int):
+        if dest == self.address:
+            return
+        route = self.routes.get(dest)
+        if route is None:
+            if metric != INF:
+                self.routes[dest] = Route(dest, i, metric, now)
+                self._changed()
+            return
+        if route.port == i:
+            # The current next hop is always believed, also when it got worse
+            if metric == INF:
+                if route.metric != INF:
+                    route.metric = INF
+                    route.updated = now  # start of the garbage collection timer
+                    self._changed()
+                return
+            if route.metric == INF:
+                self._changed()
+            route.metric = metric
+            route.updated = now
+            return
+        if metric == INF:
+            return
+        # Another next hop must be clearly better, RTT noise must not flap routes
+        cur = cost(route.metric)
+        if route.metric == INF or cost(metric) < cur - cur // 8:
+            route.port = i
+            route.metric = metric
+            route.updated = now
+            self._changed()
+
+    def _changed(self):
+        self.stats['changes'] += 1
+        self.triggered = True
+        self._dirty = True
+
+    def _publish(self):
+        """Replace the next hop snapshot after route changes"""
+        if self._dirty:
+            self._dirty = False
+            self.next_hop = {d: r.port for d, r in self.routes.items() if r.metric != INF}
+
+    def _port_down(self, i: int, now: int):
+        port = self.ports[i]
+        port.neighbor = NONE
+        port.srtt = 0
+        port.loss = 0
+        for route in self.routes.values():
+            if route.port == i and route.metric != INF:
+                route.metric = INF
+                route.updated = now
+                self.stats['changes'] += 1
+        self.triggered = True
+        self._dirty = True
+
+    def _send_vectors(self, i: int, now: int):
+        port = self.ports[i]
+        ep = port.endpoint
+        room = (ep.tx_profile.max_payload - _vector.size) // _entry.size
+        # Poisoned reverse: never offer a route back to its next hop
+        entries = [_entry.pack(r.dest, INF if r.port == i else r.metric)
+                   for r in self.routes.values()]
+        hold = 0xFFFF if port.neighbor == NONE else (now - port.echo_at) & 0xFFFF
+        # At least one frame, an empty vector still carries the timestamps
+        for off in range(0, max(1, len(entries)), room):
+            header = _vector.pack(KIND_VECTOR, self.address, port.tx_seq,
+                                  now & 0xFFFF, port.echo_t, hold)
+            port.tx_seq = (port.tx_seq + 1) & 0xFF
+            ep.send_raw(self.type, header + b''.join(entries[off:off + room]))
+
+    def tick(self, now: Optional[float] = None):
+        """Vectors, neighbour and route timeouts"""
+        now = self._now() if now is None else int(now * 1000)
+        with self._lock:
+            for i, port in enumerate(self.ports):
+                if port.neighbor != NONE and now - port.last_rx > self.dead:
+                    self._port_down(i, now)
+
+            for dest, route in list(self.routes.items()):
+                if now - route.updated > self.dead:
+                    if route.metric != INF:
+                        route.metric = INF
+                        route.updated = now
+                        self._changed()
+                    else:
+                        # Unreachable for a whole timeout, neighbours know by now
+                        del self.routes[dest]
+
+            since = None if self.last_vector is None else now - self.last_vector
+            if (since is None or since >= self.interval or
+                    (self.triggered and since >= self.interval // 4)):
+                for i, port in enumerate(self.ports):
+                    # Utilization sample, once per interval
+                    if port.endpoint.tx_backlog():
+                        port.busy += (255 - port.busy) >> 3
+                    else:
+                        port.busy -= port.busy >> 3
+                    self._send_vectors(i, now)
+                self.last_vector = now
+                self.triggered = False
+            self._publish()
+
+    def start(self, period: Optional[float] = None):
+        """Run tick() on a background thread"""
+        period = period or self.interval / 4000
+        self._stop.clear()
+
+        def run():
+            while not self._stop.wait(period):
+                self.tick()
+
+        self._thread = threading.Thread(target=run, name='zetta-route', daemon=True)
+        self._thread.start()
+
+    def stop(self):
+        self._stop.set()
+        if self._thread:
+            self._thread.join(timeout=1.0)
+            self._thread = None
+
+    def close(self):
+        self.stop()
+        for port, listener in zip(self.ports, self._rx):
+            port.endpoint.remove_rx_listener(listener)
+
+    def get_stats(self) -> dict:
+        return dict(self.stats,
+                    routes={d: {'port': r.port, 'hops': hops(r.metric),
+                                'cost': None if r.metric == INF else cost(r.metric)}
+                            for d, r in self.routes.items()},
+                    ports=[p.as_dict() for p in self.ports])
@@ -0,0 +1,639 @@
+# zetta_rules.py
+"""
+Alert rules evaluated on the receive path.
+
+Rules are predicates over the fields of decoded payloads. They are compiled
+per packet type into one generated Python function, so a frame is checked
+against all rules of its type in a single call on the receiver thread.
+attach() registers the engine as an rx listener, which runs after the frame
+was put on rx_queue and passed to rx_callback. Alerts are edge triggered per
+rule and key (for example per sensor id): one alert when the condition
+becomes true, one when it clears.
+
+    rules = RuleEngine(on_alert)
+    rules.define_fields(ZettaPacketType.MSG_PUBLISH, '<BhH',
+                        ('sensor', 'temp', 'volt'), key='sensor')
+    rules.add_rule('overheat', ZettaPacketType.MSG_PUBLISH, 'temp > 800')
+    rules.add_rule('s3_low', ZettaPacketType.MSG_PUBLISH, 'sensor == 3 and volt < 3100')
+    rules.add_rule('ramp', ZettaPacketType.MSG_PUBLISH, 'rate(temp) > 50')
+    rules.add_rule('silent', ZettaPacketType.MSG_PUBLISH, 'missing(0.5)')
+    rules.attach(zetta)
+
+Expressions use Python syntax: comparisons, and/or/not, + - * / % & |,
+abs(), min(), max(). Fields are the names given to define_fields or, as in
+publish filters (zetta_filter.py), u8/i8/u16/i16/u32/i32/f32[offset] and
+len. rate(field) is the change per second and delta(field) the change since
+the previous frame of the same key; missing(seconds) is true while no frame
+of the type (and key) arrived for that long and is checked by tick().
+
+Rules of the form `field <op> constant` (optionally `key == constant and`)
+go into sorted threshold tables: thousands of them cost one bisect per field
+and frame instead of one comparison per rule.
+"""
+import ast
+import struct
+import threading
+import time
+from bisect import bisect_left, bisect_right
+from typing import Any, Callable, Dict, List, Optional, Sequence
+
+from zetta_protocol import PacketType, ZettaPacket
+
+_OFFSET_FIELDS = {'u8': '<B', 'i8': '<b', 'u16': '<H', 'i16': '<h',
+                  'u32': '<I', 'i32': '<i', 'f32': '<f'}
+_FUNCS = {'abs', 'min', 'max', 'rate', 'delta', 'missing'}
+_ALLOWED = (ast.Expression, ast.BoolOp, ast.And, ast.Or, ast.UnaryOp, ast.Not,
+            ast.USub, ast.UAdd, ast.BinOp, ast.Add, ast.Sub, ast.Mult, ast.Div,
+            ast.Mod, ast.BitAnd, ast.BitOr, ast.Compare, ast.Eq, ast.NotEq,
+            ast.Lt, ast.LtE, ast.Gt, ast.GtE, ast.Name, ast.Load, ast.Constant,
+            ast.Subscript, ast.Call)
+# op -> (threshold sign, bisect): true set is a prefix of the sorted table
+_THRESHOLD_OPS = {ast.Gt: (1, 'left'), ast.GtE: (1, 'right'),
+                  ast.Lt: (-1, 'left'), ast.LtE: (-1, 'right')}
+_MIRROR = {ast.Gt: ast.Lt, ast.GtE: ast.LtE, ast.Lt: ast.Gt, ast.LtE: ast.GtE}
+
+def _fold(node):
+    """-constant as a Constant"""
+    if (isinstance(node, ast.UnaryOp) and isinstance(node.op, ast.USub) and
+            isinstance(node.operand, ast.Constant) and
+            isinstance(node.operand.value, (int, float))):
+        return ast.Constant(-node.operand.value)
+    return node
+
+class RuleError(ValueError):
+    """Raised for invalid rule expressions"""
+
+class _NoValue(Exception):
+    """rate()/delta() before a previous sample exists"""
+
+class Alert:
+    """An edge of a rule: active when the condition became true, else cleared"""
+    __slots__ = ('rule', 'packet_type', 'key', 'active', 'time', 'payload')
+
+    def __init__(self, rule: str, packet_type: int, key, active: bool, t: float,
+                 payload: Optional[bytes]):
+        self.rule = rule
+        self.packet_type = packet_type
+        self.key = key
+        self.active = active
+        self.time = t
+        self.payload = payload
+
+    def __repr__(self) -> str:
+        state = 'FIRE' if self.active else 'CLEAR'
+        return f"<Alert {self.rule} key={self.key} {state} t={self.time:.6f}>"
+
+class Rule:
+    """A compiled rule and its statistics"""
+
+    def __init__(self, name: str, packet_type: int, expression: str):
+        self.name = name
+        self.packet_type = packet_type
+        self.expression = expression
+        self.kind = 'generic'  # generic, threshold or missing
+        self.key = None        # key == constant conjunct, None for all keys
+        self.fires = 0
+        self.clears = 0
+        self.ns = 0            # time spent in the rule (profile=True)
+
+class _Schema:
+    def __init__(self, fmt: str, names: Sequence[str], key: Optional[str]):
+        self.struct = struct.Struct(fmt)
+        self.names = tuple(names)
+        if len(self.names) != len(self.struct.unpack(bytes(self.struct.size))):
+            raise RuleError(f"{fmt!r} does not decode into {len(self.names)} fields")
+        if key is not None and key not in self.names:
+            raise RuleError(f"key {key!r} is not a field")
+        self.key = key
+        self.key_index = self.names.index(key) if key is not None else None
+
+class _KeyState:
+    __slots__ = ('bits', 'pos', 'prev', 'rules', 'tables')
+
+    def __init__(self):
+        self.bits = bytearray()
+        self.pos = []
+        self.prev = []
+        self.rules = ()   # generic rules the bits belong to
+        self.tables = ()  # threshold tables the positions belong to
+
+class _Group:
+    """Compiled rules of one packet type"""
+
+    def __init__(self):
+        self.rules: List[Rule] = []
+        self.schema: Optional[_Schema] = None
+        self.fn = None
+        self.dirty = False
+        self.generic: List[Rule] = []
+        self.tables: List[List[Rule]] = []
+        self.missing: List[Rule] = []
+        self.nprev = 0
+        self.states: Dict[Any, _KeyState] = {}
+        self.seen: Dict[Any, float] = {}
+        self.frames = 0
+        self.short = 0  # payloads shorter than the field schema
+        self.ns = 0
+
+class _Compiler:
+    """Turns the rules of one group into Python source"""
+
+    def __init__(self, group: _Group, profile: bool):
+        self.group = group
+        self.profile = profile
+        self.schema = group.schema
+        self.names = set(group.schema.names) if group.schema else set()
+        self.consts: Dict[str, Any] = {}
+        self.prev_slots: Dict[str, int] = {}
+
+    def const(self, prefix: str, value) -> str:
+        name = f"{prefix}{len(self.consts)}"
+        self.consts[name] = value
+        return name
+
+    def field(self, node) -> Optional[str]:
+        """Source of a field reference, None if node is not one"""
+        if isinstance(node, ast.Name):
+            if node.id in self.names:
+                return f"f_{node.id}"
+            if node.id == 'len':
+                return 'plen'
+            return None
+        if (isinstance(node, ast.Subscript) and isinstance(node.value, ast.Name) and
+                node.value.id in _OFFSET_FIELDS and isinstance(node.slice, ast.Constant) and
+                isinstance(node.slice.value, int)):
+            s = self.const('S', struct.Struct(_OFFSET_FIELDS[node.value.id]))
+            return f"{s}.unpack_from(p, {node.slice.value})[0]"
+        return None
+
+    def expr(self, node) -> str:
+        for sub in ast.walk(node):
+            if not isinstance(sub, _ALLOWED):
+                raise RuleError(f"{type(sub).__name__} is not allowed in rules")
+        return self._expr(node)
+
+    def _expr(self, node) -> str:
+        f = self.field(node)
+        if f is not None:
+            return f
+        if isinstance(node, ast.Constant):
+            if not isinstance(node.value, (int, float)) or isinstance(node.value, bool):
+                raise RuleError(f"unsupported constant {node.value!r}")
+            return repr(node.value)
+        if isinstance(node, ast.Name):
+            raise RuleError(f"unknown field {node.id!r}")
+        if isinstance(node, ast.Subscript):
+            raise RuleError("offset fields look like u16[2]")
+        if isinstance(node, ast.BoolOp):
+            op = ' and ' if isinstance(node.op, ast.And) else ' or '
+            return '(' + op.join(self._expr(v) for v in node.values) + ')'
+        if isinstance(node, ast.UnaryOp):
+            op = {ast.Not: 'not ', ast.USub: '-', ast.UAdd: '+'}[type(node.op)]
+            return f"({op}{self._expr(node.operand)})"
+        if isinstance(node, ast.BinOp):
+            op = {ast.Add: '+', ast.Sub: '-', ast.Mult: '*', ast.Div: '/',
+                  ast.Mod: '%', ast.BitAnd: '&', ast.BitOr: '|'}[type(node.op)]
+            return f"({self._expr(node.left)} {op} {self._expr(node.right)})"
+        if isinstance(node, ast.Compare):
+            ops = {ast.Eq: '==', ast.NotEq: '!=', ast.Lt: '<', ast.LtE: '<=',
+                   ast.Gt: '>', ast.GtE: '>='}
+            out = self._expr(node.left)
+            for op, right in zip(node.ops, node.comparators):
+                out += f" {ops[type(op)]} {self._expr(right)}"
+            return f"({out})"
+        if isinstance(node, ast.Call):
+            if not isinstance(node.func, ast.Name) or node.func.id not in _FUNCS:
+                raise RuleError("unknown function")
+            name = node.func.id
+            if node.keywords:
+                raise RuleError(f"{name}() takes no keywords")
+            if name in ('rate', 'delta'):
+                if len(node.args) != 1 or self.field(node.args[0]) is None:
+                    raise RuleError(f"{name}() takes one field")
+                src = self.field(node.args[0])
+                slot = self.prev_slots.setdefault(src, len(self.prev_slots))
+                return f"_{name}(prev[{slot}], {src}, now)"
+            if name == 'missing':
+                raise RuleError("missing() must be the whole rule, optionally "
+                                "combined with key == constant")
+            return f"{name}({', '.join(self._expr(a) for a in node.args)})"
+        raise RuleError(f"unsupported expression {ast.dump(node)}")
+
+    def key_split(self, node):
+        """(key constant or None, rest of the expression)"""
+        key = self.schema.key if self.schema else None
+        if key is None:
+            return None, node
+
+        def is_key_eq(n):
+            return (isinstance(n, ast.Compare) and len(n.ops) == 1 and
+                    isinstance(n.ops[0], ast.Eq) and isinstance(n.left, ast.Name) and
+                    n.left.id == key and isinstance(n.comparators[0], ast.Constant))
+
+        if isinstance(node, ast.BoolOp) and isinstance(node.op, ast.And):
+            for i, v in enumerate(node.values):
+                if is_key_eq(v):
+                    rest = node.values[:i] + node.values[i + 1:]
+                    rest = rest[0] if len(rest) == 1 else ast.BoolOp(ast.And(), rest)
+                    return v.comparators[0].value, rest
+        return None, node
+
+    @staticmethod
+    def threshold(node):
+        """(field node, op, constant) for `field op constant`, else None"""
+        if not (isinstance(node, ast.Compare) and len(node.ops) == 1):
+            return None
+        op, left, right = type(node.ops[0]), node.left, node.comparators[0]
+        if op not in _THRESHOLD_OPS:
+            return None
+        left, right = _fold(left), _fold(right)
+        if isinstance(left, ast.Constant) and not isinstance(right, ast.Constant):
+            left, right, op = right, left, _MIRROR[op]
+        if not isinstance(right, ast.Constant) or isinstance(right.value, bool):
+            return None
+        if not isinstance(right.value, (int, float)):
+            return None
+        return left, op, right.value
+
+    @staticmethod
+    def missing(node) -> Optional[float]:
+        if (isinstance(node, ast.Call) and isinstance(node.func, ast.Name) and
+                node.func.id == 'missing'):
+            if (len(node.args) != 1 or not isinstance(node.args[0], ast.Constant) or
+                    not isinstance(node.args[0].value, (int, float))):
+                raise RuleError("missing() takes a number of seconds")
+            return float(node.args[0].value)
+        return None
+
+    def classify(self, rule: Rule):
+        """Parse a rule, set its kind and key and return its table or source"""
+        try:
+            tree = ast.parse(rule.expression, mode='eval').body
+        except SyntaxError as e:
+            raise RuleError(f"{rule.name}: {e.msg}") from None
+        key, rest = self.key_split(tree)
+        rule.key = key
+        seconds = self.missing(rest)
+        if seconds is not None:
+            rule.kind = 'missing'
+            rule.seconds = seconds
+            return None
+        th = self.threshold(rest)
+        if th is not None and self.field(th[0]) is not None:
+            rule.kind = 'threshold'
+            field, op, value = th
+            sign, side = _THRESHOLD_OPS[op]
+            return (key, self.expr(field), sign, side), sign * value
+        rule.kind = 'generic'
+        return key, self.expr(rest)
+
+    def compile(self):
+        g = self.group
+        generic: Dict[Any, List[tuple]] = {}
+        tables: Dict[tuple, List[tuple]] = {}
+        missing = []
+        for rule in g.rules:
+            out = self.classify(rule)
+            if rule.kind == 'missing':
+                missing.append(rule)
+            elif rule.kind == 'threshold':
+                tables.setdefault(out[0], []).append((out[1], rule))
+            else:
+                generic.setdefault(out[0], []).append((out[1], rule))
+
+        g.generic, g.tables = [], []
+        keyvar = f"f_{self.schema.key}" if self.schema and self.schema.key else None
+        keys = [None] + sorted({k for k in list(generic) + [t[0] for t in tables]
+                                if k is not None}, key=repr)
+        # One function per key value, the unkeyed one dispatches to the others.
+        # Edges are collected in `ev` as (rule, active) and fired by the engine.
+        funcs = {key: f"_k{i}" for i, key in enumerate(keys[1:])}
+        lines = []
+        for key in keys:
+            name = funcs.get(key, '_eval')
+            lines.append(f"def {name}(p, plen, vals, now, ks, ev):")
+            if self.schema:
+                fields = ', '.join(f"f_{n}" for n in self.schema.names)
+                lines.append(f"    {fields}, = vals")
+            lines += ['    bits = ks.bits', '    pos = ks.pos', '    prev = ks.prev']
+            for src, rule in generic.get(key, ()):
+                i = len(g.generic)
+                g.generic.append(rule)
+                if self.profile:
+                    lines.append("    t0 = _ns()")
+                lines.append("    try:")
+                lines.append(f"        c = 1 if {src} else 0")
+                lines.append("    except Exception:")
+                lines.append("        c = 0")
+                if self.profile:
+                    lines.append(f"    R[{i}].ns += _ns() - t0")
+                lines.append(f"    if c != bits[{i}]:")
+                lines.append(f"        bits[{i}] = c")
+                lines.append(f"        ev.append((R[{i}], c))")
+            for (tkey, src, sign, side), entries in tables.items():
+                if tkey != key:
+                    continue
+                entries.sort(key=lambda e: e[0])
+                t = len(g.tables)
+                g.tables.append([rule for _, rule in entries])
+                thresholds = self.const('K', [v for v, _ in entries])
+                value = src if sign > 0 else f"-({src})"
+                lines.append("    try:")
+                lines.append(f"        n = _bisect_{side}({thresholds}, {value})")
+                lines.append("    except Exception:")
+                lines.append("        n = 0")
+                # Rules [o, n) became true, or [n, o) became false
+                lines.append(f"    o = pos[{t}]")
+                lines.append("    if n > o:")
+                lines.append(f"        ev.extend([(r, 1) for r in T[{t}][o:n]])")
+                lines.append(f"        pos[{t}] = n")
+                lines.append("    elif n < o:")
+                lines.append(f"        ev.extend([(r, 0) for r in T[{t}][n:o]])")
+                lines.append(f"        pos[{t}] = n")
+            if key is None:
+                if funcs:
+                    lines.append(f"    fk = KF.get({keyvar})")
+                    lines.append("    if fk is not None:")
+                    lines.append("        fk(p, plen, vals, now, ks, ev)")
+                for src, slot in self.prev_slots.items():
+                    lines.append(f"    prev[{slot}] = ({src}, now)")
+            lines.append("    return")
+            lines.append("")
+
+        namespace = dict(self.consts, R=g.generic, T=g.tables, _rate=_rate, _delta=_delta,
+                         _bisect_left=bisect_left, _bisect_right=bisect_right,
+                         _ns=time.perf_counter_ns)
+        g.source = '\n'.join(lines)
+        exec(compile(g.source, f"<rules {g.rules[0].packet_type if g.rules else '-'}>",
+                     'exec'), namespace)
+        namespace['KF'] = {key: namespace[name] for key, name in funcs.items()}
+        g.fn = namespace['_eval']
+        g.missing = missing
+        g.nprev = len(self.prev_slots)
+
+def _rate(prev, value, now):
+    if prev is None or now <= prev[1]:
+        raise _NoValue
+    return (value - prev[0]) / (now - prev[1])
+
+def _delta(prev, value, now):
+    if prev is None:
+        raise _NoValue
+    return value - prev[0]
+
+class RuleEngine:
+    """
+    Compiled alert rules over the received frames.
+
+    Args:
+        on_alert: Called with every Alert, on the thread that evaluated it and
+            outside the engine's lock (it may call rule_stats or add rules)
+        clock: Time source in seconds (frame arrival time, missing())
+        profile: Measure the time spent in every generic rule
+    """
+
+    def __init__(self, on_alert: Callable[[Alert], None],
+                 clock: Callable[[], float] = time.monotonic, profile: bool = False):
+        self.on_alert = on_alert
+        self.clock = clock
+        self.profile = profile
+        self.started = clock()
+        self._groups: Dict[int, _Group] = {}
+        self._rules: Dict[str, Rule] = {}
+        self._missing_active: Dict[tuple, bool] = {}
+        self._lock = threading.Lock()
+        self._attached = []
+
+    def _group(self, packet_type) -> _Group:
+        return self._groups.setdefault(int(packet_type), _Group())
+
+    def define_fields(self, packet_type: PacketType, fmt: str, names: Sequence[str],
+                      key: Optional[str] = None):
+        """
+        Name the payload fields of a packet type.
+
+        Args:
+            packet_type: Packet type the layout applies to
+            fmt: struct format of the payload (prefix, extra bytes are ignored)
+            names: One name per decoded value
+            key: Field that identifies the source (sensor id); alerts are
+                tracked per key value
+        """
+        with self._lock:
+            g = self._group(packet_type)
+            g.schema = _Schema(fmt, names, key)
+            g.states.clear()
+            self._recompile(g)
+
+    def add_rule(self, name: str, packet_type: PacketType, expression: str) -> Rule:
+        """Add a rule, raises RuleError for invalid expressions"""
+        with self._lock:
+            if name in self._rules:
+                raise RuleError(f"duplicate rule {name!r}")
+            g = self._group(packet_type)
+            rule = Rule(name, int(packet_type), expression)
+            # Validate now, compile on the next frame: adding many rules stays linear
+            _Compiler(g, self.profile).classify(rule)
+            g.rules.append(rule)
+            g.dirty = True
+            self._rules[name] = rule
+            return rule
+
+    def remove_rule(self, name: str):
+        with self._lock:
+            rule = self._rules.pop(name)
+            g = self._groups[rule.packet_type]
+            g.rules.remove(rule)
+            g.dirty = True
+
+    def _recompile(self, g: _Group):
+        _Compiler(g, self.profile).compile()
+        g.dirty = False
+
+    def _ready(self, packet_type) -> Optional[_Group]:
+        """Compiled group of a type, None when it has no rules (lock held)"""
+        g = self._groups.get(int(packet_type))
+        if g is None or not g.rules:
+            return None
+        if g.dirty:
+            self._recompile(g)
+        return g
+
+    def _state(self, g: _Group, key) -> _KeyState:
+        ks = g.states.get(key)
+        if ks is None:
+            ks = g.states[key] = _KeyState()
+        if ks.rules is not g.generic:
+            # Rules changed: keep the state of the rules that stayed
+            old = {id(r): b for r, b in zip(ks.rules, ks.bits)}
+            ks.bits = bytearray(old.get(id(r), 0) for r in g.generic)
+            ks.rules = g.generic
+            active = {id(r) for table, n in zip(ks.tables, ks.pos) for r in table[:n]}
+            ks.pos = []
+            for table in g.tables:
+                n = 0
+                while n < len(table) and id(table[n]) in active:
+                    n += 1
+                ks.pos.append(n)
+            ks.tables = g.tables
+            ks.prev = [None] * g.nprev
+        return ks
+
+    def evaluate(self, packet_type: PacketType, payload: bytes, now: Optional[float] = None):
+        """Check one payload against the rules of its type"""
+        if now is None:
+            now = self.clock()
+        alerts = []
+        with self._lock:
+            g = self._ready(packet_type)
+            if g is None:
+                return
+            vals = self._decode(g, payload)
+            if vals is not None:
+                self._evaluate(g, int(packet_type), payload, vals, now, alerts)
+        self._fire(alerts)
+
+    def _fire(self, alerts: List[Alert]):
+        # Handlers run outside the lock, they may call back into the engine
+        for alert in alerts:
+            self.on_alert(alert)
+
+    def _evaluate(self, g: _Group, ptype: int, payload: bytes, vals, now: float,
+                  alerts: List[Alert]):
+        start = time.perf_counter_ns()
+        schema = g.schema
+        key = vals[schema.key_index] if schema is not None and schema.key else None
+        ks = self._state(g, key)
+        ev = []
+        g.fn(payload, len(payload), vals, now, ks, ev)
+        g.frames += 1
+        if g.missing:
+            g.seen[key] = now
+            for rule in g.missing:
+                if self._missing_active.pop((rule.name, key), False):
+                    ev.append((rule, 0))
+        g.ns += time.perf_counter_ns() - start
+        for rule, active in ev:
+            if active:
+                rule.fires += 1
+            else:
+                rule.clears += 1
+            alerts.append(Alert(rule.name, ptype, key, bool(active), now, payload))
+
+    def _decode(self, g: _Group, payload: bytes):
+        """Field values of a payload, None when it is too short"""
+        schema = g.schema
+        if schema is None:
+            return ()
+        if len(payload) < schema.struct.size:
+            g.short += 1
+            return None
+        return schema.struct.unpack_from(payload)
+
+    def evaluate_batch(self, packet_type: PacketType, payloads: List[bytes],
+                       now: Optional[float] = None):
+        """
+        Check a batch of payloads (usable as a register_batch_handler callback).
+
+        When every payload has exactly the size of the field schema, the
+        batch is decoded in one struct.iter_unpack pass.
+        """
+        if now is None:
+            now = self.clock()
+        ptype = int(packet_type)
+        alerts = []
+        with self._lock:
+            g = self._ready(packet_type)
+            if g is None:
+                return
+            schema = g.schema
+            size = schema.struct.size if schema is not None else -1
+            if all(len(p) == size for p in payloads):
+                decoded = schema.struct.iter_unpack(b''.join(payloads))
+                for payload, vals in zip(payloads, decoded):
+                    self._evaluate(g, ptype, payload, vals, now, alerts)
+            else:
+                for payload in payloads:
+                    vals = self._decode(g, payload)
+                    if vals is not None:
+                        self._evaluate(g, ptype, payload, vals, now, alerts)
+        self._fire(alerts)
+
+    def _on_packet(self, packet: ZettaPacket):
+        if int(packet.type) not in self._groups:
+            return
+        now = self.clock()
+        alerts = []
+        with self._lock:
+            g = self._ready(packet.type)
+            if g is None:
+                return
+            vals = self._decode(g, packet.data)
+            if vals is not None:
+                self._evaluate(g, int(packet.type), packet.data, vals, now, alerts)
+        self._fire(alerts)
+
+    def attach(self, zetta):
+        """Evaluate every packet received by a ZettaProtocol instance"""
+        zetta.add_rx_listener(self._on_packet)
+        self._attached.append(zetta)
+
+    def detach(self):
+        for zetta in self._attached:
+            zetta.remove_rx_listener(self._on_packet)
+        self._attached = []
+
+    def tick(self, now: Optional[float] = None):
+        """Evaluate missing() rules, call periodically"""
+        if now is None:
+            now = self.clock()
+        alerts = []
+        with self._lock:
+            for ptype in self._groups:
+                g = self._ready(ptype)
+                for rule in g.missing if g is not None else ():
+                    keys = [rule.key] if rule.key is not None else (list(g.seen) or [None])
+                    for key in keys:
+                        last = g.seen.get(key, self.started)
+                        state = (rule.name, key)
+                        if now - last > rule.seconds and not self._missing_active.get(state):
+                            self._missing_active[state] = True
+                            rule.fires += 1
+                            alerts.append(Alert(rule.name, ptype, key, True, now, None))
+        self._fire(alerts)
+
+    def rule_stats(self) -> Dict[str, dict]:
+        """Per rule: kind, evaluations, fires, clears and cost"""
+        out = {}
+        with self._lock:
+            for ptype, g in self._groups.items():
+                per_frame = g.ns / g.frames if g.frames else 0.0
+                for rule in g.rules:
+                    out[rule.name] = {
+                        'type': ptype,
+                        'kind': rule.kind,
+                        'evaluations': g.frames,
+                        'fires': rule.fires,
+                        'clears': rule.clears,
+                        'ns_per_eval': rule.ns / g.frames if g.frames and self.profile
+                        and rule.kind == 'generic' else None,
+                        'type_ns_per_frame': per_frame,
+                    }
+        return out
+
+    def get_stats(self) -> dict:
+        with self._lock:
+            for ptype in self._groups:
+                self._ready(ptype)
+            return {
+                int(ptype): {
+                    'rules': len(g.rules),
+                    'generic': len(g.generic),
+                    'threshold_tables': len(g.tables),
+                    'missing': len(g.missing),
+                    'frames': g.frames,
+                    'short': g.short,
+                    'ns_per_frame': g.ns / g.frames if g.frames else 0.0,
+                }
+                for ptype, g in self._groups.items()
+            }
@@ -0,0 +1,110 @@
+# zetta_seq.py
+"""
+Sequence number tracking and loss accounting, mirror of Core/inc/zetta_seq.h.
+
+Frames of a sequenced type carry one sequence byte in front of the payload.
+The receiver detects gaps, late (reordered) and duplicate frames and keeps
+loss statistics without any acknowledgement traffic.
+"""
+from dataclasses import dataclass, field
+from typing import List
+
+WINDOW = 32
+RESYNC = 4
+BURST_BINS = ('1', '2', '3-4', '5-8', '9-16', '17+')
+EWMA_WEIGHT = 1 / 32
+
+@dataclass
+class SequenceStats:
+    received: int = 0
+    lost: int = 0
+    reordered: int = 0
+    duplicates: int = 0
+    resyncs: int = 0
+    bursts: List[int] = field(default_factory=lambda: [0] * len(BURST_BINS))
+    loss_ewma: float = 0.0
+
+    @property
+    def loss_rate(self) -> float:
+        """Lost fraction over the whole lifetime"""
+        total = self.received + self.lost
+        return self.lost / total if total else 0.0
+
+    def as_dict(self) -> dict:
+        return {
+            'received': self.received,
+            'lost': self.lost,
+            'reordered': self.reordered,
+            'duplicates': self.duplicates,
+            'resyncs': self.resyncs,
+            'loss_rate': self.loss_rate,
+            'loss_ewma': self.loss_ewma,
+            'bursts': dict(zip(BURST_BINS, self.bursts)),
+        }
+
+def _burst_bin(burst: int) -> int:
+    b, limit = 0, 1
+    while b < len(BURST_BINS) - 1 and burst > limit:
+        b += 1
+        limit <<= 1
+    return b
+
+class SequenceChannel:
+    """TX counter and RX tracker of one sequenced packet type"""
+
+    def __init__(self):
+        self.tx_seq = 0
+        self.expected = 0
+        self.synced = False
+        self.stale = 0
+        self.window = 0  # bit i set: seq (expected - 1 - i) still missing
+        self.stats = SequenceStats()
+
+    def next_tx(self) -> int:
+        seq = self.tx_seq
+        self.tx_seq = (seq + 1) & 0xFF
+        return seq
+
+    def _ewma(self, lost: bool, count: int = 1):
+        st = self.stats
+        for _ in range(min(count, WINDOW)):
+            st.loss_ewma += ((1.0 if lost else 0.0) - st.loss_ewma) * EWMA_WEIGHT
+
+    def track(self, seq: int):
+        """Account for a received sequence number"""
+        st = self.stats
+        gap = (seq - self.expected) & 0xFF
+        st.received += 1
+
+        if not self.synced or (gap >= 128 and self.stale >= RESYNC):
+            if self.synced:
+                st.resyncs += 1
+            self.synced = True
+            self.expected = (seq + 1) & 0xFF
+            self.window = 0
+            self.stale = 0
+            self._ewma(False)
+            return
+
+        if gap < 128:
+            self.stale = 0
+            if gap:
+                st.lost += gap
+                st.bursts[_burst_bin(gap)] += 1
+                self._ewma(True, gap)
+            self._ewma(False)
+            self.window = (self.window << (gap + 1)) & 0xFFFFFFFF
+            self.window |= (((1 << gap) - 1) << 1) & 0xFFFFFFFE
+            self.expected = (seq + 1) & 0xFF
+            return
+
+        age = (self.expected - 1 - seq) & 0xFF
+        if 0 < age < WINDOW and self.window & (1 << age):
+            self.window &= ~(1 << age)
+            st.lost -= 1
+            st.reordered += 1
+            self.stale = 0
+        else:
+            st.duplicates += 1
+            st.received -= 1
+            self.stale += 1
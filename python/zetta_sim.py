@@ -0,0 +1,292 @@
+# zetta_sim.py
+"""
+Discrete event link simulator.
+
+Runs the real host stack (ZettaProtocol framing, dispatch, listeners) over
+simulated serial lines in virtual time, so link behaviour can be measured
+much faster than real time and reproducibly (seeded).
+
+    clock = SimClock()
+    host = sim_endpoint(clock, "host")
+    dev = sim_endpoint(clock, "dev")
+    ab, ba = connect(clock, host, dev, baud=115200, loss=0.01)
+    clock.every(0.01, lambda: dev.send_raw(ZettaPacketType.MSG_PUBLISH, b"x"))
+    clock.run_for(10.0)
+
+Simulated endpoints have no receiver thread: bytes are decoded and
+dispatched synchronously when they arrive on the wire.
+"""
+import heapq
+import random
+import time
+from collections import deque
+from typing import Callable, List, Optional
+
+from zetta_protocol import ZettaProtocol
+
+class SimEvent:
+    __slots__ = ('time', 'fn', 'args', 'cancelled', 'period')
+
+    def __init__(self, t: float, fn: Callable, args: tuple, period: float = 0.0):
+        self.time = t
+        self.fn = fn
+        self.args = args
+        self.cancelled = False
+        self.period = period
+
+    def cancel(self):
+        self.cancelled = True
+
+class SimClock:
+    """Virtual time and event queue"""
+
+    def __init__(self, start: float = 0.0):
+        self.now = start
+        self._queue = []
+        self._seq = 0
+
+    def time(self) -> float:
+        """Current virtual time, usable wherever a clock function is expected"""
+        return self.now
+
+    def call_at(self, t: float, fn: Callable, *args) -> SimEvent:
+        return self._push(SimEvent(max(t, self.now), fn, args))
+
+    def call_later(self, delay: float, fn: Callable, *args) -> SimEvent:
+        return self._push(SimEvent(self.now + delay, fn, args))
+
+    def every(self, period: float, fn: Callable, *args, start: Optional[float] = None) -> SimEvent:
+        """Call fn every period seconds until the returned event is cancelled"""
+        t = self.now + period if start is None else start
+        return self._push(SimEvent(t, fn, args, period))
+
+    def _push(self, ev: SimEvent) -> SimEvent:
+        # seq keeps events of equal time in scheduling order
+        self._seq += 1
+        heapq.heappush(self._queue, (ev.time, self._seq, ev))
+        return ev
+
+    def run_until(self, t: float) -> int:
+        """Run all events up to time t, returns the number of events run"""
+        queue = self._queue
+        count = 0
+        while queue and queue[0][0] <= t:
+            _, _, ev = heapq.heappop(queue)
+            if ev.cancelled:
+                continue
+            self.now = ev.time
+            ev.fn(*ev.args)
+            count += 1
+            if ev.period and not ev.cancelled:
+                ev.time += ev.period
+                self._push(ev)
+        self.now = max(self.now, t)
+        return count
+
+    def run_for(self, duration: float) -> int:
+        return self.run_until(self.now + duration)
+
+    def pending(self) -> int:
+        """Scheduled events, cancelled ones included until they are popped"""
+        return len(self._queue)
+
+class WireStats:
+    __slots__ = ('frames', 'bytes', 'lost', 'corrupted', 'cut')
+
+    def __init__(self):
+        self.frames = 0
+        self.bytes = 0
+        self.lost = 0       # random loss
+        self.corrupted = 0  # at least one bit flipped
+        self.cut = 0        # sent or in flight while the wire was down
+
+class SimWire:
+    """
+    One direction of a simulated line.
+
+    Each send() is one frame: it occupies the line for its serialization
+    time (10 bits per byte at `baud`), then arrives after `delay` plus up to
+    `jitter` seconds. Frames are lost with probability `loss`, bits flip with
+    probability `ber` and nothing gets through while the wire is cut.
+    """
+
+    def __init__(self, clock: SimClock, baud: int = 115200, delay: float = 0.0002,
+                 jitter: float = 0.0, loss: float = 0.0, ber: float = 0.0,
+                 rng: Optional[random.Random] = None, name: str = ''):
+        self.clock = clock
+        self.baud = baud
+        self.delay = delay
+        self.jitter = jitter
+        self.loss = loss
+        self.ber = ber
+        self.rng = rng or random.Random(0)
+        self.name = name
+        self.up = True
+        self.sink: Callable[[bytes], None] = lambda data: None
+        self.stats = WireStats()
+        self._busy_until = 0.0
+        self._last_arrival = 0.0
+        self._queue = deque()  # (tx start, event, data, tx end) not delivered yet
+
+    def byte_time(self) -> float:
+        return 10.0 / self.baud if self.baud else 0.0
+
+    def send(self, data: bytes, on_sent: Optional[Callable[[], None]] = None):
+        """Queue one frame, on_sent is called when it has been serialized"""
+        st = self.stats
+        if not self.up:
+            st.cut += 1
+            if on_sent is not None:
+                self.clock.call_later(0.0, on_sent)
+            return
+        now = self.clock.now
+        start = max(now, self._busy_until)
+        self._busy_until = start + len(data) * self.byte_time()
+        if on_sent is not None:
+            self.clock.call_at(self._busy_until, on_sent)
+        st.frames += 1
+        st.bytes += len(data)
+        if self.loss and self.rng.random() < self.loss:
+            st.lost += 1
+            return
+        if self.ber:
+            data = self._flip(data)
+        arrival = self._busy_until + self.delay
+        if self.jitter:
+            arrival += self.jitter * self.rng.random()
+        # A serial line never reorders
+        arrival = max(arrival, self._last_arrival)
+        self._last_arrival = arrival
+        entry = [start, None, data, self._busy_until]
+        entry[1] = self.clock.call_at(arrival, self._deliver, entry)
+        self._queue.append(entry)
+
+    def _flip(self, data: bytes) -> bytes:
+        rng = self.rng
+        nbits = len(data) * 8
+        # Geometric skip between errors instead of one draw per bit
+        pos = -1
+        flipped = None
+        while True:
+            pos += 1 + int(rng.expovariate(self.ber)) if self.ber < 1 else 1
+            if pos >= nbits:
+                break
+            if flipped is None:
+                flipped = bytearray(data)
+            flipped[pos >> 3] ^= 1 << (pos & 7)
+        if flipped is None:
+            return data
+        self.stats.corrupted += 1
+        return bytes(flipped)
+
+    def _deliver(self, entry):
+        if self._queue and self._queue[0] is entry:
+            self._queue.popleft()
+        else:
+            self._queue.remove(entry)
+        if not self.up:
+            self.stats.cut += 1
+            return
+        self.sink(entry[2])
+
+    def out_waiting(self) -> int:
+        """Bytes accepted but not serialized yet"""
+        backlog = self._busy_until - self.clock.now
+        return int(backlog / self.byte_time() + 0.5) if backlog > 0 and self.baud else 0
+
+    def take_pending(self) -> List[bytes]:
+        """Remove frames whose transmission has not started yet"""
+        now = self.clock.now
+        taken = []
+        while self._queue and self._queue[-1][0] > now:
+            entry = self._queue.pop()
+            entry[1].cancel()
+            taken.append(entry[2])
+        taken.reverse()
+        if taken:
+            self._busy_until = max(now, self._queue[-1][3] if self._queue else now)
+        return taken
+
+    def cut(self):
+        """Take the wire down, frames in flight are lost"""
+        self.up = False
+
+    def restore(self):
+        self.up = True
+
+class SimTransport:
+    """Transport of a simulated endpoint, writes go to its outgoing wire"""
+
+    def __init__(self, name: str):
+        self.name = name
+        self.wire: Optional[SimWire] = None
+
+    def read(self, timeout: Optional[float] = None) -> bytes:
+        raise RuntimeError("simulated endpoints are driven by the SimClock")
+
+    def write(self, data: bytes):
+        if self.wire is not None:
+            self.wire.send(data)
+
+    def take_pending(self) -> List[bytes]:
+        return self.wire.take_pending() if self.wire is not None else []
+
+    def out_waiting(self) -> int:
+        return self.wire.out_waiting() if self.wire is not None else 0
+
+    def close(self):
+        pass
+
+def sim_endpoint(clock: SimClock, name: str, **kwargs) -> ZettaProtocol:
+    """Create a ZettaProtocol instance attached to the simulator"""
+    ep = ZettaProtocol(transport=SimTransport(name), **kwargs)
+    ep.clock = clock
+    return ep
+
+def _receive(ep: ZettaProtocol, data: bytes):
+    ep.stats['bytes_received'] += len(data)
+    frames = ep.decoder.feed(data)
+    if frames:
+        ep._dispatch_frames(frames, ep.tracer, time.perf_counter())
+
+def connect(clock: SimClock, a: ZettaProtocol, b: ZettaProtocol, seed: int = 0,
+            **wire_kwargs):
+    """
+    Connect two simulated endpoints with a pair of wires.
+
+    Keyword arguments are passed to both SimWire objects.
+
+    Returns:
+        (wire a -> b, wire b -> a)
+    """
+    rng = random.Random(seed)
+    ab = SimWire(clock, rng=random.Random(rng.random()),
+                 name=f"{a.transport.name}->{b.transport.name}", **wire_kwargs)
+    ba = SimWire(clock, rng=random.Random(rng.random()),
+                 name=f"{b.transport.name}->{a.transport.name}", **wire_kwargs)
+    ab.sink = lambda data: _receive(b, data)
+    ba.sink = lambda data: _receive(a, data)
+    a.transport.wire = ab
+    b.transport.wire = ba
+    return ab, ba
+
+def attach_device(clock: SimClock, ep: ZettaProtocol, feed: Callable[[bytes], None],
+                  seed: int = 0, **wire_kwargs):
+    """
+    Connect a simulated endpoint to a device model that takes raw bytes.
+
+    feed() receives everything the endpoint sends; the device writes with
+    the returned device -> endpoint wire (see bench_soak.py for the C core).
+
+    Returns:
+        (wire endpoint -> device, wire device -> endpoint)
+    """
+    rng = random.Random(seed)
+    to_dev = SimWire(clock, rng=random.Random(rng.random()),
+                     name=f"{ep.transport.name}->device", **wire_kwargs)
+    from_dev = SimWire(clock, rng=random.Random(rng.random()),
+                       name=f"device->{ep.transport.name}", **wire_kwargs)
+    to_dev.sink = feed
+    from_dev.sink = lambda data: _receive(ep, data)
+    ep.transport.wire = to_dev
+    return to_dev, from_dev
@@ -0,0 +1,232 @@
+# zetta_time.py
+"""
+Device timestamps in the frame, mirror of Core/inc/zetta_time.h.
+
+Frames of an enabled type carry the time the device sent them or acquired
+their sample, in ticks of the device clock, in front of the payload (after
+the sequence byte). Close timestamps only send their low bits:
+
+    0ddddddd                 low 7 bits, |delta| < 32 ticks
+    10dddddd dddddddd        low 14 bits, |delta| < 4096 ticks
+    11000000 t0 t1 t2 t3     full 32 bit timestamp, little endian
+
+The receiver decodes the low bits to the timestamp nearest to its previous
+one. A full timestamp goes out every `full_interval` stamped frames.
+
+ClockSync maps device ticks to host wall clock time. Every frame gives an
+upper bound of the clock offset (arrival minus device time); the smallest
+bound of each bucket is the frame with the least buffering and queueing
+delay, and a line through the bucket minima follows the device clock drift.
+"""
+import struct
+import time
+from collections import deque
+from typing import Callable, Optional, Tuple
+
+FULL_INTERVAL = 32
+SHORT_DELTA = 32
+MEDIUM_DELTA = 4096
+FULL_SIZE = 5
+
+_u32 = struct.Struct('<I')
+
+def _unwrap(ref: int, low: int, bits: int) -> int:
+    """Timestamp nearest to ref whose low `bits` bits are low"""
+    span = 1 << bits
+    diff = (low - ref) & (span - 1)
+    if diff >= span >> 1:
+        diff -= span
+    return ref + diff
+
+class TimestampEncoder:
+    """Sender side of the timestamp field"""
+
+    def __init__(self, full_interval: int = FULL_INTERVAL):
+        self.full_interval = full_interval
+        self.ref = 0
+        self.count = 0
+        self.synced = False
+        self.stats = {'short': 0, 'medium': 0, 'full': 0}
+
+    def encode(self, ticks: int) -> bytes:
+        field = self.field(ticks)
+        self.advance(ticks, len(field))
+        return field
+
+    def field(self, ticks: int) -> bytes:
+        """Field of ticks against the current state, which is left alone"""
+        ticks &= 0xFFFFFFFF
+        delta = ((ticks - self.ref + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+        if not self.synced or self.count >= self.full_interval or abs(delta) >= MEDIUM_DELTA:
+            return b'\xc0' + _u32.pack(ticks)
+        if abs(delta) < SHORT_DELTA:
+            return bytes((ticks & 0x7F,))
+        return bytes((0x80 | (ticks & 0x3F), (ticks >> 6) & 0xFF))
+
+    def advance(self, ticks: int, size: int):
+        """Move past a field of that size for ticks, once its frame went out"""
+        if size == FULL_SIZE:
+            self.synced = True
+            self.count = 0
+            self.stats['full'] += 1
+        elif size == 1:
+            self.stats['short'] += 1
+        else:
+            self.stats['medium'] += 1
+        self.count += 1
+        self.ref = ticks & 0xFFFFFFFF
+
+class TimestampDecoder:
+    """
+    Receiver side of the timestamp field.
+
+    Timestamps are extended past the 32 bit wrap. A full timestamp more than
+    `restart` ticks behind the previous one is taken as a device restart.
+    """
+
+    def __init__(self, restart: int = 1_000_000):
+        self.restart = restart
+        self.ref = 0
+        self.synced = False
+        self.stats = {'frames': 0, 'unsynced': 0, 'restarts': 0}
+
+    def decode(self, data: bytes) -> Tuple[Optional[int], int]:
+        """Decode the field at the start of data, returns (ticks, field size)"""
+        if not data:
+            raise ValueError("timestamp field missing")
+        tag = data[0]
+        size = (FULL_SIZE if tag & 0x40 else 2) if tag & 0x80 else 1
+        if len(data) < size:
+            raise ValueError("timestamp field truncated")
+        self.stats['frames'] += 1
+        if size == FULL_SIZE:
+            low = _u32.unpack_from(data, 1)[0]
+            ticks = _unwrap(self.ref, low, 32) if self.synced else low
+            if self.synced and self.ref - ticks > self.restart:
+                self.stats['restarts'] += 1
+                ticks = low
+            self.synced = True
+        elif not self.synced:
+            self.stats['unsynced'] += 1
+            return None, size
+        elif size == 1:
+            ticks = _unwrap(self.ref, tag & 0x7F, 7)
+        else:
+            ticks = _unwrap(self.ref, (tag & 0x3F) | data[1] << 6, 14)
+        self.ref = ticks
+        return ticks, size
+
+class ClockSync:
+    """
+    Device clock to host clock mapping from one-way arrivals.
+
+    Args:
+        bucket: Device seconds per offset minimum
+        window: Bucket minima used for the drift fit
+    """
+
+    def __init__(self, bucket: float = 1.0, window: int = 32):
+        self.bucket = bucket
+        self.minima = deque(maxlen=window)
+        self.reset()
+
+    def reset(self):
+        self.minima.clear()
+        self._index = None
+        self._min = None  # (offset, device time) of the open bucket
+        self._line = None  # (x0, a, b): offset = a + b * (device - x0)
+
+    def observe(self, device: float, host: float):
+        offset = host - device
+        index = int(device // self.bucket)
+        if index != self._index:
+            if self._min is not None:
+                self.minima.append(self._min)
+                self._fit()
+            self._index = index
+            self._min = None
+        if self._min is None or offset < self._min[0]:
+            self._min = (offset, device)
+
+    def _fit(self):
+        if len(self.minima) < 2:
+            self._line = None
+            return
+        x0 = self.minima[0][1]
+        n = len(self.minima)
+        mx = sum(d - x0 for _, d in self.minima) / n
+        my = sum(o for o, _ in self.minima) / n
+        sxx = sum((d - x0 - mx) ** 2 for _, d in self.minima)
+        sxy = sum((d - x0 - mx) * (o - my) for o, d in self.minima)
+        b = sxy / sxx if sxx else 0.0
+        self._line = (x0, my - b * mx, b)
+
+    def offset(self, device: float) -> Optional[float]:
+        """Host minus device time at a device time, None before any frame"""
+        if self._line is not None:
+            x0, a, b = self._line
+            return a + b * (device - x0)
+        candidates = [o for o, _ in self.minima]
+        if self._min is not None:
+            candidates.append(self._min[0])
+        return min(candidates) if candidates else None
+
+    def skew(self) -> float:
+        """Device clock rate error, positive when the device runs slow"""
+        return self._line[2] if self._line is not None else 0.0
+
+class DeviceTime:
+    """
+    Timestamp fields of one link and the clock mapping of its device.
+
+    Args:
+        tick: Seconds per device clock tick
+        full_interval: Stamped frames between full timestamps
+        clock: Host clock of timestamps on frames sent by the host
+    """
+
+    def __init__(self, tick: float = 1e-6, full_interval: int = FULL_INTERVAL,
+                 clock: Callable[[], float] = time.monotonic):
+        self.tick = tick
+        self.clock = clock
+        self.types = set()
+        self.encoder = TimestampEncoder(full_interval)
+        self.decoder = TimestampDecoder(restart=int(1.0 / tick))
+        self.sync = ClockSync()
+        self._restarts = 0
+
+    def enable(self, packet_type: int):
+        self.types.add(int(packet_type))
+
+    def encode(self, acquired: Optional[float] = None) -> bytes:
+        """Field of a frame sent now or of a sample acquired at host time `acquired`"""
+        t = self.clock() if acquired is None else acquired
+        return self.encoder.encode(int(round(t / self.tick)))
+
+    def field(self, acquired: Optional[float] = None) -> Tuple[int, bytes]:
+        """
+        Like encode() but without advancing the encoder: returns (ticks,
+        field) to hand to commit() once the frame was sent.
+        """
+        t = self.clock() if acquired is None else acquired
+        ticks = int(round(t / self.tick))
+        return ticks, self.encoder.field(ticks)
+
+    def commit(self, ticks: int, field: bytes):
+        self.encoder.advance(ticks, len(field))
+
+    def decode(self, payload: bytes, arrival: float) -> Tuple[Optional[int], Optional[float], int]:
+        """Returns (ticks, device time in host clock, field size)"""
+        ticks, size = self.decoder.decode(payload)
+        if ticks is None:
+            return None, None, size
+        if self.decoder.stats['restarts'] != self._restarts:
+            self._restarts = self.decoder.stats['restarts']
+            self.sync.reset()
+        device = ticks * self.tick
+        self.sync.observe(device, arrival)
+        return ticks, device + self.sync.offset(device), size
+
+    def get_stats(self) -> dict:
+        return dict(tx=dict(self.encoder.stats), rx=dict(self.decoder.stats),
+                    skew=self.sync.skew())
@@ -0,0 +1,217 @@
+# zetta_trace.py
+"""
+Low overhead event tracing for the Zetta host stack.
+
+Events are recorded into per-thread ring buffers (no lock is taken on the
+recording path) and can be exported as a Chrome JSON trace
+(chrome://tracing, ui.perfetto.dev) or as a Perfetto protobuf trace.
+
+    tracer = ZettaTracer()
+    zetta = ZettaProtocol(port, tracer=tracer)
+    tracer.start()
+    ...
+    tracer.stop()
+    tracer.export_perfetto("zetta.pftrace")
+"""
+import json
+import os
+import threading
+import time
+from collections import deque
+from contextlib import contextmanager
+from typing import Dict, Iterator, List, Optional, Tuple
+
+# Perfetto timestamps default to CLOCK_BOOTTIME
+if hasattr(time, 'CLOCK_BOOTTIME'):
+    def now_ns() -> int:
+        return time.clock_gettime_ns(time.CLOCK_BOOTTIME)
+else:
+    now_ns = time.perf_counter_ns
+
+# Event kinds
+SLICE = 0    # (kind, name, ts, dur, args)
+INSTANT = 1  # (kind, name, ts, 0, args)
+COUNTER = 2  # (kind, name, ts, value, None)
+
+class _ThreadBuffer:
+    __slots__ = ('tid', 'name', 'events')
+
+    def __init__(self, capacity: int):
+        thread = threading.current_thread()
+        self.tid = threading.get_native_id()
+        self.name = thread.name
+        self.events = deque(maxlen=capacity)
+
+class ZettaTracer:
+    """
+    Collects trace events from every thread that records one.
+
+    Args:
+        capacity: Events kept per thread, older events are overwritten
+    """
+
+    def __init__(self, capacity: int = 1 << 16):
+        self.capacity = capacity
+        self.enabled = False
+        self._local = threading.local()
+        self._buffers: List[_ThreadBuffer] = []
+        self._register_lock = threading.Lock()
+
+    def start(self):
+        self.enabled = True
+
+    def stop(self):
+        self.enabled = False
+
+    def clear(self):
+        for buf in list(self._buffers):
+            buf.events.clear()
+
+    def _buffer(self) -> deque:
+        try:
+            return self._local.buf.events
+        except AttributeError:
+            buf = _ThreadBuffer(self.capacity)
+            # Only taken once per thread
+            with self._register_lock:
+                self._buffers.append(buf)
+            self._local.buf = buf
+            return buf.events
+
+    # Recording
+    def complete(self, name: str, start_ns: int, args: Optional[dict] = None):
+        """Record a slice that started at start_ns and ends now"""
+        if self.enabled:
+            end = now_ns()
+            self._buffer().append((SLICE, name, start_ns, end - start_ns, args))
+
+    def instant(self, name: str, args: Optional[dict] = None):
+        if self.enabled:
+            self._buffer().append((INSTANT, name, now_ns(), 0, args))
+
+    def counter(self, name: str, value: int):
+        if self.enabled:
+            self._buffer().append((COUNTER, name, now_ns(), value, None))
+
+    @contextmanager
+    def span(self, name: str, args: Optional[dict] = None) -> Iterator[None]:
+        start = now_ns()
+        try:
+            yield
+        finally:
+            self.complete(name, start, args)
+
+    def events(self) -> List[Tuple[_ThreadBuffer, list]]:
+        """Snapshot of the recorded events per thread"""
+        return [(buf, list(buf.events)) for buf in list(self._buffers)]
+
+    # Export
+    def export_chrome(self, path: str):
+        """Write a Chrome trace event format JSON file"""
+        pid = os.getpid()
+        out = []
+        for buf, events in self.events():
+            out.append({'name': 'thread_name', 'ph': 'M', 'pid': pid,
+                        'tid': buf.tid, 'args': {'name': buf.name}})
+            for kind, name, ts, val, args in events:
+                ev = {'name': name, 'pid': pid, 'tid': buf.tid, 'ts': ts / 1000.0}
+                if kind == SLICE:
+                    ev.update(ph='X', dur=val / 1000.0)
+                elif kind == INSTANT:
+                    ev.update(ph='i', s='t')
+                else:
+                    ev.update(ph='C', args={'value': val})
+                if args and kind != COUNTER:
+                    ev['args'] = args
+                out.append(ev)
+        with open(path, 'w') as f:
+            json.dump({'traceEvents': out, 'displayTimeUnit': 'ns'}, f)
+
+    def export_perfetto(self, path: str):
+        """Write a Perfetto protobuf trace (TrackEvent based)"""
+        pid = os.getpid()
+        out = bytearray()
+        out += _packet(_track_descriptor(pid, pid, process=True, name='zetta'), seq=1)
+        counters: Dict[str, int] = {}
+        for seq, (buf, events) in enumerate(self.events(), start=1):
+            track = (pid << 32) | buf.tid
+            out += _packet(_track_descriptor(track, pid, tid=buf.tid, name=buf.name,
+                                             parent=pid), seq=seq)
+            stream = []
+            for kind, name, ts, val, args in events:
+                if kind == SLICE:
+                    stream.append(((ts, 1, -val), _BEGIN, name, track, 0))
+                    stream.append(((ts + val, 0, -ts), _END, name, track, 0))
+                elif kind == INSTANT:
+                    stream.append(((ts, 1, 0), _INSTANT, name, track, 0))
+                else:
+                    if name not in counters:
+                        uuid = (1 << 62) | len(counters)
+                        counters[name] = uuid
+                        out += _packet(_track_descriptor(uuid, pid, counter=True,
+                                                         name=name, parent=pid), seq=seq)
+                    stream.append(((ts, 1, 0), _COUNTER, name, counters[name], val))
+            stream.sort(key=lambda e: e[0])
+            for (ts, _, _), etype, name, uuid, val in stream:
+                out += _packet(_track_event(etype, name, uuid, val), ts, seq)
+        with open(path, 'wb') as f:
+            f.write(out)
+
+# Minimal protobuf encoding for the Perfetto trace format
+_BEGIN, _END, _INSTANT, _COUNTER = 1, 2, 3, 4
+
+def _varint(v: int) -> bytes:
+    v &= (1 << 64) - 1
+    out = bytearray()
+    while True:
+        b = v & 0x7F
+        v >>= 7
+        if v:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+def _field_varint(num: int, v: int) -> bytes:
+    return _varint(num << 3) + _varint(v)
+
+def _field_bytes(num: int, data: bytes) -> bytes:
+    return _varint((num << 3) | 2) + _varint(len(data)) + data
+
+def _track_descriptor(uuid: int, pid: int, tid: Optional[int] = None,
+                      process: bool = False, counter: bool = False,
+                      name: str = '', parent: Optional[int] = None) -> bytes:
+    # TrackDescriptor: uuid=1, name=2, process=3, thread=4, parent_uuid=5, counter=8
+    msg = _field_varint(1, uuid) + _field_bytes(2, name.encode())
+    if parent is not None:
+        msg += _field_varint(5, parent)
+    if process:
+        # ProcessDescriptor: pid=1, process_name=6
+        msg += _field_bytes(3, _field_varint(1, pid) + _field_bytes(6, name.encode()))
+    if tid is not None:
+        # ThreadDescriptor: pid=1, tid=2, thread_name=5
+        msg += _field_bytes(4, _field_varint(1, pid) + _field_varint(2, tid)
+                            + _field_bytes(5, name.encode()))
+    if counter:
+        msg += _field_bytes(8, b'')
+    # TracePacket.track_descriptor = 60
+    return _field_bytes(60, msg)
+
+def _track_event(etype: int, name: str, uuid: int, value: int) -> bytes:
+    # TrackEvent: type=9, track_uuid=11, name=23, counter_value=30
+    msg = _field_varint(9, etype) + _field_varint(11, uuid)
+    if etype == _COUNTER:
+        msg += _field_varint(30, value)
+    elif etype != _END:
+        msg += _field_bytes(23, name.encode())
+    # TracePacket.track_event = 11
+    return _field_bytes(11, msg)
+
+def _packet(body: bytes, ts: Optional[int] = None, seq: int = 0) -> bytes:
+    # TracePacket: timestamp=8, trusted_packet_sequence_id=10
+    if ts is not None:
+        body = _field_varint(8, ts) + body
+    if seq:
+        body += _field_varint(10, seq)
+    # Trace.packet = 1
+    return _field_bytes(1, body)
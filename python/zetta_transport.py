@@ -0,0 +1,397 @@
+# zetta_transport.py
+"""
+Byte transports for ZettaProtocol.
+
+A transport moves raw bytes, framing is done by the protocol. ``read``
+blocks in the kernel (releasing the GIL) until data arrives or the timeout
+expires, so the receiver thread never polls.
+
+    read(timeout) -> bytes   b'' on timeout
+    write(data) -> None      writes everything, ConnectionError after close()
+    close()
+    name                     for log messages
+    out_waiting() -> int     optional, bytes written but not sent yet
+    write_frames(frames)     optional, writes a list of frames in one call
+    cork() / uncork()        optional, around a writer thread batch
+
+Message transports (``messages = True``) keep frame boundaries themselves.
+They also provide ``read_messages(timeout) -> List[bytes]``, each write is
+one message and the protocol skips framing and checks on them.
+"""
+import errno
+import fcntl
+import os
+import select
+import socket
+import struct
+import termios
+import threading
+import time
+from typing import List, Optional, Sequence, Tuple, Union
+
+READ_SIZE = 1 << 16
+# Longest a blocked write waits before checking whether the transport closed
+WRITE_POLL = 0.1
+
+def _poller(fd: int, events: int):
+    # poll() rather than select(): select() fails on descriptors >= FD_SETSIZE
+    poller = select.poll()
+    poller.register(fd, events)
+    return poller
+
+def _ms(timeout: Optional[float]) -> Optional[float]:
+    return None if timeout is None else timeout * 1000
+
+class SerialTransport:
+    """
+    pyserial port.
+
+    Args:
+        port: Serial port (e.g., "/dev/ttyACM0", "COM3")
+        baudrate: Baud rate
+        timeout: Read timeout in seconds
+    """
+
+    def __init__(self, port: str, baudrate: int = 115200, timeout: float = 0.1):
+        import serial
+        self.ser = serial.Serial(port, baudrate, timeout=timeout)
+        self.name = port
+
+    def read(self, timeout: Optional[float] = None) -> bytes:
+        # Blocks for the first byte, then takes whatever else is buffered
+        ser = self.ser
+        return ser.read(max(1, ser.in_waiting))
+
+    def write(self, data: bytes):
+        self.ser.write(data)
+
+    def out_waiting(self) -> int:
+        return self.ser.out_waiting
+
+    def close(self):
+        self.ser.close()
+
+class FdTransport:
+    """
+    Any readable/writable descriptor: pty, pipe, socket, tty opened with os.open.
+
+    Args:
+        fd: Descriptor used for reading (and writing when write_fd is None)
+        write_fd: Separate descriptor for writing
+        name: Name for log messages
+        owns: Close the descriptors in close()
+    """
+
+    def __init__(self, fd: int, write_fd: Optional[int] = None,
+                 name: Optional[str] = None, owns: bool = True):
+        self.fd = fd
+        self.write_fd = fd if write_fd is None else write_fd
+        self.name = name or f"fd{fd}"
+        self.owns = owns
+        self.closed = False
+        # Created on first use, -1 stands in for a transport that never does IO
+        self._rx_poll = None
+        self._tx_poll = None
+
+    def wait_readable(self, timeout: Optional[float]) -> bool:
+        if self._rx_poll is None:
+            self._rx_poll = _poller(self.fd, select.POLLIN)
+        return bool(self._rx_poll.poll(_ms(timeout)))
+
+    def read(self, timeout: Optional[float] = None) -> bytes:
+        if not self.wait_readable(timeout):
+            return b''
+        try:
+            data = os.read(self.fd, READ_SIZE)
+        except BlockingIOError:
+            return b''
+        if not data:
+            raise ConnectionError(f"{self.name} closed")
+        return data
+
+    def write(self, data: bytes):
+        view = memoryview(data)
+        while view:
+            try:
+                n = os.write(self.write_fd, view)
+            except BlockingIOError:
+                self.wait_writable()
+                continue
+            view = view[n:]
+
+    def wait_writable(self):
+        """Wait for room to write, ConnectionError once the transport closed"""
+        if self._tx_poll is None:
+            self._tx_poll = _poller(self.write_fd, select.POLLOUT)
+        while not self.closed:
+            if self._tx_poll.poll(WRITE_POLL * 1000):
+                return
+        raise ConnectionError(f"{self.name} closed")
+
+    def out_waiting(self) -> int:
+        # TIOCOUTQ: tty output queue, unsent bytes of a socket
+        try:
+            buf = fcntl.ioctl(self.write_fd, termios.TIOCOUTQ, b'\0\0\0\0')
+        except OSError:
+            return 0
+        return struct.unpack('i', buf)[0]
+
+    def close(self):
+        self.closed = True
+        if not self.owns:
+            return
+        os.close(self.fd)
+        if self.write_fd != self.fd:
+            os.close(self.write_fd)
+
+# Linux values, the socket module only exports them on newer Pythons
+SO_ZEROCOPY = getattr(socket, 'SO_ZEROCOPY', 60)
+MSG_ZEROCOPY = getattr(socket, 'MSG_ZEROCOPY', 0x4000000)
+_SO_EE_ORIGIN_ZEROCOPY = 5
+_SO_EE_CODE_ZEROCOPY_COPIED = 1
+_sock_extended_err = struct.Struct('=IBBBBII')
+IOV_MAX = 1024
+ZEROCOPY_REAP = 64  # pinned sends before write_frames() reaps
+
+class TcpTransport(FdTransport):
+    """
+    TCP socket with batched writes.
+
+    write_frames() sends a list of encoded frames with one sendmsg() call
+    (scatter/gather, the frames are not joined). ZettaProtocol(tx_thread=True)
+    writes its queue that way and corks the socket while more than one write
+    is needed, so the kernel sends full segments; uncorking sends the rest
+    at once.
+
+    Writes of at least `zerocopy_threshold` bytes use MSG_ZEROCOPY: the kernel
+    sends from the frame objects' pages instead of copying them and reports
+    completion on the socket error queue, the frames stay referenced until
+    then. Pinning pages only pays off for large writes, and on loopback the
+    kernel copies anyway (counted in stats['zerocopy_copied']).
+
+    Args:
+        sock: Connected socket, or (host, port) to connect to
+        nodelay: Set TCP_NODELAY, for latency critical channels
+        zerocopy_threshold: Smallest write sent with MSG_ZEROCOPY, None: never
+        cork: Let the writer thread cork the socket around batches
+        name: Name for log messages
+    """
+
+    def __init__(self, sock: Union[socket.socket, Tuple[str, int]], nodelay: bool = False,
+                 zerocopy_threshold: Optional[int] = None, cork: bool = True,
+                 name: Optional[str] = None):
+        if not isinstance(sock, socket.socket):
+            sock = socket.create_connection(sock)
+        self.sock = sock
+        sock.setblocking(False)
+        if nodelay:
+            sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        super().__init__(sock.fileno(), name=name or f"tcp {sock.getpeername()}", owns=False)
+        self.zerocopy_threshold = None
+        if zerocopy_threshold is not None:
+            try:
+                sock.setsockopt(socket.SOL_SOCKET, SO_ZEROCOPY, 1)
+                self.zerocopy_threshold = zerocopy_threshold
+            except OSError:
+                pass  # kernel without MSG_ZEROCOPY, plain copies
+        self.corking = cork
+        self._corked = False
+        self._zc_lock = threading.Lock()
+        self._zc_next = 0  # kernel counter of the next zerocopy send
+        self._zc_pinned = {}  # counter -> frames the kernel may still read
+        self.stats = {'writes': 0, 'frames': 0, 'bytes': 0, 'corks': 0,
+                      'zerocopy': 0, 'zerocopy_copied': 0, 'zerocopy_fallback': 0}
+
+    def read(self, timeout: Optional[float] = None) -> bytes:
+        if not self.wait_readable(timeout):
+            return b''
+        try:
+            data = self.sock.recv(READ_SIZE)
+        except BlockingIOError:
+            # Woken by a zerocopy completion on the error queue
+            self.reap()
+            return b''
+        if not data:
+            raise ConnectionError(f"{self.name} closed")
+        return data
+
+    def write(self, data: bytes):
+        self.write_frames((data,))
+
+    def write_frames(self, frames: Sequence[bytes]):
+        """Write frames in order with as few sendmsg() calls as possible"""
+        st = self.stats
+        size = sum(len(f) for f in frames)
+        flags = 0
+        if self.zerocopy_threshold is not None and size >= self.zerocopy_threshold:
+            flags = MSG_ZEROCOPY
+            # The kernel reads the pages later, they must never change
+            frames = [f if isinstance(f, bytes) else bytes(f) for f in frames]
+        views = [memoryview(f) for f in frames]
+        first = 0
+        while first < len(views):
+            try:
+                n = self.sock.sendmsg(views[first:first + IOV_MAX], (), flags)
+            except BlockingIOError:
+                self.reap()
+                self.wait_writable()
+                continue
+            except OSError as e:
+                if flags and e.errno == errno.ENOBUFS:
+                    # Too many pinned pages (optmem_max), copy instead
+                    flags = 0
+                    st['zerocopy_fallback'] += 1
+                    continue
+                raise
+            st['writes'] += 1
+            if flags:
+                with self._zc_lock:
+                    self._zc_pinned[self._zc_next] = frames
+                    self._zc_next = (self._zc_next + 1) & 0xFFFFFFFF
+                st['zerocopy'] += 1
+                if len(self._zc_pinned) >= ZEROCOPY_REAP:
+                    self.reap()
+            while n:
+                view = views[first]
+                if n < len(view):
+                    views[first] = view[n:]
+                    break
+                n -= len(view)
+                first += 1
+        st['frames'] += len(frames)
+        st['bytes'] += size
+
+    def cork(self):
+        """Hold back partial segments until uncork()"""
+        if self.corking and not self._corked and not self.closed:
+            self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_CORK, 1)
+            self._corked = True
+            self.stats['corks'] += 1
+
+    def uncork(self):
+        if self._corked:
+            self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_CORK, 0)
+            self._corked = False
+
+    def reap(self) -> int:
+        """Release frames of completed zerocopy sends, returns how many"""
+        released = 0
+        with self._zc_lock:
+            while self._zc_pinned:
+                try:
+                    _, ancdata, _, _ = self.sock.recvmsg(0, 256, socket.MSG_ERRQUEUE)
+                except (BlockingIOError, InterruptedError):
+                    break
+                for _, _, cdata in ancdata:
+                    if len(cdata) < _sock_extended_err.size:
+                        continue
+                    _, origin, _, code, _, lo, hi = _sock_extended_err.unpack_from(cdata)
+                    if origin != _SO_EE_ORIGIN_ZEROCOPY:
+                        continue
+                    count = ((hi - lo) & 0xFFFFFFFF) + 1
+                    if code & _SO_EE_CODE_ZEROCOPY_COPIED:
+                        self.stats['zerocopy_copied'] += count
+                    for i in range(count):
+                        if self._zc_pinned.pop((lo + i) & 0xFFFFFFFF, None) is not None:
+                            released += 1
+        return released
+
+    def pinned(self) -> int:
+        """Zerocopy sends the kernel has not completed yet"""
+        return len(self._zc_pinned)
+
+    def close(self):
+        self.closed = True
+        # Pinned pages must outlive the kernel's use of them
+        deadline = time.monotonic() + 1.0
+        while self._zc_pinned and time.monotonic() < deadline:
+            if not self.reap():
+                time.sleep(0.001)
+        self.sock.close()
+
+class SeqpacketTransport:
+    """
+    Unix SOCK_SEQPACKET socket between processes on one host.
+
+    The kernel delivers every message whole, in order and unmodified, so a
+    frame is just TYPE | PAYLOAD (zetta_profile.MessageProfile): no START/STOP
+    hunting, no LEN state and no check. ZettaProtocol switches to that
+    profile when given this transport.
+
+    Args:
+        sock: Connected SOCK_SEQPACKET socket, or path of a listening one
+        max_payload: Largest payload, longer messages are dropped and counted
+        batch: Most messages taken per read_messages() call
+        name: Name for log messages
+    """
+
+    messages = True
+
+    def __init__(self, sock: Union[socket.socket, str], max_payload: int = 16384,
+                 batch: int = 64, name: Optional[str] = None):
+        if not isinstance(sock, socket.socket):
+            path = sock
+            sock = socket.socket(socket.AF_UNIX, socket.SOCK_SEQPACKET)
+            sock.connect(path)
+        self.sock = sock
+        self.fd = sock.fileno()
+        self.max_payload = max_payload
+        self.batch = batch
+        self.name = name or f"seqpacket fd{self.fd}"
+        # TYPE + payload, one more byte tells a too long message apart
+        self._recv_size = max_payload + 2
+        self._rx_poll = _poller(self.fd, select.POLLIN)
+        self.stats = {'messages_in': 0, 'messages_out': 0, 'oversized': 0}
+
+    @classmethod
+    def pair(cls, **kwargs) -> Tuple['SeqpacketTransport', 'SeqpacketTransport']:
+        """Two connected transports, e.g. for a local simulator"""
+        a, b = socket.socketpair(socket.AF_UNIX, socket.SOCK_SEQPACKET)
+        return cls(a, **kwargs), cls(b, **kwargs)
+
+    def read_messages(self, timeout: Optional[float] = None) -> List[bytes]:
+        """Wait for messages, then take what is queued (up to batch)"""
+        if not self._rx_poll.poll(_ms(timeout)):
+            return []
+        recv = self.sock.recv
+        size = self._recv_size
+        messages = []
+        while len(messages) < self.batch:
+            try:
+                message = recv(size, socket.MSG_DONTWAIT)
+            except BlockingIOError:
+                break
+            if not message:
+                # Frames are never empty, an empty read is the peer closing
+                if messages:
+                    break
+                raise ConnectionError(f"{self.name} closed")
+            if len(message) == size:
+                self.stats['oversized'] += 1
+                continue
+            messages.append(message)
+        self.stats['messages_in'] += len(messages)
+        return messages
+
+    def read(self, timeout: Optional[float] = None) -> bytes:
+        """One message, b'' on timeout"""
+        batch, self.batch = self.batch, 1
+        try:
+            messages = self.read_messages(timeout)
+        finally:
+            self.batch = batch
+        return messages[0] if messages else b''
+
+    def write(self, data: bytes):
+        self.sock.send(data)
+        self.stats['messages_out'] += 1
+
+    def write_frames(self, frames: Sequence[bytes]):
+        """One message per frame, frames must not be joined"""
+        send = self.sock.send
+        for frame in frames:
+            send(frame)
+        self.stats['messages_out'] += len(frames)
+
+    def close(self):
+        self.sock.close()